@@ -10,7 +10,10 @@
 //
 // ===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,16 +22,42 @@
 #include "common/logger.h"
 #include "common/rid.h"
 #include "container/hash/extendible_hash_table.h"
-#define MAX_GLOBAL_DEPTH 9
 
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  //  implement me!
-  directory_page_id_ = INVALID_PAGE_ID;
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     bool unique_keys)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      unique_keys_(unique_keys) {
+  static_assert(DIRECTORY_PAGES_PER_INDEX_PAGE <= (PAGE_SIZE - sizeof(HashTableHeaderPage)) / sizeof(page_id_t),
+                "directory pages do not fit in an index page");
+  static_assert(MAX_DIRECTORY_PAGES / DIRECTORY_PAGES_PER_INDEX_PAGE <=
+                    (PAGE_SIZE - sizeof(HashTableHeaderPage)) / sizeof(page_id_t),
+                "index pages do not fit in the header page");
+  // 创建header页和第一个bucket，目录之后一直缓存在dir_中，第一个目录页在FlushDirectory中创建
+  Page *header_page = buffer_pool_manager_->NewPage(&header_page_id_);
+  assert(header_page != nullptr);
+  reinterpret_cast<HashTableHeaderPage *>(header_page->GetData())->SetPageId(header_page_id_);
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
+
+  page_id_t page_id_bucket;
+  Page *bucket_page = buffer_pool_manager_->NewPage(&page_id_bucket);
+  assert(bucket_page != nullptr);
+  FetchBucketPage(bucket_page)->Init();
+  dir_.SetBucketPageId(0, page_id_bucket);
+  buffer_pool_manager_->UnpinPage(page_id_bucket, true);
+  if (!FlushDirectory()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot write the directory of the hash table");
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::~ExtendibleHashTable() {
+  StopBackgroundMerge();
 }
 
 /*****************************************************************************
@@ -47,39 +76,110 @@ uint32_t HASH_TABLE_TYPE::Hash(KeyType key) {
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline uint32_t HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) {
-  return Hash(key) & dir_page->GetGlobalDepthMask();
+inline uint32_t HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectory *dir) {
+  return Hash(key) & dir->GetGlobalDepthMask();
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) {
-  return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
+inline uint32_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectory *dir) {
+  return dir->GetBucketPageId(KeyToDirectoryIndex(key, dir));
 }
 
-/* 获取HashTableDirectoryPage,如果没有,首先创建，如果有则直接获取
-   从buffer_pool_manager中获取Page,Page中是一个Directory对象
+/* 将缓存的目录中被修改过的切片写回对应的目录页，目录变大时新建目录页并记录到索引页中，索引页再记录到header页中。
+   写回由flush_mutex_串行化；只在目录读锁下把要写的切片复制出来，读写页的时候不持有目录锁
 */
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
-  HashTableDirectoryPage *dir_page;
-  directory_lock_.lock();
-  if (directory_page_id_ == INVALID_PAGE_ID) {
-    page_id_t page_id_dir;
-    Page *page = buffer_pool_manager_->NewPage(&page_id_dir);
-    dir_page = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
-    directory_page_id_ = page_id_dir;
-    dir_page->SetPageId(directory_page_id_);
-
-    page_id_t page_id_bucket;
-    page = buffer_pool_manager_->NewPage(&page_id_bucket);
-    dir_page->SetBucketPageId(0, page_id_bucket);
-    buffer_pool_manager_->UnpinPage(page_id_dir, true);
-    buffer_pool_manager_->UnpinPage(page_id_bucket, true);
-  }
-  directory_lock_.unlock();
-  Page *page = buffer_pool_manager_->FetchPage(directory_page_id_);
-  dir_page = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
-  return dir_page;
+bool HASH_TABLE_TYPE::FlushDirectory() {
+  std::lock_guard<std::mutex> guard(flush_mutex_);
+  std::vector<uint32_t> slices;
+  std::vector<HashTableDirectoryPage> snapshots;
+  directory_latch_.RLock();
+  size_t size = dir_.Size();
+  for (uint32_t slice = 0; slice < dir_.NumSlices(); slice++) {
+    if (slice >= directory_page_ids_.size() || dir_.IsSliceDirty(slice)) {
+      slices.push_back(slice);
+      dir_.StoreSlice(slice, &snapshots.emplace_back());
+    }
+  }
+  directory_latch_.RUnlock();
+
+  size_t stored = 0;
+  for (; stored < slices.size(); stored++) {
+    uint32_t slice = slices[stored];
+    page_id_t page_id;
+    Page *page;
+    if (slice == directory_page_ids_.size()) {
+      page = buffer_pool_manager_->NewPage(&page_id);
+      if (page != nullptr) {
+        directory_page_ids_.push_back(page_id);
+      }
+    } else {
+      page_id = directory_page_ids_[slice];
+      page = buffer_pool_manager_->FetchPage(page_id);
+    }
+    if (page == nullptr) {
+      break;
+    }
+    page->WLatch();
+    memcpy(page->GetData(), &snapshots[stored], sizeof(HashTableDirectoryPage));
+    reinterpret_cast<HashTableDirectoryPage *>(page->GetData())->SetPageId(page_id);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  if (stored < slices.size()) {
+    // buffer pool满了，没写回的切片重新标记为脏，下次写回时再写
+    directory_latch_.WLock();
+    for (size_t i = stored; i < slices.size(); i++) {
+      dir_.MarkSliceDirty(slices[i]);
+    }
+    directory_latch_.WUnlock();
+  }
+
+  // 每个索引页记录DIRECTORY_PAGES_PER_INDEX_PAGE个目录页的页号，header页记录目录的大小和所有索引页的页号。
+  // 目录页在目录收缩后保留，再次扩容时复用
+  while (indexed_pages_ < directory_page_ids_.size()) {
+    size_t index = indexed_pages_ / DIRECTORY_PAGES_PER_INDEX_PAGE;
+    page_id_t index_page_id;
+    Page *page;
+    if (index == index_page_ids_.size()) {
+      page = buffer_pool_manager_->NewPage(&index_page_id);
+      if (page != nullptr) {
+        index_page_ids_.push_back(index_page_id);
+        reinterpret_cast<HashTableHeaderPage *>(page->GetData())->SetPageId(index_page_id);
+      }
+    } else {
+      index_page_id = index_page_ids_[index];
+      page = buffer_pool_manager_->FetchPage(index_page_id);
+    }
+    if (page == nullptr) {
+      return false;
+    }
+    page->WLatch();
+    auto index_page = reinterpret_cast<HashTableHeaderPage *>(page->GetData());
+    for (; indexed_pages_ < directory_page_ids_.size() && indexed_pages_ / DIRECTORY_PAGES_PER_INDEX_PAGE == index;
+         indexed_pages_++) {
+      index_page->AddBlockPageId(directory_page_ids_[indexed_pages_]);
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(index_page_id, true);
+  }
+  if (header_index_pages_ != index_page_ids_.size() || header_size_ != size) {
+    Page *page = buffer_pool_manager_->FetchPage(header_page_id_);
+    if (page == nullptr) {
+      return false;
+    }
+    page->WLatch();
+    auto header_page = reinterpret_cast<HashTableHeaderPage *>(page->GetData());
+    header_page->SetSize(size);
+    for (size_t i = header_page->NumBlocks(); i < index_page_ids_.size(); i++) {
+      header_page->AddBlockPageId(index_page_ids_[i]);
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(header_page_id_, true);
+    header_index_pages_ = index_page_ids_.size();
+    header_size_ = size;
+  }
+  return stored == slices.size();
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -93,25 +193,160 @@ HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(Page *page) {
   return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
 }
 
+/* 在目录缓存的读锁下读出hash对应的bucket页号和当前目录版本号，读完立即释放目录锁。
+   调用者拿到bucket的锁之后需要用版本号校验目录在此期间没有被分裂/合并修改过
+*/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+page_id_t HASH_TABLE_TYPE::ReadDirectory(uint64_t hash, uint64_t *version) {
+  directory_latch_.RLock();
+  page_id_t bucket_page_id = dir_.GetBucketPageId(static_cast<uint32_t>(hash) & dir_.GetGlobalDepthMask());
+  *version = dir_version_.load();
+  directory_latch_.RUnlock();
+  return bucket_page_id;
+}
+
+/* 在tail后面接一个新的溢出页并返回它。tail若不是head（调用者持有的页）则在此unpin，
+   *tail_id更新为新页的页号，新页由调用者负责unpin
+*/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::AppendOverflowPage(page_id_t head_id, HASH_TABLE_BUCKET_TYPE *tail,
+                                                            page_id_t *tail_id) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  assert(page != nullptr);
+  HASH_TABLE_BUCKET_TYPE *overflow = FetchBucketPage(page);
+  overflow->Init();
+  tail->SetNextPageId(page_id);
+  if (*tail_id != head_id) {
+    buffer_pool_manager_->UnpinPage(*tail_id, true);
+  }
+  *tail_id = page_id;
+  return overflow;
+}
+
 /*****************************************************************************
  * SEARCH
  * 根据key获取数据
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  table_latch_.RLock();  // Readers includes inserts and removes
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  page_id_t page_id = KeyToPageId(key, dir_page);
-  Page *page = FetchPage(page_id);
-  page->RLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(page);
-  bool ok = bucket_page->GetValue(key, comparator_, result);
-  page->RUnlatch();
-
-  buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-  buffer_pool_manager_->UnpinPage(page_id, false);
-  table_latch_.RUnlock();
-  return ok;
+  return GetValue(transaction, key, [result](const ValueType &value) {
+    result->push_back(value);
+    return true;
+  });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key,
+                               const std::function<bool(const ValueType &)> &callback) {
+  // hash只算一次：低位用于定位目录项，高8位作为bucket内的fingerprint
+  uint64_t hash = hash_fn_.GetHash(key);
+  uint8_t fingerprint = HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hash);
+  while (true) {
+    uint64_t version;
+    page_id_t page_id = ReadDirectory(hash, &version);
+    Page *page = FetchPage(page_id);
+    page->RLatch();
+    // 读目录到锁住bucket之间目录被修改过，key可能已经不在这个bucket里了，重试
+    if (dir_version_.load() != version) {
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      continue;
+    }
+    // 主bucket的读锁保护整条溢出链，逐页把结果交给callback
+    bool found = false;
+    // key唯一时第一个匹配就是全部结果，不再往后扫描bucket和溢出链
+    auto wrapped = [this, &found, &callback](const ValueType &value) {
+      found = true;
+      return callback(value) && !unique_keys_;
+    };
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(page);
+    bool more = bucket->ForEachValue(key, comparator_, fingerprint, wrapped);
+    for (page_id_t next_id = bucket->GetNextPageId(); more && next_id != INVALID_PAGE_ID;) {
+      HASH_TABLE_BUCKET_TYPE *overflow = FetchBucketPage(FetchPage(next_id));
+      more = overflow->ForEachValue(key, comparator_, fingerprint, wrapped);
+      page_id_t cur_id = next_id;
+      next_id = overflow->GetNextPageId();
+      buffer_pool_manager_->UnpinPage(cur_id, false);
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return found;
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                                std::vector<std::vector<ValueType>> *results) {
+  results->assign(keys.size(), std::vector<ValueType>());
+  if (keys.empty()) {
+    return;
+  }
+
+  // 先算出所有key的hash，在一次目录读锁内查出每个key对应的bucket
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    hashes[i] = hash_fn_.GetHash(keys[i]);
+  }
+  std::vector<std::pair<page_id_t, uint32_t>> probes(keys.size());
+  directory_latch_.RLock();
+  uint32_t mask = dir_.GetGlobalDepthMask();
+  for (size_t i = 0; i < keys.size(); i++) {
+    probes[i] = {dir_.GetBucketPageId(static_cast<uint32_t>(hashes[i]) & mask), i};
+  }
+  uint64_t version = dir_version_.load();
+  directory_latch_.RUnlock();
+
+  // 按bucket分组，每个bucket只pin、加锁一次
+  std::sort(probes.begin(), probes.end());
+  Page *next_page = FetchPage(probes[0].first);
+  for (size_t begin = 0, end = 0; begin < probes.size(); begin = end) {
+    page_id_t page_id = probes[begin].first;
+    while (end < probes.size() && probes[end].first == page_id) {
+      end++;
+    }
+    Page *page = next_page;
+    // 查当前bucket之前先pin住下一个bucket，并预取它开头的bitmap和fingerprint
+    next_page = end < probes.size() ? FetchPage(probes[end].first) : nullptr;
+    if (next_page != nullptr) {
+      for (size_t offset = 0; offset < 512; offset += 64) {
+        __builtin_prefetch(next_page->GetData() + offset);
+      }
+    }
+
+    page->RLatch();
+    if (dir_version_.load() != version) {
+      // 目录在此期间被分裂/合并修改过，这一组退回逐个查找
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      for (size_t i = begin; i < end; i++) {
+        GetValue(transaction, keys[probes[i].second], &(*results)[probes[i].second]);
+      }
+      continue;
+    }
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(page);
+    for (size_t i = begin; i < end; i++) {
+      uint32_t idx = probes[i].second;
+      bucket->GetValue(keys[idx], comparator_, &(*results)[idx], HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hashes[idx]),
+                       unique_keys_);
+    }
+    for (page_id_t next_id = bucket->GetNextPageId(); next_id != INVALID_PAGE_ID;) {
+      HASH_TABLE_BUCKET_TYPE *overflow = FetchBucketPage(FetchPage(next_id));
+      for (size_t i = begin; i < end; i++) {
+        uint32_t idx = probes[i].second;
+        if (unique_keys_ && !(*results)[idx].empty()) {
+          continue;
+        }
+        overflow->GetValue(keys[idx], comparator_, &(*results)[idx],
+                           HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hashes[idx]), unique_keys_);
+      }
+      page_id_t cur_id = next_id;
+      next_id = overflow->GetNextPageId();
+      buffer_pool_manager_->UnpinPage(cur_id, false);
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
 }
 
 /*****************************************************************************
@@ -119,112 +354,287 @@ bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  page_id_t page_id = KeyToPageId(key, dir_page);
-  Page *page = FetchPage(page_id);
-  page->WLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(page);
-  if (!bucket_page->IsFull()) {
-    bool ok = bucket_page->Insert(key, value, comparator_);
+  uint64_t hash = hash_fn_.GetHash(key);
+  uint8_t fingerprint = HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hash);
+  while (true) {
+    uint64_t version;
+    page_id_t page_id = ReadDirectory(hash, &version);
+    Page *page = FetchPage(page_id);
+    page->WLatch();
+    if (dir_version_.load() != version) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      continue;
+    }
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(page);
+    if (bucket_page->GetNextPageId() == INVALID_PAGE_ID && !bucket_page->IsFull()) {
+      bool ok = bucket_page->Insert(key, value, comparator_, fingerprint, unique_keys_);
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, ok);
+      return ok;
+    }
+
+    // 有溢出链或者主bucket满了：整条链上查重，同时找第一个有空位的页，并判断链上是否只有一个key，
+    // 而且就是要插入的key；要插入的是另一个key时，分裂可以把它和链上的key分开
+    bool duplicate = false;
+    bool single_key = bucket_page->IsFull() && fingerprint == bucket_page->FingerprintAt(0) &&
+                      comparator_(key, bucket_page->KeyAt(0)) == 0;
+    page_id_t free_id = INVALID_PAGE_ID;
+    page_id_t tail_id = page_id;
+    for (HASH_TABLE_BUCKET_TYPE *cur = bucket_page;;) {
+      duplicate = unique_keys_ ? cur->ContainsKey(key, comparator_, fingerprint)
+                               : cur->Contains(key, value, comparator_, fingerprint);
+      if (free_id == INVALID_PAGE_ID && !cur->IsFull()) {
+        free_id = tail_id;
+      }
+      single_key = single_key &&
+                   cur->AllKeysEqual(bucket_page->KeyAt(0), comparator_, bucket_page->FingerprintAt(0));
+      page_id_t next_id = cur->GetNextPageId();
+      if (tail_id != page_id) {
+        buffer_pool_manager_->UnpinPage(tail_id, false);
+      }
+      if (duplicate || next_id == INVALID_PAGE_ID) {
+        break;
+      }
+      tail_id = next_id;
+      cur = FetchBucketPage(FetchPage(next_id));
+    }
+
+    if (duplicate) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      return false;
+    }
+    if (free_id != INVALID_PAGE_ID) {
+      HASH_TABLE_BUCKET_TYPE *target = free_id == page_id ? bucket_page : FetchBucketPage(FetchPage(free_id));
+      bool ok = target->Insert(key, value, comparator_, fingerprint);
+      if (free_id != page_id) {
+        buffer_pool_manager_->UnpinPage(free_id, ok);
+      }
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, ok);
+      return ok;
+    }
+
+    // 整条链都满了。链上的pair属于不同的key时分裂bucket，分裂完成后重新定位再插入；
+    // 全是同一个key（分裂永远分不开）或者已经到了最大深度时，在链尾接一个溢出页
+    if (!single_key && SplitBucket(key, page_id, bucket_page)) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      // 放掉bucket的锁之后再写回目录；写不回的切片留到下一次写回
+      FlushDirectory();
+      continue;
+    }
+    HASH_TABLE_BUCKET_TYPE *tail = tail_id == page_id ? bucket_page : FetchBucketPage(FetchPage(tail_id));
+    HASH_TABLE_BUCKET_TYPE *overflow = AppendOverflowPage(page_id, tail, &tail_id);
+    bool ok = overflow->Insert(key, value, comparator_, fingerprint);
+    buffer_pool_manager_->UnpinPage(tail_id, true);
     page->WUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, true);
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.RUnlock();
     return ok;
   }
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page_id, false);
-  buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-  table_latch_.RUnlock();
-  return SplitInsert(transaction, key, value);
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.WLock();  // writers are splits and merges
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  uint32_t bucket_local_depth = dir_page->GetLocalDepth(bucket_id);
+bool HASH_TABLE_TYPE::SplitBucket(const KeyType &key, page_id_t bucket_page_id, HASH_TABLE_BUCKET_TYPE *bucket) {
+  // 持有bucket写锁期间，这个bucket的local depth不会被其他线程修改，短暂读一下即可
+  directory_latch_.RLock();
+  uint32_t local_depth = dir_.GetLocalDepth(KeyToDirectoryIndex(key, &dir_));
+  directory_latch_.RUnlock();
 
   // hash表已经不能再扩容了
-  if (bucket_local_depth >= MAX_GLOBAL_DEPTH) {
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.WUnlock();
+  if (local_depth >= MAX_GLOBAL_DEPTH) {
     return false;
   }
 
-  // hash表可以再扩容，但是bucket_local_depth == global_depth
-  // 需要首先扩容Directory表
-  if (bucket_local_depth == dir_page->GetGlobalDepth()) {
-    dir_page->IncrGlobalDepth();
-  }
-
-  // 先增加local_depth,这一步很关键，想想逻辑
-  dir_page->IncrLocalDepth(bucket_id);
-
-  // 更新old bucket的信息
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  Page *old_page = FetchPage(bucket_page_id);
-  old_page->WLatch();
-  HASH_TABLE_BUCKET_TYPE *old_bucket = FetchBucketPage(old_page);
-  uint32_t num = old_bucket->NumReadable();
-  MappingType *temp_old_pairs = old_bucket->GetMappingTypeArray();
-  old_bucket->Init();
-
-  // 创建一个新的bucket
+  // 创建一个新的bucket作为split image，此时它还没有发布到目录中，其他线程看不到
   page_id_t image_page_id;
   Page *image_page = buffer_pool_manager_->NewPage(&image_page_id);
   assert(image_page != nullptr);
   image_page->WLatch();
   HASH_TABLE_BUCKET_TYPE *image_bucket = FetchBucketPage(image_page);
-  uint32_t split_image_index = dir_page->GetSplitImageIndex(bucket_id);
-  dir_page->SetLocalDepth(split_image_index, dir_page->GetLocalDepth(bucket_id));
-  dir_page->SetBucketPageId(split_image_index, image_page_id);
-
-  for (uint32_t i = 0; i < num; i++) {
-    uint32_t new_bucket_id = Hash(temp_old_pairs[i].first) & dir_page->GetLocalDepthMask(bucket_id);
-    page_id_t temp_page_id = dir_page->GetBucketPageId(new_bucket_id);
-    assert(temp_page_id == bucket_page_id || temp_page_id == image_page_id);
-    if (temp_page_id == bucket_page_id) {
-      old_bucket->Insert(temp_old_pairs[i].first, temp_old_pairs[i].second, comparator_);
+  image_bucket->Init();
+
+  // 沿着溢出链逐页按照新增加的那一位hash把pair原地分到两边，image放不下时给image接溢出页；
+  // 原链上被搬空的溢出页摘下来删除。溢出页只在持有主bucket写锁时访问，这一步不需要目录锁
+  uint32_t high_bit = 1 << local_depth;
+  HASH_TABLE_BUCKET_TYPE *image_tail = image_bucket;
+  page_id_t image_tail_id = image_page_id;
+  HASH_TABLE_BUCKET_TYPE *prev = nullptr;
+  page_id_t prev_id = INVALID_PAGE_ID;
+  HASH_TABLE_BUCKET_TYPE *cur = bucket;
+  page_id_t cur_id = bucket_page_id;
+  while (true) {
+    while (!cur->SplitTo(image_tail, high_bit, &hash_fn_)) {
+      image_tail = AppendOverflowPage(image_page_id, image_tail, &image_tail_id);
+    }
+    page_id_t next_id = cur->GetNextPageId();
+    if (cur_id != bucket_page_id && cur->IsEmpty()) {
+      prev->SetNextPageId(next_id);
+      buffer_pool_manager_->UnpinPage(cur_id, false);
+      buffer_pool_manager_->DeletePage(cur_id);
     } else {
-      image_bucket->Insert(temp_old_pairs[i].first, temp_old_pairs[i].second, comparator_);
+      if (prev_id != INVALID_PAGE_ID && prev_id != bucket_page_id) {
+        buffer_pool_manager_->UnpinPage(prev_id, true);
+      }
+      prev = cur;
+      prev_id = cur_id;
+    }
+    if (next_id == INVALID_PAGE_ID) {
+      break;
     }
+    cur_id = next_id;
+    cur = FetchBucketPage(FetchPage(next_id));
   }
-  delete[] temp_old_pairs;
-
-  // 上面只修改了原bucket与image_bucket的相关信息，
-  // 实际上可能之前存在许多bucket映射到bucket对应的page上,这些信息也要相应的修改
-  uint32_t step = 1 << (dir_page->GetLocalDepth(bucket_id));
-  for (uint32_t i = bucket_id; i >= step; i -= step) {
-    dir_page->SetBucketPageId(i, bucket_page_id);
-    dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(bucket_id));
+  if (prev_id != bucket_page_id) {
+    buffer_pool_manager_->UnpinPage(prev_id, true);
   }
-  for (uint32_t i = bucket_id; i < dir_page->Size(); i += step) {
-    dir_page->SetBucketPageId(i, bucket_page_id);
-    dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(bucket_id));
+  if (image_tail_id != image_page_id) {
+    buffer_pool_manager_->UnpinPage(image_tail_id, true);
   }
-  for (uint32_t i = split_image_index; i >= step; i -= step) {
-    dir_page->SetBucketPageId(i, image_page_id);
-    dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(split_image_index));
+
+  // 短暂持有目录写锁，发布新的映射关系
+  directory_latch_.WLock();
+  // hash表可以再扩容，但是bucket_local_depth == global_depth
+  // 需要首先扩容Directory表
+  if (local_depth == dir_.GetGlobalDepth()) {
+    dir_.IncrGlobalDepth();
   }
-  for (uint32_t i = split_image_index; i < dir_page->Size(); i += step) {
-    dir_page->SetBucketPageId(i, image_page_id);
-    dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(split_image_index));
+  // 所有指向原bucket的目录项，按新增的那一位分别指向原bucket和image
+  uint32_t step = high_bit;
+  for (uint32_t i = KeyToDirectoryIndex(key, &dir_) & (high_bit - 1); i < dir_.Size(); i += step) {
+    assert(dir_.GetBucketPageId(i) == bucket_page_id);
+    dir_.SetLocalDepth(i, local_depth + 1);
+    if ((i & high_bit) != 0) {
+      dir_.SetBucketPageId(i, image_page_id);
+    }
   }
+  dir_version_++;
+  directory_latch_.WUnlock();
 
-  old_page->WUnlatch();
   image_page->WUnlatch();
-
-  // Unpin 这三页数据
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
   buffer_pool_manager_->UnpinPage(image_page_id, true);
-  buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), true);
-  table_latch_.WUnlock();
+  return true;
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::BulkLoad(Transaction *transaction, const std::vector<MappingType> &pairs) {
+  std::vector<uint64_t> hashes(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    hashes[i] = hash_fn_.GetHash(pairs[i].first);
+  }
+
+  // 按hash低位倒序排序后，同一个目录前缀下的pair在order中是连续的一段，
+  // 再按下一位划分只需要找到这一位由0变1的位置
+  const uint32_t max_mask = (1U << MAX_GLOBAL_DEPTH) - 1;
+  std::vector<uint32_t> reversed(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    uint32_t low_bits = static_cast<uint32_t>(hashes[i]) & max_mask;
+    for (uint32_t bit = 0; bit < MAX_GLOBAL_DEPTH; bit++) {
+      reversed[i] = (reversed[i] << 1) | ((low_bits >> bit) & 1);
+    }
+  }
+  std::vector<uint32_t> order(pairs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    if (reversed[a] != reversed[b]) {
+      return reversed[a] < reversed[b];
+    }
+    return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : a < b;
+  });
+  if (unique_keys_) {
+    // 相同的key hash一定相同，排序后落在同一段hash相同的pair里，每个key只保留第一个pair
+    auto duplicate = [&](size_t k) {
+      for (size_t j = k; j > 0 && hashes[order[j - 1]] == hashes[order[k]]; j--) {
+        if (comparator_(pairs[order[j - 1]].first, pairs[order[k]].first) == 0) {
+          return true;
+        }
+      }
+      return false;
+    };
+    std::vector<uint32_t> kept;
+    for (size_t k = 0; k < order.size(); k++) {
+      if (!duplicate(k)) {
+        kept.push_back(order[k]);
+      }
+    }
+    order.swap(kept);
+  }
+
+  // 递归地划分，直到每一份都能放进一个bucket，这样在写任何页之前就确定了
+  // 每个bucket的local depth以及global depth
+  struct Partition {
+    uint32_t prefix;
+    uint32_t depth;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Partition> buckets;
+  std::vector<Partition> pending{{0, 0, 0, order.size()}};
+  uint32_t global_depth = 0;
+  while (!pending.empty()) {
+    Partition part = pending.back();
+    pending.pop_back();
+    // hash低位完全相同的pair再怎么分裂也分不开，只能放到溢出页里；
+    // 除了其中最大的一组之外剩下的pair不到半页时就停止划分
+    size_t largest_run = 0;
+    for (size_t k = part.begin, run = 0; k < part.end; k++) {
+      run = (k > part.begin && reversed[order[k]] == reversed[order[k - 1]]) ? run + 1 : 1;
+      largest_run = std::max(largest_run, run);
+    }
+    size_t count = part.end - part.begin;
+    if (count <= BUCKET_ARRAY_SIZE || count - largest_run <= BUCKET_ARRAY_SIZE / 2 || part.depth == MAX_GLOBAL_DEPTH) {
+      buckets.push_back(part);
+      global_depth = std::max(global_depth, part.depth);
+      continue;
+    }
+    uint32_t high_bit = 1U << part.depth;
+    auto mid = std::partition_point(order.begin() + part.begin, order.begin() + part.end,
+                                    [&](uint32_t i) { return (hashes[i] & high_bit) == 0; });
+    size_t split = mid - order.begin();
+    pending.push_back({part.prefix, part.depth + 1, part.begin, split});
+    pending.push_back({part.prefix | high_bit, part.depth + 1, split, part.end});
+  }
+
+  directory_latch_.WLock();
+  assert(dir_.GetGlobalDepth() == 0);
+  buffer_pool_manager_->DeletePage(dir_.GetBucketPageId(0));
+  while (dir_.GetGlobalDepth() < global_depth) {
+    dir_.IncrGlobalDepth();
+  }
+
+  // 每个bucket页只写一次；只有分不开的partition才会用到溢出页
+  for (const Partition &part : buckets) {
+    page_id_t bucket_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&bucket_page_id);
+    assert(page != nullptr);
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(page);
+    bucket->Init();
+    HASH_TABLE_BUCKET_TYPE *tail = bucket;
+    page_id_t tail_id = bucket_page_id;
+    for (size_t k = part.begin; k < part.end; k++) {
+      uint32_t i = order[k];
+      if (tail->IsFull()) {
+        tail = AppendOverflowPage(bucket_page_id, tail, &tail_id);
+      }
+      tail->Insert(pairs[i].first, pairs[i].second, comparator_, HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hashes[i]));
+    }
+    if (tail_id != bucket_page_id) {
+      buffer_pool_manager_->UnpinPage(tail_id, true);
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
 
-  // 再次尝试插入数据
-  return Insert(transaction, key, value);
+    for (uint32_t i = part.prefix; i < dir_.Size(); i += 1U << part.depth) {
+      dir_.SetBucketPageId(i, bucket_page_id);
+      dir_.SetLocalDepth(i, part.depth);
+    }
+  }
+  dir_version_++;
+  directory_latch_.WUnlock();
+  FlushDirectory();
 }
 
 /*****************************************************************************
@@ -232,96 +642,193 @@ bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.RLock();  // Readers includes inserts and removes
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_id);
-  Page *page = FetchPage(bucket_page_id);
-  page->WLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(page);
-  bool ok = bucket->Remove(key, value, comparator_);
-
-  // 如果当前bucket空了，则执行合并
-  if (bucket->IsEmpty()) {
+  uint64_t hash = hash_fn_.GetHash(key);
+  uint8_t fingerprint = HASH_TABLE_BUCKET_TYPE::HashToFingerprint(hash);
+  while (true) {
+    uint64_t version;
+    page_id_t bucket_page_id = ReadDirectory(hash, &version);
+    Page *page = FetchPage(bucket_page_id);
+    page->WLatch();
+    if (dir_version_.load() != version) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      continue;
+    }
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(page);
+    bool ok = bucket->Remove(key, value, comparator_, fingerprint);
+    // 主bucket中没有，沿着溢出链继续找；溢出页被删空时从链上摘下来删除
+    HASH_TABLE_BUCKET_TYPE *prev = bucket;
+    page_id_t prev_id = bucket_page_id;
+    for (page_id_t next_id = bucket->GetNextPageId(); !ok && next_id != INVALID_PAGE_ID;) {
+      page_id_t cur_id = next_id;
+      HASH_TABLE_BUCKET_TYPE *cur = FetchBucketPage(FetchPage(cur_id));
+      ok = cur->Remove(key, value, comparator_, fingerprint);
+      next_id = cur->GetNextPageId();
+      if (ok && cur->IsEmpty()) {
+        prev->SetNextPageId(next_id);
+        buffer_pool_manager_->UnpinPage(cur_id, false);
+        buffer_pool_manager_->DeletePage(cur_id);
+        break;
+      }
+      if (prev_id != bucket_page_id) {
+        buffer_pool_manager_->UnpinPage(prev_id, ok);
+      }
+      prev = cur;
+      prev_id = cur_id;
+    }
+    if (prev_id != bucket_page_id) {
+      buffer_pool_manager_->UnpinPage(prev_id, ok);
+    }
+    bool empty = bucket->IsEmpty() && bucket->GetNextPageId() == INVALID_PAGE_ID;
     page->WUnlatch();
-    // Unpin
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.RUnlock();
-    Merge(transaction, key, value);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, ok);
+
+    // 如果当前bucket空了（并且没有溢出页），记录下来等待批量合并
+    if (ok && empty) {
+      DeferMerge(hash);
+    }
     return ok;
   }
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-  table_latch_.RUnlock();
-  return ok;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.WLock();  // writers are splits and merges
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_id);
-  uint32_t image_bucket_id = dir_page->GetSplitImageIndex(bucket_id);
-
-  // local depth为0说明已经最小了，不收缩
-  uint32_t local_depth = dir_page->GetLocalDepth(bucket_id);
-  if (local_depth == 0) {
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.WUnlock();
-    return;
+bool HASH_TABLE_TYPE::Merge(uint64_t hash) {
+  while (true) {
+    directory_latch_.RLock();
+    uint32_t bucket_id = static_cast<uint32_t>(hash) & dir_.GetGlobalDepthMask();
+    page_id_t bucket_page_id = dir_.GetBucketPageId(bucket_id);
+    uint32_t local_depth = dir_.GetLocalDepth(bucket_id);
+    // local depth为0说明已经最小了，不收缩；如果该bucket与其split image深度不同，也不收缩
+    if (local_depth == 0 || local_depth != dir_.GetLocalDepth(dir_.GetSplitImageIndex(bucket_id))) {
+      directory_latch_.RUnlock();
+      return false;
+    }
+    page_id_t image_page_id = dir_.GetBucketPageId(dir_.GetSplitImageIndex(bucket_id));
+    uint64_t version = dir_version_.load();
+    directory_latch_.RUnlock();
+
+    // 两个bucket按页号顺序加锁，避免两个合并线程互相等待
+    Page *bucket_page = FetchPage(bucket_page_id);
+    Page *image_page = FetchPage(image_page_id);
+    Page *first = bucket_page_id < image_page_id ? bucket_page : image_page;
+    Page *second = bucket_page_id < image_page_id ? image_page : bucket_page;
+    first->WLatch();
+    second->WLatch();
+    if (dir_version_.load() != version) {
+      second->WUnlatch();
+      first->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      buffer_pool_manager_->UnpinPage(image_page_id, false);
+      continue;
+    }
+
+    // 从记录到合并之间其他线程可能又向此bucket插入了数据，所以需要再检查一遍是否为空
+    HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(bucket_page);
+    bool empty = bucket->IsEmpty() && bucket->GetNextPageId() == INVALID_PAGE_ID;
+    if (empty) {
+      // 短暂持有目录写锁，将所有指向bucket的目录项重新指向image_bucket
+      directory_latch_.WLock();
+      uint32_t step = 1 << (local_depth - 1);
+      for (uint32_t i = bucket_id & (step - 1); i < dir_.Size(); i += step) {
+        dir_.SetBucketPageId(i, image_page_id);
+        dir_.SetLocalDepth(i, local_depth - 1);
+      }
+      dir_version_++;
+      directory_latch_.WUnlock();
+    }
+    second->WUnlatch();
+    first->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+    buffer_pool_manager_->UnpinPage(image_page_id, false);
+    if (empty) {
+      // 删除bucket，此时该bucket已经不在目录中；若有迟到的读者仍pin着它，删除会失败，页面留给缓冲池换出
+      buffer_pool_manager_->DeletePage(bucket_page_id);
+    }
+    return empty;
   }
+}
 
-  // 如果该bucket与其split image深度不同，也不收缩
-  if (local_depth != dir_page->GetLocalDepth(image_bucket_id)) {
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.WUnlock();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::DeferMerge(uint64_t hash) {
+  std::unique_lock<std::mutex> lock(merge_mutex_);
+  empty_buckets_.push_back(hash);
+  if (merge_thread_running_) {
+    if (empty_buckets_.size() >= MERGE_BATCH_SIZE) {
+      merge_cv_.notify_one();
+    }
     return;
   }
+  // 没有后台线程时由Remove立即合并，后台线程停止前留下的bucket也一起合并
+  lock.unlock();
+  MergeEmptyBuckets();
+}
 
-  // 下面之所以在检查一遍是否为空是因为并发执行的原因，在上一个函数已经完全释放了锁
-  // 当执行到此处时，其他线程可能已经修改了此bucket，导致此时bucket不为空了，所以需要再检查一遍
-  Page *bucket_page = FetchPage(bucket_page_id);
-  bucket_page->RLatch();
-  HASH_TABLE_BUCKET_TYPE *bucket = FetchBucketPage(bucket_page);
-  if (!bucket->IsEmpty()) {
-    bucket_page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), false);
-    table_latch_.WUnlock();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::MergeEmptyBuckets() {
+  std::vector<uint64_t> batch;
+  {
+    std::lock_guard<std::mutex> guard(merge_mutex_);
+    batch.swap(empty_buckets_);
+  }
+  bool merged = false;
+  for (uint64_t hash : batch) {
+    merged = Merge(hash) || merged;
+  }
+  if (!merged) {
     return;
   }
 
-  bucket_page->RUnlatch();
-  // 删除bucket，此时该bucket已经为空
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-  buffer_pool_manager_->DeletePage(bucket_page_id);
-
-  // 执行合并
-  page_id_t image_page_id = dir_page->GetBucketPageId(image_bucket_id);
-  dir_page->SetBucketPageId(bucket_id, image_page_id);
-  dir_page->DecrLocalDepth(bucket_id);
-  dir_page->DecrLocalDepth(image_bucket_id);
-  assert(dir_page->GetLocalDepth(bucket_id) == dir_page->GetLocalDepth(image_bucket_id));
-
-  // 遍历整个directory，将所有指向bucket_page的bucket全部重新指向image_bucket_page
-  for (uint32_t i = 0; i < dir_page->Size(); i++) {
-    page_id_t temp_page_id = dir_page->GetBucketPageId(i);
-    if (temp_page_id == bucket_page_id || temp_page_id == image_page_id) {
-      dir_page->SetBucketPageId(i, image_page_id);
-      dir_page->SetLocalDepth(i, dir_page->GetLocalDepth(image_bucket_id));
+  // 整批合并完之后才判断global depth是否需要缩减，每批最多缩减一次目录
+  directory_latch_.WLock();
+  if (dir_.CanShrink()) {
+    while (dir_.CanShrink()) {
+      dir_.DecrGlobalDepth();
     }
+    dir_version_++;
   }
+  directory_latch_.WUnlock();
+  FlushDirectory();
+}
 
-  // 判断global_depth是否需要缩减
-  while (dir_page->CanShrink()) {
-    dir_page->DecrGlobalDepth();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StartBackgroundMerge(std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(merge_mutex_);
+  if (merge_thread_running_) {
+    return;
   }
+  merge_thread_running_ = true;
+  stop_merge_thread_ = false;
+  merge_thread_ = std::thread([this, interval] {
+    std::unique_lock<std::mutex> lock(merge_mutex_);
+    while (!stop_merge_thread_) {
+      merge_cv_.wait_for(lock, interval,
+                         [this] { return stop_merge_thread_ || empty_buckets_.size() >= MERGE_BATCH_SIZE; });
+      if (stop_merge_thread_) {
+        break;
+      }
+      if (empty_buckets_.empty()) {
+        continue;
+      }
+      lock.unlock();
+      MergeEmptyBuckets();
+      lock.lock();
+    }
+  });
+}
 
-  assert(buffer_pool_manager_->UnpinPage(dir_page->GetPageId(), true));
-  table_latch_.WUnlock();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StopBackgroundMerge() {
+  {
+    std::lock_guard<std::mutex> guard(merge_mutex_);
+    if (!merge_thread_running_) {
+      return;
+    }
+    stop_merge_thread_ = true;
+  }
+  merge_cv_.notify_one();
+  merge_thread_.join();
+  std::lock_guard<std::mutex> guard(merge_mutex_);
+  merge_thread_running_ = false;
 }
 
 /*****************************************************************************
@@ -329,11 +836,9 @@ void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  table_latch_.RUnlock();
+  directory_latch_.RLock();
+  uint32_t global_depth = dir_.GetGlobalDepth();
+  directory_latch_.RUnlock();
   return global_depth;
 }
 
@@ -342,11 +847,9 @@ uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  directory_latch_.RLock();
+  dir_.VerifyIntegrity();
+  directory_latch_.RUnlock();
 }
 
 /*****************************************************************************
@@ -359,5 +862,7 @@ template class ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>>;
 template class ExtendibleHashTable<GenericKey<16>, RID, GenericComparator<16>>;
 template class ExtendibleHashTable<GenericKey<32>, RID, GenericComparator<32>>;
 template class ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+template class ExtendibleHashTable<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class ExtendibleHashTable<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 }  // namespace bustub
@@ -0,0 +1,127 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_table_directory.cpp
+//
+// Identification: src/container/hash/hash_table_directory.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "container/hash/hash_table_directory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+static_assert((1U << MAX_GLOBAL_DEPTH) == DIRECTORY_ARRAY_SIZE * MAX_DIRECTORY_PAGES,
+              "MAX_GLOBAL_DEPTH must match the capacity of the directory pages");
+
+HashTableDirectory::HashTableDirectory()
+    : local_depths_(1, 0), bucket_page_ids_(1, INVALID_PAGE_ID), dirty_slices_(MAX_DIRECTORY_PAGES, false) {
+  dirty_slices_[0] = true;
+}
+
+void HashTableDirectory::SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id) {
+  bucket_page_ids_[bucket_idx] = bucket_page_id;
+  MarkDirty(bucket_idx);
+}
+
+void HashTableDirectory::SetLocalDepth(uint32_t bucket_idx, uint8_t local_depth) {
+  assert(local_depth <= global_depth_);
+  local_depths_[bucket_idx] = local_depth;
+  MarkDirty(bucket_idx);
+}
+
+uint32_t HashTableDirectory::GetSplitImageIndex(uint32_t bucket_idx) const {
+  return bucket_idx ^ (1U << (local_depths_[bucket_idx] - 1));
+}
+
+void HashTableDirectory::IncrGlobalDepth() {
+  assert(global_depth_ < MAX_GLOBAL_DEPTH);
+  uint32_t old_size = Size();
+  local_depths_.resize(2 * old_size);
+  bucket_page_ids_.resize(2 * old_size);
+  std::copy(local_depths_.begin(), local_depths_.begin() + old_size, local_depths_.begin() + old_size);
+  std::copy(bucket_page_ids_.begin(), bucket_page_ids_.begin() + old_size, bucket_page_ids_.begin() + old_size);
+  global_depth_++;
+  // 每个目录页都记录了global depth，全部需要重新写回
+  std::fill(dirty_slices_.begin(), dirty_slices_.begin() + NumSlices(), true);
+}
+
+void HashTableDirectory::DecrGlobalDepth() {
+  assert(global_depth_ > 0);
+  global_depth_--;
+  local_depths_.resize(Size());
+  bucket_page_ids_.resize(Size());
+  std::fill(dirty_slices_.begin(), dirty_slices_.begin() + NumSlices(), true);
+}
+
+bool HashTableDirectory::CanShrink() const {
+  if (global_depth_ == 0) {
+    return false;
+  }
+  return std::none_of(local_depths_.begin(), local_depths_.end(),
+                      [this](uint8_t local_depth) { return local_depth == global_depth_; });
+}
+
+void HashTableDirectory::StoreSlice(uint32_t slice, HashTableDirectoryPage *page) {
+  uint32_t begin = slice * DIRECTORY_ARRAY_SIZE;
+  uint32_t end = std::min(Size(), begin + DIRECTORY_ARRAY_SIZE);
+  page->SetGlobalDepth(global_depth_);
+  for (uint32_t i = begin; i < end; i++) {
+    page->SetBucketPageId(i - begin, bucket_page_ids_[i]);
+    page->SetLocalDepth(i - begin, local_depths_[i]);
+  }
+  dirty_slices_[slice] = false;
+}
+
+void HashTableDirectory::VerifyIntegrity() const {
+  //  build maps of {bucket_page_id : pointer_count} and {bucket_page_id : local_depth}
+  std::unordered_map<page_id_t, uint32_t> page_id_to_count;
+  std::unordered_map<page_id_t, uint32_t> page_id_to_ld;
+
+  for (uint32_t curr_idx = 0; curr_idx < Size(); curr_idx++) {
+    page_id_t curr_page_id = bucket_page_ids_[curr_idx];
+    uint32_t curr_ld = local_depths_[curr_idx];
+    assert(curr_ld <= global_depth_);
+
+    ++page_id_to_count[curr_page_id];
+
+    if (page_id_to_ld.count(curr_page_id) > 0 && curr_ld != page_id_to_ld[curr_page_id]) {
+      LOG_WARN("Verify Integrity: curr_local_depth: %u, old_local_depth %u, for page_id: %u", curr_ld,
+               page_id_to_ld[curr_page_id], curr_page_id);
+      PrintDirectory();
+      assert(curr_ld == page_id_to_ld[curr_page_id]);
+    } else {
+      page_id_to_ld[curr_page_id] = curr_ld;
+    }
+  }
+
+  for (const auto &[curr_page_id, curr_count] : page_id_to_count) {
+    uint32_t required_count = 0x1 << (global_depth_ - page_id_to_ld[curr_page_id]);
+    if (curr_count != required_count) {
+      LOG_WARN("Verify Integrity: curr_count: %u, required_count %u, for page_id: %u", curr_count, required_count,
+               curr_page_id);
+      PrintDirectory();
+      assert(curr_count == required_count);
+    }
+  }
+}
+
+void HashTableDirectory::PrintDirectory() const {
+  LOG_DEBUG("======== DIRECTORY (global_depth_: %u) ========", global_depth_);
+  LOG_DEBUG("| bucket_idx | page_id | local_depth |");
+  for (uint32_t idx = 0; idx < Size(); idx++) {
+    LOG_DEBUG("|      %u     |     %u     |     %u     |", idx, bucket_page_ids_[idx], local_depths_[idx]);
+  }
+  LOG_DEBUG("================ END DIRECTORY ================");
+}
+
+}  // namespace bustub
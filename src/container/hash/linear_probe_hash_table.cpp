@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -23,46 +24,373 @@
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                      const KeyComparator &comparator, size_t num_buckets,
-                                      HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {}
+LINEAR_PROBE_HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                                   const KeyComparator &comparator, size_t num_buckets,
+                                                   HashFunction<KeyType> hash_fn, bool unique_keys)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      unique_keys_(unique_keys) {
+  array_ = NewBlockArray(std::min(num_buckets, HashTableHeaderPage::MaxBlocks() * BLOCK_ARRAY_SIZE));
+  if (array_ == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate the blocks of the hash table");
+  }
+  header_page_id_ = array_->header_page_id_;
+}
+
+/*****************************************************************************
+ * HELPERS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+std::unique_ptr<typename LINEAR_PROBE_HASH_TABLE_TYPE::BlockArray> LINEAR_PROBE_HASH_TABLE_TYPE::NewBlockArray(
+    size_t num_slots) {
+  size_t num_blocks = num_slots == 0 ? 1 : (num_slots - 1) / BLOCK_ARRAY_SIZE + 1;
+  if (num_blocks > HashTableHeaderPage::MaxBlocks()) {
+    return nullptr;
+  }
+
+  auto array = std::make_unique<BlockArray>();
+  Page *page = buffer_pool_manager_->NewPage(&array->header_page_id_);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  auto *header_page = reinterpret_cast<HashTableHeaderPage *>(page->GetData());
+  header_page->SetPageId(array->header_page_id_);
+  // 新页已经被清零，所有slot都是空的，不需要再初始化
+  for (size_t i = 0; i < num_blocks; i++) {
+    page_id_t block_page_id;
+    if (buffer_pool_manager_->NewPage(&block_page_id) == nullptr) {
+      // buffer pool满了，删掉已经分配的页
+      buffer_pool_manager_->UnpinPage(array->header_page_id_, false);
+      DeleteBlockArray(array.get());
+      return nullptr;
+    }
+    header_page->AddBlockPageId(block_page_id);
+    array->block_page_ids_.push_back(block_page_id);
+    buffer_pool_manager_->UnpinPage(block_page_id, true);
+  }
+  array->num_slots_ = num_blocks * BLOCK_ARRAY_SIZE;
+  header_page->SetSize(array->num_slots_);
+  buffer_pool_manager_->UnpinPage(array->header_page_id_, true);
+  return array;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::DeleteBlockArray(BlockArray *array) {
+  for (page_id_t block_page_id : array->block_page_ids_) {
+    buffer_pool_manager_->DeletePage(block_page_id);
+  }
+  buffer_pool_manager_->DeletePage(array->header_page_id_);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_BLOCK_TYPE *LINEAR_PROBE_HASH_TABLE_TYPE::FetchBlockPage(Page *page) {
+  return reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(page->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visitor>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Probe(BlockArray *array, uint64_t hash, bool exclusive, Visitor &&visit) {
+  size_t num_blocks = array->block_page_ids_.size();
+  size_t slot = hash % array->num_slots_;
+  size_t block_index = slot / BLOCK_ARRAY_SIZE;
+  slot_offset_t offset = slot % BLOCK_ARRAY_SIZE;
+  bool stopped = false;
+  bool finished = false;
+  for (size_t probed = 0; probed < array->num_slots_ && !stopped && !finished;) {
+    page_id_t page_id = array->block_page_ids_[block_index];
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    assert(page != nullptr);
+    exclusive ? page->WLatch() : page->RLatch();
+    HASH_TABLE_BLOCK_TYPE *block = FetchBlockPage(page);
+    for (; offset < BLOCK_ARRAY_SIZE && probed < array->num_slots_; offset++, probed++) {
+      if (!block->IsOccupied(offset)) {
+        finished = true;
+        break;
+      }
+      if (block->IsReadable(offset) && visit(block, offset)) {
+        stopped = true;
+        break;
+      }
+    }
+    exclusive ? page->WUnlatch() : page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, exclusive && stopped);
+    block_index = (block_index + 1) % num_blocks;
+    offset = 0;
+  }
+  return stopped;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::Lookup(BlockArray *array, const KeyType &key, uint64_t hash,
+                                          std::vector<ValueType> *result) {
+  Probe(array, hash, false, [&](HASH_TABLE_BLOCK_TYPE *block, slot_offset_t offset) {
+    if (comparator_(key, block->KeyAt(offset)) == 0) {
+      result->push_back(block->ValueAt(offset));
+      return unique_keys_;
+    }
+    return false;
+  });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Contains(BlockArray *array, const KeyType &key, const ValueType &value,
+                                            uint64_t hash) {
+  return Probe(array, hash, false, [&](HASH_TABLE_BLOCK_TYPE *block, slot_offset_t offset) {
+    return comparator_(key, block->KeyAt(offset)) == 0 && (unique_keys_ || value == block->ValueAt(offset));
+  });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::RemoveFrom(BlockArray *array, const KeyType &key, const ValueType &value,
+                                              uint64_t hash) {
+  return Probe(array, hash, true, [&](HASH_TABLE_BLOCK_TYPE *block, slot_offset_t offset) {
+    if (comparator_(key, block->KeyAt(offset)) == 0 && value == block->ValueAt(offset)) {
+      block->Remove(offset);
+      return true;
+    }
+    return false;
+  });
+}
+
+/* 探测序列上第一个空slot或tombstone所在的block一直持有写锁，直到确认后面没有重复的pair才插入。
+   latch总是沿探测方向获取，数组最多一半被占用，探测序列不会绕满一圈，所以不会死锁
+*/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::InsertInto(BlockArray *array, const KeyType &key, const ValueType &value,
+                                              uint64_t hash, bool check_duplicate) {
+  size_t num_blocks = array->block_page_ids_.size();
+  size_t slot = hash % array->num_slots_;
+  size_t block_index = slot / BLOCK_ARRAY_SIZE;
+  slot_offset_t offset = slot % BLOCK_ARRAY_SIZE;
+  Page *target_page = nullptr;
+  slot_offset_t target_offset = 0;
+  bool duplicate = false;
+  bool finished = false;
+  for (size_t probed = 0; probed < array->num_slots_ && !duplicate && !finished;) {
+    page_id_t page_id = array->block_page_ids_[block_index];
+    Page *page;
+    if (target_page != nullptr && target_page->GetPageId() == page_id) {
+      // 绕回了目标slot所在的block，已经持有它的写锁
+      page = target_page;
+    } else {
+      page = buffer_pool_manager_->FetchPage(page_id);
+      assert(page != nullptr);
+      page->WLatch();
+    }
+    HASH_TABLE_BLOCK_TYPE *block = FetchBlockPage(page);
+    for (; offset < BLOCK_ARRAY_SIZE && probed < array->num_slots_; offset++, probed++) {
+      if (block->IsReadable(offset)) {
+        if (check_duplicate && comparator_(key, block->KeyAt(offset)) == 0 &&
+            (unique_keys_ || value == block->ValueAt(offset))) {
+          duplicate = true;
+          break;
+        }
+        continue;
+      }
+      if (target_page == nullptr) {
+        target_page = page;
+        target_offset = offset;
+      }
+      // 从未被占用过的slot是探测序列的终点；不检查重复时第一个空位就够了
+      if (!block->IsOccupied(offset) || !check_duplicate) {
+        finished = true;
+        break;
+      }
+    }
+    if (page != target_page) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    block_index = (block_index + 1) % num_blocks;
+    offset = 0;
+  }
+
+  if (target_page == nullptr) {
+    return false;
+  }
+  bool inserted = false;
+  if (!duplicate) {
+    HASH_TABLE_BLOCK_TYPE *target_block = FetchBlockPage(target_page);
+    if (!target_block->IsOccupied(target_offset)) {
+      array->num_occupied_++;
+    }
+    inserted = target_block->Insert(target_offset, key, value);
+  }
+  page_id_t target_page_id = target_page->GetPageId();
+  target_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(target_page_id, inserted);
+  return inserted;
+}
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key,
+                                            std::vector<ValueType> *result) {
+  uint64_t hash = hash_fn_.GetHash(key);
+  size_t begin = result->size();
+  table_latch_.RLock();
+  // 迁移中先查旧数组再查新数组：一个pair在两次查找之间被迁移时会在两边都被看到，
+  // 但不会两边都错过；(key, value)是唯一的，去掉重复的value即可
+  if (old_array_ != nullptr) {
+    Lookup(old_array_.get(), key, hash, result);
+  }
+  size_t old_end = result->size();
+  // key唯一时旧数组中找到了就不用再查新数组
+  if (!unique_keys_ || old_end == begin) {
+    Lookup(array_.get(), key, hash, result);
+  }
+  table_latch_.RUnlock();
+
+  if (old_end > begin) {
+    auto old_begin = result->begin() + begin;
+    auto old_last = result->begin() + old_end;
+    auto in_old = [&](const ValueType &value) { return std::find(old_begin, old_last, value) != old_last; };
+    result->erase(std::remove_if(old_last, result->end(), in_old), result->end());
+  }
+  return result->size() > begin;
 }
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  uint64_t hash = hash_fn_.GetHash(key);
+  table_latch_.RLock();
+  // 迁移中新的pair只插入新数组，但重复检查要先查旧数组
+  bool inserted = (old_array_ == nullptr || !Contains(old_array_.get(), key, value, hash)) &&
+                  InsertInto(array_.get(), key, value, hash, true);
+  size_t size = array_->num_slots_;
+  bool grow = array_->num_occupied_ * 2 > size &&
+              2 * array_->block_page_ids_.size() <= HashTableHeaderPage::MaxBlocks();
+  bool migrated_last = MigrateStep();
+  table_latch_.RUnlock();
+
+  if (migrated_last) {
+    FinishMigration();
+  }
+  if (grow) {
+    Resize(size);
+  }
+  return inserted;
 }
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  uint64_t hash = hash_fn_.GetHash(key);
+  table_latch_.RLock();
+  bool removed = (old_array_ != nullptr && RemoveFrom(old_array_.get(), key, value, hash)) ||
+                 RemoveFrom(array_.get(), key, value, hash);
+  bool migrated_last = MigrateStep();
+  table_latch_.RUnlock();
+
+  if (migrated_last) {
+    FinishMigration();
+  }
+  return removed;
 }
 
 /*****************************************************************************
  * RESIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Resize(size_t initial_size) {}
+void LINEAR_PROBE_HASH_TABLE_TYPE::Resize(size_t initial_size) {
+  table_latch_.WLock();
+  if (array_->num_slots_ >= 2 * initial_size) {
+    // 别的线程已经扩容过了
+    table_latch_.WUnlock();
+    return;
+  }
+  // 上一次扩容还没迁移完的block在这里一次迁移完
+  if (old_array_ != nullptr) {
+    for (size_t i = next_migrate_block_; i < old_array_->block_page_ids_.size(); i++) {
+      MigrateBlock(i);
+    }
+    DeleteBlockArray(old_array_.get());
+    old_array_.reset();
+  }
+  auto array = NewBlockArray(2 * initial_size);
+  if (array == nullptr) {
+    LOG_WARN("linear probe hash table cannot grow past %zu slots", array_->num_slots_);
+    table_latch_.WUnlock();
+    return;
+  }
+  old_array_ = std::move(array_);
+  array_ = std::move(array);
+  header_page_id_ = array_->header_page_id_;
+  next_migrate_block_ = 0;
+  num_migrated_blocks_ = 0;
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::MigrateStep() {
+  if (old_array_ == nullptr) {
+    return false;
+  }
+  size_t num_blocks = old_array_->block_page_ids_.size();
+  size_t block_index = next_migrate_block_++;
+  if (block_index >= num_blocks) {
+    return false;
+  }
+  MigrateBlock(block_index);
+  return ++num_migrated_blocks_ == num_blocks;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::MigrateBlock(size_t block_index) {
+  page_id_t page_id = old_array_->block_page_ids_[block_index];
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  assert(page != nullptr);
+  page->WLatch();
+  HASH_TABLE_BLOCK_TYPE *block = FetchBlockPage(page);
+  // 持有旧block的写锁直到它的pair都写入新数组，并发的查找/删除要么在旧block中看到pair，要么在新数组中看到
+  for (slot_offset_t offset = 0; offset < BLOCK_ARRAY_SIZE; offset++) {
+    if (!block->IsReadable(offset)) {
+      continue;
+    }
+    KeyType key = block->KeyAt(offset);
+    [[maybe_unused]] bool moved = InsertInto(array_.get(), key, block->ValueAt(offset), hash_fn_.GetHash(key), false);
+    assert(moved);
+    block->Remove(offset);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::FinishMigration() {
+  table_latch_.WLock();
+  if (old_array_ != nullptr && num_migrated_blocks_ == old_array_->block_page_ids_.size()) {
+    DeleteBlockArray(old_array_.get());
+    old_array_.reset();
+  }
+  table_latch_.WUnlock();
+}
 
 /*****************************************************************************
  * GETSIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-size_t HASH_TABLE_TYPE::GetSize() {
-  return 0;
+size_t LINEAR_PROBE_HASH_TABLE_TYPE::GetSize() {
+  table_latch_.RLock();
+  size_t size = array_->num_slots_;
+  table_latch_.RUnlock();
+  return size;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::IsResizing() {
+  table_latch_.RLock();
+  bool resizing = old_array_ != nullptr;
+  table_latch_.RUnlock();
+  return resizing;
 }
 
 template class LinearProbeHashTable<int, int, IntComparator>;
@@ -72,5 +400,7 @@ template class LinearProbeHashTable<GenericKey<8>, RID, GenericComparator<8>>;
 template class LinearProbeHashTable<GenericKey<16>, RID, GenericComparator<16>>;
 template class LinearProbeHashTable<GenericKey<32>, RID, GenericComparator<32>>;
 template class LinearProbeHashTable<GenericKey<64>, RID, GenericComparator<64>>;
+template class LinearProbeHashTable<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class LinearProbeHashTable<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 }  // namespace bustub
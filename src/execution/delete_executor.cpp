@@ -57,8 +57,8 @@ bool DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) {
     if (ok) {
       for (auto &indexinfo : catalog_->GetTableIndexes(table_info_->name_)) {
         indexinfo->index_->DeleteEntry(
-            tuple_t.first.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetKeySchema()),
-                                       indexinfo->index_->GetKeyAttrs()),
+            tuple_t.first.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetEntrySchema()),
+                                       indexinfo->index_->GetEntryAttrs()),
             tuple_t.second, exec_ctx_->GetTransaction());
         // 更新索引写集
         IndexWriteRecord index_write_record(tuple_t.second, table_info_->oid_, WType::DELETE, tuple_t.first,
@@ -11,12 +11,314 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "storage/index/integer_key.h"
+#include "type/value_factory.h"
+
 namespace bustub {
+
+namespace {
+// the entries of a B+ tree index on keys of KeyType, read by reopening the tree iterator for every batch
+template <typename KeyType, typename KeyComparator>
+class BPlusTreeCursor : public IndexScanExecutor::EntryCursor {
+  using TreeIndex = BPlusTreeIndex<KeyType, RID, KeyComparator>;
+
+ public:
+  BPlusTreeCursor(TreeIndex *index, const KeyType &begin, const std::optional<KeyType> &end,
+                  const std::optional<Value> &last)
+      : index_(index), resume_(begin), end_(end), last_(last) {}
+
+  bool NextBatch(std::vector<RID> *rids, std::vector<std::vector<Value>> *entries) override {
+    if (done_) {
+      return false;
+    }
+    Schema *entry_schema = index_->GetEntrySchema();
+    auto iterator = end_.has_value() ? index_->GetBeginIterator(resume_, *end_) : index_->GetBeginIterator(resume_);
+    for (; !iterator.IsEnd(); ++iterator) {
+      const KeyType &key = (*iterator).first;
+      // 一个key的所有value放在同一批里，下一批从下一个key重新定位
+      if (rids->size() >= BATCH_SIZE && !(key == rids_key_)) {
+        resume_ = key;
+        return true;
+      }
+      if (last_.has_value() && key.ToValue(entry_schema, 0).CompareGreaterThan(*last_) == CmpBool::CmpTrue) {
+        break;
+      }
+      rids_key_ = key;
+      rids->push_back((*iterator).second);
+      if (entries == nullptr) {
+        continue;
+      }
+      std::vector<Value> values;
+      values.reserve(entry_schema->GetColumnCount());
+      for (uint32_t i = 0; i < entry_schema->GetColumnCount(); i++) {
+        values.push_back(key.ToValue(entry_schema, i));
+      }
+      entries->push_back(std::move(values));
+    }
+    // 迭代器析构时放掉叶子的latch
+    done_ = true;
+    return !rids->empty();
+  }
+
+ private:
+  static constexpr size_t BATCH_SIZE = 64;
+
+  TreeIndex *index_;
+  // the first key of the next batch
+  KeyType resume_;
+  // the scan stops at end_, or after the entries whose first column is at most last_
+  std::optional<KeyType> end_;
+  std::optional<Value> last_;
+  // the key of the last entry read
+  KeyType rids_key_;
+  bool done_{false};
+};
+
+// the key of the first entry whose first column is value, or of the first entry of all without value
+template <typename KeyType>
+std::optional<KeyType> LowestKey(Index *index, const std::optional<Value> &value) {
+  Schema *entry_schema = index->GetEntrySchema();
+  std::vector<Value> values;
+  values.reserve(entry_schema->GetColumnCount());
+  for (const Column &column : entry_schema->GetColumns()) {
+    values.push_back(ValueFactory::GetNullValueByType(column.GetType()));
+  }
+  if (value.has_value()) {
+    values[0] = *value;
+  }
+  KeyType key;
+  try {
+    key.SetFromKey(Tuple(values, entry_schema), entry_schema);
+  } catch (Exception &e) {
+    // 常量比key还长，放弃这个边界
+    return std::nullopt;
+  }
+  return key;
+}
+
+// opens a scan of a B+ tree index on keys of KeyType; null if the index is of another kind
+template <typename KeyType, typename KeyComparator>
+std::unique_ptr<IndexScanExecutor::EntryCursor> OpenBPlusTree(Index *index, const std::optional<Value> &lower,
+                                                               const std::optional<Value> &upper,
+                                                               bool upper_inclusive) {
+  auto *tree = dynamic_cast<BPlusTreeIndex<KeyType, RID, KeyComparator> *>(index);
+  if (tree == nullptr) {
+    return nullptr;
+  }
+  // NULL在key里排在最前面，所以只有第一列的key是这一列等于lower的最小key
+  std::optional<KeyType> begin = LowestKey<KeyType>(index, lower);
+  if (!begin.has_value()) {
+    begin = LowestKey<KeyType>(index, std::nullopt);
+  }
+  std::optional<KeyType> end;
+  std::optional<Value> last;
+  if (upper.has_value() && upper_inclusive) {
+    last = upper;
+  } else if (upper.has_value()) {
+    end = LowestKey<KeyType>(index, upper);
+  }
+  return std::make_unique<BPlusTreeCursor<KeyType, KeyComparator>>(tree, *begin, end, last);
+}
+}  // namespace
+
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {}
+
+void IndexScanExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+  // 谓词是在输出的tuple上求值的，只看输出列就够了
+  index_only_ = true;
+  for (const Column &column : plan_->OutputSchema()->GetColumns()) {
+    index_only_ = index_only_ && IsCovered(column.GetExpr());
+  }
+
+  rids_.clear();
+  rows_.clear();
+  cursor_ = 0;
+  std::optional<Value> lower;
+  std::optional<Value> upper;
+  bool upper_inclusive = false;
+  KeyRange(&lower, &upper, &upper_inclusive);
+  Index *index = index_info_->index_.get();
+  entries_ = OpenBPlusTree<IntegerKey<4>, IntegerComparator<4>>(index, lower, upper, upper_inclusive);
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<IntegerKey<8>, IntegerComparator<8>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<GenericKey<4>, GenericComparator<4>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<GenericKey<8>, GenericComparator<8>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<GenericKey<16>, GenericComparator<16>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<GenericKey<32>, GenericComparator<32>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    entries_ = OpenBPlusTree<GenericKey<64>, GenericComparator<64>>(index, lower, upper, upper_inclusive);
+  }
+  if (entries_ == nullptr) {
+    throw Exception(ExceptionType::NOT_IMPLEMENTED, "Index scan needs a B+ tree index.");
+  }
+}
+
+bool IndexScanExecutor::NextBatch() {
+  rids_.clear();
+  rows_.clear();
+  cursor_ = 0;
+  std::vector<std::vector<Value>> entries;
+  if (!entries_->NextBatch(&rids_, index_only_ ? &entries : nullptr)) {
+    return false;
+  }
+  if (!index_only_) {
+    return true;
+  }
+
+  // 把entry的列放回它们在表中的位置，输出表达式照常在表的schema上求值
+  const Schema &schema = table_info_->schema_;
+  const std::vector<uint32_t> &entry_attrs = index_info_->index_->GetEntryAttrs();
+  std::vector<Value> values;
+  rows_.reserve(entries.size());
+  for (const auto &entry : entries) {
+    values.clear();
+    for (const Column &column : schema.GetColumns()) {
+      values.push_back(ValueFactory::GetNullValueByType(column.GetType()));
+    }
+    for (size_t i = 0; i < entry_attrs.size(); i++) {
+      values[entry_attrs[i]] = entry[i];
+    }
+    rows_.emplace_back(values, &schema);
+  }
+  return true;
+}
+
+bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema *out_schema = plan_->OutputSchema();
+  LockManager *lock_manager = GetExecutorContext()->GetLockManager();
+  Transaction *txn = GetExecutorContext()->GetTransaction();
+  while (cursor_ < rids_.size() || NextBatch()) {
+    RID origin_rid = rids_[cursor_];
+    Tuple table_tuple;
+    const Tuple *source = index_only_ ? &rows_[cursor_] : &table_tuple;
+    cursor_++;
+
+    // 加锁
+    if (lock_manager != nullptr && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
+      lock_manager->LockShared(txn, origin_rid);
+    }
+    bool found = index_only_ || table_info_->table_->GetTuple(origin_rid, &table_tuple, txn);
+    std::vector<Value> values;
+    if (found) {
+      values.reserve(out_schema->GetColumnCount());
+      for (const Column &column : out_schema->GetColumns()) {
+        values.push_back(column.GetExpr()->Evaluate(source, &table_info_->schema_));
+      }
+    }
+    // 解锁,只要read_commit需要在这里解锁，repeatable_read是在commit阶段才解锁
+    if (lock_manager != nullptr && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+      lock_manager->Unlock(txn, origin_rid);
+    }
+    if (!found) {
+      continue;
+    }
+
+    Tuple out_tuple(values, out_schema);
+    const AbstractExpression *predicate = plan_->GetPredicate();
+    if (predicate == nullptr || predicate->Evaluate(&out_tuple, out_schema).GetAs<bool>()) {
+      *tuple = out_tuple;
+      *rid = origin_rid;
+      return true;
+    }
+  }
+  return false;
+}
 
-void IndexScanExecutor::Init() {}
+bool IndexScanExecutor::IsCovered(const AbstractExpression *expr) const {
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr)) {
+    const std::vector<uint32_t> &entry_attrs = index_info_->index_->GetEntryAttrs();
+    return std::find(entry_attrs.begin(), entry_attrs.end(), column->GetColIdx()) != entry_attrs.end();
+  }
+  return std::all_of(expr->GetChildren().begin(), expr->GetChildren().end(),
+                     [this](const AbstractExpression *child) { return IsCovered(child); });
+}
 
-bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+void IndexScanExecutor::KeyRange(std::optional<Value> *lower, std::optional<Value> *upper,
+                                 bool *upper_inclusive) const {
+  const auto *comparison = dynamic_cast<const ComparisonExpression *>(plan_->GetPredicate());
+  if (comparison == nullptr) {
+    return;
+  }
+  ComparisonType type = comparison->GetComparisonType();
+  const auto *column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(1));
+  if (column == nullptr) {
+    // 常量在左边，把比较反过来
+    column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+    constant = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(0));
+    switch (type) {
+      case ComparisonType::LessThan:
+        type = ComparisonType::GreaterThan;
+        break;
+      case ComparisonType::LessThanOrEqual:
+        type = ComparisonType::GreaterThanOrEqual;
+        break;
+      case ComparisonType::GreaterThan:
+        type = ComparisonType::LessThan;
+        break;
+      case ComparisonType::GreaterThanOrEqual:
+        type = ComparisonType::LessThanOrEqual;
+        break;
+      default:
+        break;
+    }
+  }
+  if (column == nullptr || constant == nullptr || column->GetColIdx() >= plan_->OutputSchema()->GetColumnCount()) {
+    return;
+  }
+  // 谓词里的列是输出列，它要正好是key的第一列
+  const auto *key_column = dynamic_cast<const ColumnValueExpression *>(
+      plan_->OutputSchema()->GetColumn(column->GetColIdx()).GetExpr());
+  const Schema *entry_schema = index_info_->index_->GetEntrySchema();
+  if (key_column == nullptr || key_column->GetColIdx() != index_info_->index_->GetEntryAttrs()[0]) {
+    return;
+  }
+  Value value = constant->Evaluate(nullptr, nullptr);
+  if (value.IsNull() || value.GetTypeId() != entry_schema->GetColumn(0).GetType()) {
+    return;
+  }
+  switch (type) {
+    case ComparisonType::Equal:
+      *lower = value;
+      *upper = value;
+      *upper_inclusive = true;
+      break;
+    case ComparisonType::GreaterThan:
+    case ComparisonType::GreaterThanOrEqual:
+      *lower = value;
+      break;
+    case ComparisonType::LessThan:
+      *upper = value;
+      break;
+    case ComparisonType::LessThanOrEqual:
+      *upper = value;
+      *upper_inclusive = true;
+      break;
+    default:
+      break;
+  }
+}
 
 }  // namespace bustub
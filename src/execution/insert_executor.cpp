@@ -66,8 +66,8 @@ void InsertExecutor::InsertIntoTableWithIndex(Tuple *tuple) {
 
   if (okinsert) {
     for (auto &indexinfo : catalog_->GetTableIndexes(tableinfo_->name_)) {
-      indexinfo->index_->InsertEntry(tuple->KeyFromTuple(tableinfo_->schema_, *(indexinfo->index_->GetKeySchema()),
-                                                         indexinfo->index_->GetKeyAttrs()),
+      indexinfo->index_->InsertEntry(tuple->KeyFromTuple(tableinfo_->schema_, *(indexinfo->index_->GetEntrySchema()),
+                                                         indexinfo->index_->GetEntryAttrs()),
                                      new_rid, exec_ctx_->GetTransaction());
       txn->GetIndexWriteSet()->emplace_back(
           IndexWriteRecord(new_rid, tableinfo_->oid_, WType::INSERT, *tuple, indexinfo->index_oid_, catalog_));
@@ -16,10 +16,98 @@ namespace bustub {
 
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      child_executor_(std::move(child_executor)),
+      index_info_(nullptr),
+      table_info_(nullptr),
+      st_(0),
+      child_done_(false) {}
 
-void NestIndexJoinExecutor::Init() {}
+void NestIndexJoinExecutor::Init() {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  table_info_ = catalog->GetTable(plan_->GetInnerTableOid());
+  index_info_ = catalog->GetIndex(plan_->GetIndexName(), table_info_->name_);
+  child_executor_->Init();
+  result_.clear();
+  st_ = 0;
+  child_done_ = false;
+}
 
-bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) {
+  while (st_ == result_.size()) {
+    if (child_done_) {
+      return false;
+    }
+    ProbeBatch();
+  }
+  *tuple = result_[st_];
+  *rid = result_[st_].GetRid();
+  ++st_;
+  return true;
+}
+
+void NestIndexJoinExecutor::ProbeBatch() {
+  result_.clear();
+  st_ = 0;
+
+  // 攒一批外表tuple，用谓词左侧的表达式算出内表索引的key
+  const Schema *outer_schema = child_executor_->GetOutputSchema();
+  const Schema &key_schema = index_info_->key_schema_;
+  std::vector<Tuple> outer_tuples;
+  std::vector<Tuple> keys;
+  outer_tuples.reserve(BATCH_SIZE);
+  keys.reserve(BATCH_SIZE);
+  Tuple outer_tuple;
+  RID outer_rid;
+  while (outer_tuples.size() < BATCH_SIZE) {
+    if (!child_executor_->Next(&outer_tuple, &outer_rid)) {
+      child_done_ = true;
+      break;
+    }
+    Value key_value = plan_->Predicate()->GetChildAt(0)->Evaluate(&outer_tuple, outer_schema);
+    if (key_value.GetTypeId() != key_schema.GetColumn(0).GetType()) {
+      key_value = key_value.CastAs(key_schema.GetColumn(0).GetType());
+    }
+    keys.emplace_back(std::vector<Value>{key_value}, &key_schema);
+    outer_tuples.push_back(outer_tuple);
+  }
+  if (keys.empty()) {
+    return;
+  }
+
+  // 一次批量探测整批key，索引按bucket分组，每个bucket只访问一次
+  Transaction *txn = exec_ctx_->GetTransaction();
+  LockManager *lock_manager = exec_ctx_->GetLockManager();
+  std::vector<std::vector<RID>> inner_rids;
+  index_info_->index_->ScanKeys(keys, &inner_rids, txn);
+
+  const Schema *inner_schema = plan_->InnerTableSchema();
+  const Schema *output_schema = plan_->OutputSchema();
+  for (size_t i = 0; i < outer_tuples.size(); i++) {
+    for (const RID &inner_rid : inner_rids[i]) {
+      if (lock_manager != nullptr && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+          !txn->IsSharedLocked(inner_rid) && !txn->IsExclusiveLocked(inner_rid)) {
+        lock_manager->LockShared(txn, inner_rid);
+      }
+      Tuple inner_tuple;
+      bool found = table_info_->table_->GetTuple(inner_rid, &inner_tuple, txn);
+      if (lock_manager != nullptr && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED &&
+          txn->IsSharedLocked(inner_rid)) {
+        lock_manager->Unlock(txn, inner_rid);
+      }
+      if (!found ||
+          !plan_->Predicate()->EvaluateJoin(&outer_tuples[i], outer_schema, &inner_tuple, inner_schema).GetAs<bool>()) {
+        continue;
+      }
+      std::vector<Value> values;
+      values.reserve(output_schema->GetColumnCount());
+      for (auto &column : output_schema->GetColumns()) {
+        values.push_back(column.GetExpr()->EvaluateJoin(&outer_tuples[i], outer_schema, &inner_tuple, inner_schema));
+      }
+      result_.emplace_back(values, output_schema);
+    }
+  }
+}
 
 }  // namespace bustub
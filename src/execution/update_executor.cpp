@@ -61,12 +61,12 @@ bool UpdateExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) {
       for (auto &indexinfo : catalog_->GetTableIndexes(table_info_->name_)) {
         // 不要求索引并发处理，只更新索引写集就可
         indexinfo->index_->DeleteEntry(
-            tuple_t.first.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetKeySchema()),
-                                       indexinfo->index_->GetKeyAttrs()),
+            tuple_t.first.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetEntrySchema()),
+                                       indexinfo->index_->GetEntryAttrs()),
             tuple_t.second, exec_ctx_->GetTransaction());
         indexinfo->index_->InsertEntry(
-            new_tuple.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetKeySchema()),
-                                   indexinfo->index_->GetKeyAttrs()),
+            new_tuple.KeyFromTuple(table_info_->schema_, *(indexinfo->index_->GetEntrySchema()),
+                                   indexinfo->index_->GetEntryAttrs()),
             tuple_t.second, exec_ctx_->GetTransaction());
         // 添加索引写集
         IndexWriteRecord index_write_record(tuple_t.second, table_info_->oid_, WType::UPDATE, new_tuple,
@@ -14,6 +14,7 @@
 
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -21,8 +22,12 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
+#include "storage/index/generic_key.h"
 #include "storage/index/index.h"
+#include "storage/index/integer_key.h"
+#include "storage/index/linear_probe_hash_table_index.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -34,6 +39,13 @@ using table_oid_t = uint32_t;
 using column_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
+/**
+ * The kinds of index that Catalog::CreateIndex can build.
+ * A B+ tree index keeps its root page id in the header page, which must be
+ * page 0 of the buffer pool.
+ */
+enum class IndexType { ExtendibleHashTableIndex, LinearProbeHashTableIndex, BPlusTreeIndex };
+
 /**
  * The TableInfo class maintains metadata about a table.
  */
@@ -105,6 +117,9 @@ class Catalog {
   /** Indicates that an operation returning a `IndexInfo*` failed */
   static constexpr IndexInfo *NULL_INDEX_INFO{nullptr};
 
+  /** Initial number of slots of a linear probe hash index; the table grows as it fills */
+  static constexpr size_t LINEAR_PROBE_INITIAL_BUCKETS{1024};
+
   /**
    * Construct a new Catalog instance.
    * @param bpm The buffer pool manager backing tables created by this catalog
@@ -186,57 +201,70 @@ class Catalog {
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param index_type The kind of index to build
+   * @param is_unique Whether every key maps to at most one tuple
+   * @param included_attrs Columns stored in the index besides the key, so that scans that only need them never read
+   * the table; only B+ tree indexes have them, and keysize must cover the key and the included columns
    * @return A (non-owning) pointer to the metadata of the new table
+   *
+   * An index asked for on GenericKey whose key is a single integer column and which has no included columns is built
+   * on IntegerKey instead, like CreateIntegerIndex does. The hash function is taken by value, so it is always the
+   * MurmurHash of the key bytes, which the IntegerKey index uses on its own key bytes.
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         std::size_t keysize, HashFunction<KeyType> hash_function) {
-    // Reject the creation request for nonexistent table
-    if (table_names_.find(table_name) == table_names_.end()) {
-      return NULL_INDEX_INFO;
-    }
-
-    // If the table exists, an entry for the table should already be present in index_names_
-    BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
-
-    // Determine if the requested index already exists for this table
-    auto &table_indexes = index_names_.find(table_name)->second;
-    if (table_indexes.find(index_name) != table_indexes.end()) {
-      // The requested index already exists for this table
+                         std::size_t keysize, HashFunction<KeyType> hash_function,
+                         IndexType index_type = IndexType::ExtendibleHashTableIndex, bool is_unique = false,
+                         const std::vector<uint32_t> &included_attrs = {}) {
+    if (!CanCreateIndex(index_name, table_name, index_type, included_attrs)) {
       return NULL_INDEX_INFO;
     }
 
     // Construct index metdata
-    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs, is_unique, included_attrs);
+
+    // 单个整数列的key不用按key schema逐列比较
+    if constexpr (std::is_same_v<KeyType, GenericKey<sizeof(KeyType)>> && std::is_same_v<ValueType, RID> &&
+                  std::is_same_v<KeyComparator, GenericComparator<sizeof(KeyType)>>) {
+      size_t integer_keysize = IntegerKeySize(&key_schema);
+      if (integer_keysize != 0 && included_attrs.empty()) {
+        auto index = MakeIntegerIndex(std::move(meta), index_type, integer_keysize);
+        return AddIndex(txn, index_name, table_name, schema, key_schema, integer_keysize, std::move(index));
+      }
+    }
 
     // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
+    auto index = MakeIndex<KeyType, ValueType, KeyComparator>(std::move(meta), index_type, hash_function);
+    return AddIndex(txn, index_name, table_name, schema, key_schema, keysize, std::move(index));
+  }
 
-    // Populate the index with all tuples in table heap
-    auto *table_meta = GetTable(table_name);
-    auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
+  /**
+   * Create a new index on a single integer column, populate existing data of the table and return its metadata.
+   * The index is built on IntegerKey, which reads the integer straight from the key tuple and compares it without
+   * going through the key schema; a hash index hashes it with the default hash function of IntegerKey.
+   * @param txn The transaction in which the table is being created
+   * @param index_name The name of the new index
+   * @param table_name The name of the table
+   * @param schema The schema of the table
+   * @param key_schema The schema of the key, a single TINYINT, SMALLINT, INTEGER or BIGINT column
+   * @param key_attrs Key attributes
+   * @param index_type The kind of index to build
+   * @param is_unique Whether every key maps to at most one tuple
+   * @return A (non-owning) pointer to the metadata of the new index, or NULL_INDEX_INFO if the key is not a single
+   * integer column
+   */
+  IndexInfo *CreateIntegerIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                                const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
+                                IndexType index_type = IndexType::ExtendibleHashTableIndex, bool is_unique = false) {
+    size_t keysize = IntegerKeySize(&key_schema);
+    if (keysize == 0 || !CanCreateIndex(index_name, table_name, index_type, {})) {
+      return NULL_INDEX_INFO;
     }
 
-    // Get the next OID for the new index
-    const auto index_oid = next_index_oid_.fetch_add(1);
-
-    // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
-    auto *tmp = index_info.get();
-
-    // Update internal tracking
-    indexes_.emplace(index_oid, std::move(index_info));
-    table_indexes.emplace(index_name, index_oid);
-
-    return tmp;
+    auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs, is_unique);
+    auto index = MakeIntegerIndex(std::move(meta), index_type, keysize);
+    return AddIndex(txn, index_name, table_name, schema, key_schema, keysize, std::move(index));
   }
 
   /**
@@ -323,6 +351,86 @@ class Catalog {
   }
 
  private:
+  /** @return whether an index index_name of the given kind may be created on the table table_name */
+  bool CanCreateIndex(const std::string &index_name, const std::string &table_name, IndexType index_type,
+                      const std::vector<uint32_t> &included_attrs) const {
+    // Reject the creation request for nonexistent table
+    if (table_names_.find(table_name) == table_names_.end()) {
+      return false;
+    }
+
+    // Hash indexes only answer point lookups, covering columns are of no use to them
+    if (!included_attrs.empty() && index_type != IndexType::BPlusTreeIndex) {
+      return false;
+    }
+
+    // If the table exists, an entry for the table should already be present in index_names_
+    BUSTUB_ASSERT((index_names_.find(table_name) != index_names_.end()), "Broken Invariant");
+
+    // Determine if the requested index already exists for this table
+    const auto &table_indexes = index_names_.find(table_name)->second;
+    return table_indexes.find(index_name) == table_indexes.end();
+  }
+
+  /** Populates a new index with all tuples of its table and registers it, taking ownership of the index. */
+  IndexInfo *AddIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
+                      const Schema &schema, const Schema &key_schema, std::size_t keysize,
+                      std::unique_ptr<Index> &&index) {
+    // Populate the index with all tuples in table heap
+    auto *table_meta = GetTable(table_name);
+    auto *heap = table_meta->table_.get();
+    auto tuple = heap->Begin(txn);
+    index->BulkLoad(
+        [&](Tuple *key, RID *rid) {
+          if (tuple == heap->End()) {
+            return false;
+          }
+          *key = tuple->KeyFromTuple(schema, *index->GetEntrySchema(), index->GetEntryAttrs());
+          *rid = tuple->GetRid();
+          ++tuple;
+          return true;
+        },
+        txn);
+
+    // Get the next OID for the new index
+    const auto index_oid = next_index_oid_.fetch_add(1);
+
+    // Construct index information; IndexInfo takes ownership of the Index itself
+    auto index_info =
+        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    auto *tmp = index_info.get();
+
+    // Update internal tracking
+    indexes_.emplace(index_oid, std::move(index_info));
+    index_names_.find(table_name)->second.emplace(index_name, index_oid);
+
+    return tmp;
+  }
+
+  /** Builds an index of the given kind on keys of KeyType, taking ownership of its metadata. */
+  template <class KeyType, class ValueType, class KeyComparator>
+  std::unique_ptr<Index> MakeIndex(std::unique_ptr<IndexMetadata> &&meta, IndexType index_type,
+                                   HashFunction<KeyType> hash_function) {
+    if (index_type == IndexType::BPlusTreeIndex) {
+      return std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_);
+    }
+    if (index_type == IndexType::LinearProbeHashTableIndex) {
+      return std::make_unique<LinearProbeHashTableIndex<KeyType, ValueType, KeyComparator>>(
+          std::move(meta), bpm_, LINEAR_PROBE_INITIAL_BUCKETS, hash_function);
+    }
+    return std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
+                                                                                         hash_function);
+  }
+
+  /** Builds an index of the given kind on IntegerKey of keysize bytes, taking ownership of its metadata. */
+  std::unique_ptr<Index> MakeIntegerIndex(std::unique_ptr<IndexMetadata> &&meta, IndexType index_type,
+                                          size_t keysize) {
+    if (keysize == sizeof(uint32_t)) {
+      return MakeIndex<IntegerKey<4>, RID, IntegerComparator<4>>(std::move(meta), index_type, {});
+    }
+    return MakeIndex<IntegerKey<8>, RID, IntegerComparator<8>>(std::move(meta), index_type, {});
+  }
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
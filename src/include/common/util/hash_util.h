@@ -13,7 +13,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -24,27 +26,101 @@ namespace bustub {
 
 using hash_t = std::size_t;
 
+/**
+ * Hash functions for in-memory hash tables (aggregation, distinct, hash join).
+ *
+ * HashBytes reads the input eight bytes at a time and mixes words with a 64x64->128 bit multiply, in the style of
+ * wyhash. The results are not stable across versions and must not be persisted; on-disk indexes hash keys with the
+ * MurmurHash-based HashFunction instead.
+ */
 class HashUtil {
  private:
   static const hash_t PRIME_FACTOR = 10000019;
 
+  static constexpr uint64_t SECRET0 = 0xa0761d6478bd642fULL;
+  static constexpr uint64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+  static constexpr uint64_t SECRET2 = 0x8ebc6af09c88c6e3ULL;
+  static constexpr uint64_t SECRET3 = 0x589965cc75374cc3ULL;
+
+  /** @return the xor of the high and low halves of the 128-bit product */
+  static inline uint64_t Mix(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product >> 64) ^ static_cast<uint64_t>(product);
+  }
+
+  static inline uint64_t Read64(const char *bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+  }
+
+  static inline uint64_t Read32(const char *bytes) {
+    uint32_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+  }
+
+  /** Reads 1-3 bytes: the first, the middle and the last one */
+  static inline uint64_t Read3(const char *bytes, size_t length) {
+    auto *data = reinterpret_cast<const uint8_t *>(bytes);
+    return (static_cast<uint64_t>(data[0]) << 16) | (static_cast<uint64_t>(data[length >> 1]) << 8) | data[length - 1];
+  }
+
  public:
   static inline hash_t HashBytes(const char *bytes, size_t length) {
-    // https://github.com/greenplum-db/gpos/blob/b53c1acd6285de94044ff91fbee91589543feba1/libgpos/src/utils.cpp#L126
-    hash_t hash = length;
-    for (size_t i = 0; i < length; ++i) {
-      hash = ((hash << 5) ^ (hash >> 27)) ^ bytes[i];
+    uint64_t seed = Mix(SECRET0, SECRET1);
+    uint64_t a;
+    uint64_t b;
+    if (length <= 16) {
+      if (length >= 4) {
+        // 两个可能重叠的8字节窗口覆盖全部输入
+        size_t shift = (length >> 3) << 2;
+        a = (Read32(bytes) << 32) | Read32(bytes + shift);
+        b = (Read32(bytes + length - 4) << 32) | Read32(bytes + length - 4 - shift);
+      } else if (length > 0) {
+        a = Read3(bytes, length);
+        b = 0;
+      } else {
+        a = b = 0;
+      }
+    } else {
+      const char *p = bytes;
+      size_t remaining = length;
+      if (remaining > 48) {
+        // 三条独立的乘法链，互不依赖，可以并行执行
+        uint64_t seed1 = seed;
+        uint64_t seed2 = seed;
+        do {
+          seed = Mix(Read64(p) ^ SECRET1, Read64(p + 8) ^ seed);
+          seed1 = Mix(Read64(p + 16) ^ SECRET2, Read64(p + 24) ^ seed1);
+          seed2 = Mix(Read64(p + 32) ^ SECRET3, Read64(p + 40) ^ seed2);
+          p += 48;
+          remaining -= 48;
+        } while (remaining > 48);
+        seed ^= seed1 ^ seed2;
+      }
+      while (remaining > 16) {
+        seed = Mix(Read64(p) ^ SECRET1, Read64(p + 8) ^ seed);
+        p += 16;
+        remaining -= 16;
+      }
+      // 最后16字节从末尾读取，可能与前面的数据重叠
+      a = Read64(p + remaining - 16);
+      b = Read64(p + remaining - 8);
     }
-    return hash;
+    __uint128_t product = static_cast<__uint128_t>(a ^ SECRET1) * (b ^ seed);
+    return Mix(static_cast<uint64_t>(product) ^ SECRET0 ^ length, static_cast<uint64_t>(product >> 64) ^ SECRET1);
   }
 
-  static inline hash_t CombineHashes(hash_t l, hash_t r) {
-    hash_t both[2] = {};
-    both[0] = l;
-    both[1] = r;
-    return HashBytes(reinterpret_cast<char *>(both), sizeof(hash_t) * 2);
+  /** @return the hash of a 64-bit integer, equal for every integer type holding the same number */
+  static inline hash_t HashInt(uint64_t value) {
+    // 一次乘法的低位只取决于输入的低位，再混合一轮让高位也影响到低位
+    __uint128_t product = static_cast<__uint128_t>(value ^ SECRET0) * SECRET1;
+    return Mix(static_cast<uint64_t>(product) ^ SECRET0, static_cast<uint64_t>(product >> 64) ^ SECRET1);
   }
 
+  static inline hash_t CombineHashes(hash_t l, hash_t r) { return Mix(l ^ SECRET2, r ^ SECRET3); }
+
   static inline hash_t SumHashes(hash_t l, hash_t r) { return (l % PRIME_FACTOR + r % PRIME_FACTOR) % PRIME_FACTOR; }
 
   template <typename T>
@@ -60,42 +136,26 @@ class HashUtil {
   /** @return the hash of the value */
   static inline hash_t HashValue(const Value *val) {
     switch (val->GetTypeId()) {
-      case TypeId::TINYINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int8_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::SMALLINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int16_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::INTEGER: {
-        auto raw = static_cast<int64_t>(val->GetAs<int32_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::BIGINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int64_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::BOOLEAN: {
-        auto raw = val->GetAs<bool>();
-        return Hash<bool>(&raw);
-      }
+      case TypeId::TINYINT:
+        return HashInt(static_cast<int64_t>(val->GetAs<int8_t>()));
+      case TypeId::SMALLINT:
+        return HashInt(static_cast<int64_t>(val->GetAs<int16_t>()));
+      case TypeId::INTEGER:
+        return HashInt(static_cast<int64_t>(val->GetAs<int32_t>()));
+      case TypeId::BIGINT:
+        return HashInt(static_cast<int64_t>(val->GetAs<int64_t>()));
+      case TypeId::BOOLEAN:
+        return HashInt(static_cast<uint64_t>(val->GetAs<bool>()));
       case TypeId::DECIMAL: {
         auto raw = val->GetAs<double>();
         return Hash<double>(&raw);
       }
-      case TypeId::VARCHAR: {
-        auto raw = val->GetData();
-        auto len = val->GetLength();
-        return HashBytes(raw, len);
-      }
-      case TypeId::TIMESTAMP: {
-        auto raw = val->GetAs<uint64_t>();
-        return Hash<uint64_t>(&raw);
-      }
-      default: {
-        BUSTUB_ASSERT(false, "Unsupported type.");
-      }
+      case TypeId::VARCHAR:
+        return HashBytes(val->GetData(), val->GetLength());
+      case TypeId::TIMESTAMP:
+        return HashInt(val->GetAs<uint64_t>());
+      default:
+        UNREACHABLE("Unsupported type.");
     }
   }
 };
@@ -12,15 +12,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
+#include "container/hash/hash_table_directory.h"
 #include "storage/page/hash_table_bucket_page.h"
-#include "storage/page/hash_table_directory_page.h"
+#include "storage/page/hash_table_header_page.h"
 
 namespace bustub {
 
@@ -30,6 +37,34 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * A full bucket is split only if its pairs belong to more than one key. Pairs of
+ * a single key can never be separated by a split, so such a bucket (or any
+ * bucket at MAX_GLOBAL_DEPTH) instead grows a chain of overflow pages that is
+ * protected by the latch of the primary bucket page.
+ *
+ * The directory is cached in memory for the lifetime of the table and written
+ * back whenever a split or merge changes it, so a point operation only fetches
+ * the bucket page from the buffer pool. On disk the directory is spread over as
+ * many directory pages as it needs (up to MAX_DIRECTORY_PAGES). Index pages list
+ * the directory pages and the header page lists the index pages; only the
+ * directory pages a change touched are written back.
+ *
+ * Concurrency control is optimistic at the bucket level: an operation reads the
+ * directory under a short directory latch, latches the bucket page and then
+ * validates that the directory version did not change in between. Splits and
+ * merges only latch the affected bucket pair and bump the version inside a short
+ * directory critical section, so they never block operations on other buckets.
+ *
+ * Merging can be deferred: Remove records the buckets it emptied, and
+ * MergeEmptyBuckets merges them in batches, shrinking the directory at most once
+ * per batch. With StartBackgroundMerge a maintenance thread runs the batches,
+ * as ExtendibleHashTableIndex does for the whole life of the index; a table
+ * used directly without the thread has Remove run MergeEmptyBuckets right away.
+ *
+ * A table created with unique_keys holds at most one value per key: Insert
+ * rejects a key that is already present, and lookups stop at the first match
+ * instead of scanning the rest of the bucket and its overflow chain.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +75,17 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param unique_keys whether every key maps to at most one value
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               bool unique_keys = false);
+
+  /**
+   * Stops the background merge thread, if any. Buckets still waiting to be merged
+   * stay unmerged; the destructor does not touch the buffer pool.
+   */
+  ~ExtendibleHashTable();
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -50,7 +93,7 @@ class ExtendibleHashTable {
    * @param transaction the current transaction
    * @param key the key to create
    * @param value the value to be associated with the key
-   * @return true if insert succeeded, false otherwise
+   * @return true if insert succeeded, false if the pair (or, with unique keys, the key) already exists
    */
   bool Insert(Transaction *transaction, const KeyType &key, const ValueType &value);
 
@@ -74,6 +117,67 @@ class ExtendibleHashTable {
    */
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result);
 
+  /**
+   * Streams the values associated with a key to a callback, one bucket page of the
+   * overflow chain at a time, instead of collecting them. The bucket is read latched
+   * while the callback runs, so the callback must not access the hash table.
+   *
+   * @param transaction the current transaction
+   * @param key the key to look up
+   * @param callback called once per value; returning false stops the scan
+   * @return true if at least one value was found
+   */
+  bool GetValue(Transaction *transaction, const KeyType &key, const std::function<bool(const ValueType &)> &callback);
+
+  /**
+   * Performs a point query for a batch of keys. The keys are hashed up front and
+   * mapped to buckets under a single directory latch, then grouped by bucket so
+   * that every bucket page is pinned and latched once for all of its keys. The
+   * next bucket page is pinned and prefetched while the current one is probed.
+   *
+   * @param transaction the current transaction
+   * @param keys the keys to look up
+   * @param[out] results results->at(i) receives the values associated with keys[i]
+   */
+  void GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                 std::vector<std::vector<ValueType>> *results);
+
+  /**
+   * Builds the table from a set of pairs in one pass. The pairs are hashed and
+   * recursively partitioned by the low bits of their hash until every partition
+   * fits in a bucket, which fixes the local depth of every bucket and the global
+   * depth before anything is written. Each bucket page is then written exactly
+   * once and the directory is written back once.
+   *
+   * Must be called on a newly created, empty table before it is shared with
+   * other threads. The pairs must be distinct; with unique keys only the first
+   * pair of every key is loaded.
+   *
+   * @param transaction the current transaction
+   * @param pairs the key-value pairs to load
+   */
+  void BulkLoad(Transaction *transaction, const std::vector<MappingType> &pairs);
+
+  /**
+   * Merges the buckets that Remove recorded as empty and then shrinks the
+   * directory as far as possible, writing it back once for the whole batch.
+   */
+  void MergeEmptyBuckets();
+
+  /**
+   * Starts a maintenance thread that runs MergeEmptyBuckets whenever a batch of
+   * empty buckets is pending, and at least once per interval. Must be stopped
+   * before the buffer pool manager is destroyed.
+   *
+   * @param interval the longest time an empty bucket waits to be merged
+   */
+  void StartBackgroundMerge(std::chrono::milliseconds interval);
+
+  /**
+   * Stops the maintenance thread started by StartBackgroundMerge.
+   */
+  void StopBackgroundMerge();
+
   /**
    * Returns the global depth.  Do not touch.
    */
@@ -107,26 +211,30 @@ class ExtendibleHashTable {
    * representation.
    *
    * @param key the key to use for lookup
-   * @param dir_page to use for lookup of global depth
+   * @param dir to use for lookup of global depth
    * @return the directory index
    */
-  inline uint32_t KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page);
+  inline uint32_t KeyToDirectoryIndex(KeyType key, HashTableDirectory *dir);
 
   /**
    * Get the bucket page_id corresponding to a key.
    *
    * @param key the key for lookup
-   * @param dir_page a pointer to the hash table's directory page
+   * @param dir a pointer to the hash table's directory
    * @return the bucket page_id corresponding to the input key
    */
-  inline uint32_t KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page);
+  inline uint32_t KeyToPageId(KeyType key, HashTableDirectory *dir);
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Writes the directory slices that changed since the last write-back to their
+   * directory pages, allocating directory pages as the directory grows and
+   * recording them in the index pages and the header page. Called after every split or merge, with
+   * no page latched; the directory is only latched to copy the slices out.
    *
-   * @return a pointer to the directory page
+   * @return false if the buffer pool had no frame for a page; the slices that
+   * were not written stay dirty for the next write-back
    */
-  HashTableDirectoryPage *FetchDirectoryPage();
+  bool FlushDirectory();
 
   /**
    * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
@@ -137,42 +245,99 @@ class ExtendibleHashTable {
   HASH_TABLE_BUCKET_TYPE *FetchBucketPage(Page *page);
 
   Page *FetchPage(page_id_t bucket_page_id);
+
+  /**
+   * Links a new, initialized overflow page after the tail of a bucket chain. The
+   * caller must hold the write latch of the chain's primary bucket.
+   *
+   * @param head_id page_id of the page the caller keeps pinned; the old tail is unpinned unless it is this page
+   * @param tail the current tail of the chain
+   * @param[in,out] tail_id page_id of the tail, updated to the new overflow page
+   * @return the new overflow page, pinned
+   */
+  HASH_TABLE_BUCKET_TYPE *AppendOverflowPage(page_id_t head_id, HASH_TABLE_BUCKET_TYPE *tail, page_id_t *tail_id);
+
+  /**
+   * Reads the directory entry of a hash under the directory read latch.
+   *
+   * @param hash the full 64-bit hash of the key; its low bits index the directory
+   * @param[out] version the directory version observed together with the entry
+   * @return the bucket page_id corresponding to the hash
+   */
+  page_id_t ReadDirectory(uint64_t hash, uint64_t *version);
+
   /**
-   * Performs insertion with an optional bucket splitting.
+   * Splits a full bucket, including its overflow chain, into itself and a new split
+   * image. The caller must hold the write latch of the bucket page; the directory
+   * is only latched while the new mapping is published. The caller writes the
+   * directory back with FlushDirectory once it has released the bucket.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key to insert
-   * @param value the value to insert
-   * @return whether or not the insertion was successful
+   * @param key the key whose insertion triggered the split
+   * @param bucket_page_id page_id of the full bucket
+   * @param bucket the full bucket, write latched by the caller
+   * @return false if the bucket is already at MAX_GLOBAL_DEPTH
    */
-  bool SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value);
+  bool SplitBucket(const KeyType &key, page_id_t bucket_page_id, HASH_TABLE_BUCKET_TYPE *bucket);
 
   /**
-   * Optionally merges an empty bucket into it's pair.  This is called by Remove,
-   * if Remove makes a bucket empty.
+   * Optionally merges an empty bucket into it's pair.  This is called by
+   * MergeEmptyBuckets for every bucket that Remove made empty.
    *
    * There are three conditions under which we skip the merge:
    * 1. The bucket is no longer empty.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key that was removed
-   * @param value the value that was removed
+   * The directory is not shrunk here; the caller does that once per batch.
+   *
+   * @param hash the hash of a key that was removed from the bucket
+   * @return true if the bucket was merged
    */
-  void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
+  bool Merge(uint64_t hash);
 
-  // 创建Directory的锁
-  std::mutex directory_lock_;
+  /**
+   * Records a bucket that Remove made empty. Without a background merge thread
+   * the pending buckets are merged right away; otherwise the thread is woken
+   * once a full batch is pending.
+   *
+   * @param hash the hash of the key that was removed
+   */
+  void DeferMerge(uint64_t hash);
+
+  // number of pending empty buckets that wakes the background merge thread before its interval
+  static constexpr size_t MERGE_BATCH_SIZE = 64;
 
   // member variables
-  page_id_t directory_page_id_;
+  page_id_t header_page_id_;
+  // 目录在内存中的缓存，由directory_latch_保护，分裂/合并后写回各个目录页
+  HashTableDirectory dir_;
+  ReaderWriterLatch directory_latch_;
+  // 串行化目录的写回；下面几个成员只在写回时访问
+  std::mutex flush_mutex_;
+  std::vector<page_id_t> directory_page_ids_;
+  // 记录目录页页号的索引页，以及已经记录到索引页中的目录页数
+  std::vector<page_id_t> index_page_ids_;
+  size_t indexed_pages_{0};
+  // header页中记录的索引页数和目录大小
+  size_t header_index_pages_{0};
+  size_t header_size_{0};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writers are splits and merges
-  ReaderWriterLatch table_latch_;
+  // 目录版本号，每次分裂/合并修改目录后加一，用于乐观读的校验
+  std::atomic<uint64_t> dir_version_{0};
   HashFunction<KeyType> hash_fn_;
+  // 每个key最多对应一个value
+  const bool unique_keys_;
+
+  // 被删空、等待合并的bucket（记录被删除key的hash），由merge_mutex_保护
+  std::mutex merge_mutex_;
+  std::vector<uint64_t> empty_buckets_;
+  // 后台合并线程
+  std::thread merge_thread_;
+  std::condition_variable merge_cv_;
+  bool merge_thread_running_{false};
+  bool stop_merge_thread_{false};
 };
 
 }  // namespace bustub
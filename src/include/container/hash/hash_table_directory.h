@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_table_directory.h
+//
+// Identification: src/include/container/hash/hash_table_directory.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "common/config.h"
+#include "storage/page/hash_table_directory_page.h"
+#include "storage/page/hash_table_page_defs.h"
+
+namespace bustub {
+
+#define MAX_GLOBAL_DEPTH 22
+
+/**
+ * In-memory directory of an extendible hash table.
+ *
+ * Unlike HashTableDirectoryPage it is not limited to a single page: it grows up to
+ * 2^MAX_GLOBAL_DEPTH entries. On disk the directory is stored in slices of
+ * DIRECTORY_ARRAY_SIZE entries, one HashTableDirectoryPage per slice. The
+ * directory remembers which slices changed since they were last stored so that a
+ * split or merge only writes back the pages it touched.
+ *
+ * The class does no latching of its own; the owning hash table protects it.
+ */
+class HashTableDirectory {
+ public:
+  HashTableDirectory();
+
+  /**
+   * Lookup a bucket page using a directory index
+   *
+   * @param bucket_idx the index in the directory to lookup
+   * @return bucket page_id corresponding to bucket_idx
+   */
+  page_id_t GetBucketPageId(uint32_t bucket_idx) const { return bucket_page_ids_[bucket_idx]; }
+
+  /**
+   * Updates the directory index using a bucket index and page_id
+   *
+   * @param bucket_idx directory index at which to insert page_id
+   * @param bucket_page_id page_id to insert
+   */
+  void SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id);
+
+  /**
+   * Gets the local depth of the bucket at bucket_idx
+   *
+   * @param bucket_idx the bucket index to lookup
+   * @return the local depth of the bucket at bucket_idx
+   */
+  uint32_t GetLocalDepth(uint32_t bucket_idx) const { return local_depths_[bucket_idx]; }
+
+  /**
+   * Set the local depth of the bucket at bucket_idx to local_depth
+   *
+   * @param bucket_idx bucket index to update
+   * @param local_depth new local depth
+   */
+  void SetLocalDepth(uint32_t bucket_idx, uint8_t local_depth);
+
+  /**
+   * @return the global depth of the directory
+   */
+  uint32_t GetGlobalDepth() const { return global_depth_; }
+
+  /**
+   * @return mask of global_depth 1's and the rest 0's (with 1's from LSB upwards)
+   */
+  uint32_t GetGlobalDepthMask() const { return (1U << global_depth_) - 1; }
+
+  /**
+   * @return the current directory size
+   */
+  uint32_t Size() const { return 1U << global_depth_; }
+
+  /**
+   * Gets the split image of an index
+   *
+   * @param bucket_idx the directory index for which to find the split image
+   * @return the directory index of the split image
+   */
+  uint32_t GetSplitImageIndex(uint32_t bucket_idx) const;
+
+  /**
+   * Doubles the directory; the new upper half mirrors the lower half.
+   */
+  void IncrGlobalDepth();
+
+  /**
+   * Halves the directory.
+   */
+  void DecrGlobalDepth();
+
+  /**
+   * @return true if the directory can be shrunk
+   */
+  bool CanShrink() const;
+
+  /**
+   * @return the number of directory pages needed to store the current directory
+   */
+  uint32_t NumSlices() const { return (Size() - 1) / DIRECTORY_ARRAY_SIZE + 1; }
+
+  /**
+   * @return whether the slice changed since it was last stored
+   */
+  bool IsSliceDirty(uint32_t slice) const { return dirty_slices_[slice]; }
+
+  /**
+   * Copies one slice of the directory into a directory page and marks the slice clean.
+   *
+   * @param slice the slice to store
+   * @param page the directory page that backs the slice
+   */
+  void StoreSlice(uint32_t slice, HashTableDirectoryPage *page);
+
+  /**
+   * Marks a slice as changed, so that it is stored again; slices past the end of the directory are ignored.
+   *
+   * @param slice the slice that could not be stored
+   */
+  void MarkSliceDirty(uint32_t slice) {
+    if (slice < dirty_slices_.size()) {
+      dirty_slices_[slice] = true;
+    }
+  }
+
+  /**
+   * Verify the following invariants:
+   * (1) All LD <= GD.
+   * (2) Each bucket has precisely 2^(GD - LD) pointers pointing to it.
+   * (3) The LD is the same at each index with the same bucket_page_id
+   */
+  void VerifyIntegrity() const;
+
+  /**
+   * Prints the current directory
+   */
+  void PrintDirectory() const;
+
+ private:
+  void MarkDirty(uint32_t bucket_idx) { dirty_slices_[bucket_idx / DIRECTORY_ARRAY_SIZE] = true; }
+
+  uint32_t global_depth_{0};
+  std::vector<uint8_t> local_depths_;
+  std::vector<page_id_t> bucket_page_ids_;
+  // 每个切片一个标记，写回时只写被修改过的目录页
+  std::vector<bool> dirty_slices_;
+};
+
+}  // namespace bustub
@@ -12,11 +12,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <string>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
 #include "container/hash/hash_table.h"
@@ -26,12 +29,22 @@
 
 namespace bustub {
 
-#define HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
+#define LINEAR_PROBE_HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
 
 /**
  * Implementation of linear probing hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
- * table dynamically grows once full.
+ * table dynamically grows once half of its slots are occupied.
+ *
+ * The slots are spread over block pages that are listed in a header page.
+ * Growing the table does not rehash everything at once: Resize allocates a
+ * block array twice as large and every later insert or remove migrates one
+ * block of the old array into the new one. While a migration is in progress
+ * lookups consult both arrays, so neither readers nor writers wait for the
+ * whole table to be rehashed.
+ *
+ * A table created with unique_keys holds at most one value per key: Insert
+ * rejects a key that is already present, and a lookup ends at the first match.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator> {
@@ -43,9 +56,12 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
    * @param comparator comparator for keys
    * @param num_buckets initial number of buckets contained by this hash table
    * @param hash_fn the hash function
+   * @param unique_keys whether every key maps to at most one value
+   * @throws Exception OUT_OF_MEMORY if the buffer pool has no frame for the pages of the table
    */
   explicit LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                const KeyComparator &comparator, size_t num_buckets, HashFunction<KeyType> hash_fn);
+                                const KeyComparator &comparator, size_t num_buckets, HashFunction<KeyType> hash_fn,
+                                bool unique_keys = false);
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -75,7 +91,10 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) override;
 
   /**
-   * Resizes the table to at least twice the initial size provided.
+   * Resizes the table to at least twice the initial size provided. Only the new
+   * block array is allocated here; the entries are migrated incrementally by the
+   * following inserts and removes. A migration that is still in progress is
+   * finished first.
    * @param initial_size the initial size of the hash table
    */
   void Resize(size_t initial_size);
@@ -86,7 +105,95 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
    */
   size_t GetSize();
 
+  /**
+   * @return whether blocks of a smaller array are still waiting to be migrated
+   */
+  bool IsResizing();
+
  private:
+  /**
+   * One array of slots: a header page and the block pages it lists.
+   */
+  struct BlockArray {
+    page_id_t header_page_id_;
+    size_t num_slots_;
+    std::vector<page_id_t> block_page_ids_;
+    // 被占用过的slot数（包括tombstone），决定什么时候扩容
+    std::atomic<size_t> num_occupied_{0};
+  };
+
+  /**
+   * Allocates the header page and block pages of an array with at least num_slots slots.
+   * @return the new array, or nullptr if its block page_ids do not fit in a header page or the
+   * buffer pool has no frame for a page; the pages allocated so far are deleted again
+   */
+  std::unique_ptr<BlockArray> NewBlockArray(size_t num_slots);
+
+  /**
+   * Deletes the pages of an array that nobody can reach any more.
+   */
+  void DeleteBlockArray(BlockArray *array);
+
+  HASH_TABLE_BLOCK_TYPE *FetchBlockPage(Page *page);
+
+  /**
+   * Walks the probe sequence of a hash in one array, block by block, until it
+   * reaches a slot that was never occupied. Only one block is latched at a time.
+   *
+   * @param exclusive whether to write latch the blocks instead of read latching them
+   * @param visit called on every readable slot; returning true stops the probe
+   * @return true if visit stopped the probe; the block it stopped in is marked dirty when exclusive
+   */
+  template <typename Visitor>
+  bool Probe(BlockArray *array, uint64_t hash, bool exclusive, Visitor &&visit);
+
+  /**
+   * Collects the values of a key along its probe sequence in one array; with
+   * unique keys the probe stops at the first match.
+   */
+  void Lookup(BlockArray *array, const KeyType &key, uint64_t hash, std::vector<ValueType> *result);
+
+  /**
+   * @return whether the pair (or, with unique keys, the key) is stored in the array
+   */
+  bool Contains(BlockArray *array, const KeyType &key, const ValueType &value, uint64_t hash);
+
+  /**
+   * Inserts a pair into the first free slot or tombstone of its probe sequence.
+   * The block holding that slot stays write latched while the rest of the
+   * sequence is checked for a duplicate, so two inserts of the same pair cannot
+   * both succeed.
+   *
+   * @param check_duplicate false when the caller knows the pair is not in the array
+   * @return false if the pair is a duplicate or the array has no free slot
+   */
+  bool InsertInto(BlockArray *array, const KeyType &key, const ValueType &value, uint64_t hash,
+                  bool check_duplicate);
+
+  /**
+   * Removes a pair from one array, leaving a tombstone.
+   */
+  bool RemoveFrom(BlockArray *array, const KeyType &key, const ValueType &value, uint64_t hash);
+
+  /**
+   * Moves one unclaimed block of the old array into the current array. The caller
+   * holds table_latch_ in read mode.
+   *
+   * @return true if this call migrated the last block of the old array
+   */
+  bool MigrateStep();
+
+  /**
+   * Moves every readable pair of an old block into the current array and
+   * leaves tombstones behind, so probe sequences through the block stay intact.
+   */
+  void MigrateBlock(size_t block_index);
+
+  /**
+   * Drops the old array once all of its blocks have been migrated.
+   */
+  void FinishMigration();
+
   // member variable
   page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
@@ -94,9 +201,17 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
 
   // Readers includes inserts and removes, writer is only resize
   ReaderWriterLatch table_latch_;
+  // 当前的数组，以及扩容时还在迁移的旧数组；两者只在table_latch_写锁下替换
+  std::unique_ptr<BlockArray> array_;
+  std::unique_ptr<BlockArray> old_array_;
+  // 下一个要迁移的旧block，以及已经迁移完的旧block数
+  std::atomic<size_t> next_migrate_block_{0};
+  std::atomic<size_t> num_migrated_blocks_{0};
 
   // Hash function
   HashFunction<KeyType> hash_fn_;
+  // 每个key最多对应一个value
+  const bool unique_keys_;
 };
 
 }  // namespace bustub
@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <vector>
 
+#include "catalog/catalog.h"
 #include "common/rid.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
@@ -23,11 +26,32 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table, in the order of a
+ * B+ tree index. When every column that the output refers to is stored in the
+ * index, as a key column or an included column, the scan is index-only: it
+ * builds its output from the index entries and never reads the table heap.
+ *
+ * Init opens the scan over the key range that the predicate allows on the
+ * first key column, and Next reads the entries from the tree in small batches:
+ * no leaf of the index stays latched between two calls of Next, so that the
+ * executors above may write to the index while it is being scanned.
  */
 
 class IndexScanExecutor : public AbstractExecutor {
  public:
+  /** The entries of an index in key order, read a batch at a time */
+  class EntryCursor {
+   public:
+    virtual ~EntryCursor() = default;
+    /**
+     * Reads the next batch of entries.
+     * @param[out] rids the record ids of the entries
+     * @param[out] entries if not null, the columns of the entries, in the order of the entry schema
+     * @return false if the scan is over
+     */
+    virtual bool NextBatch(std::vector<RID> *rids, std::vector<std::vector<Value>> *entries) = 0;
+  };
+
   /**
    * Creates a new index scan executor.
    * @param exec_ctx the executor context
@@ -41,8 +65,34 @@ class IndexScanExecutor : public AbstractExecutor {
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  /** @return whether the scan builds its output from the index alone; set by Init */
+  bool IsIndexOnly() const { return index_only_; }
+
  private:
+  /** @return whether every column that expr refers to is stored in the index */
+  bool IsCovered(const AbstractExpression *expr) const;
+
+  /**
+   * Finds the bounds that the predicate puts on the first key column, if it compares that column with a constant.
+   * @param[out] lower the lowest value the column may take
+   * @param[out] upper the highest value the column may take, or the first value it may not take
+   * @param[out] upper_inclusive whether upper is a value the column may take
+   */
+  void KeyRange(std::optional<Value> *lower, std::optional<Value> *upper, bool *upper_inclusive) const;
+
+  /** Reads the next batch of entries into rids_, and for an index-only scan rows_; false at the end of the scan */
+  bool NextBatch();
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  TableInfo *table_info_{nullptr};
+  IndexInfo *index_info_{nullptr};
+  bool index_only_{false};
+  std::unique_ptr<EntryCursor> entries_;
+  /** The record ids of the current batch of index entries, in key order */
+  std::vector<RID> rids_;
+  /** For an index-only scan, the rows rebuilt from the entries, with NULL in the columns the index does not store */
+  std::vector<Tuple> rows_;
+  size_t cursor_{0};
 };
 }  // namespace bustub
@@ -48,7 +48,22 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   bool Next(Tuple *tuple, RID *rid) override;
 
  private:
+  /**
+   * Pulls up to BATCH_SIZE outer tuples, probes the index for all of their keys
+   * with one batched ScanKeys call and buffers the joined tuples in result_.
+   */
+  void ProbeBatch();
+
+  /** Number of outer tuples whose keys are probed together. */
+  static constexpr size_t BATCH_SIZE = 64;
+
   /** The nested index join plan node. */
   const NestedIndexJoinPlanNode *plan_;
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  IndexInfo *index_info_;
+  TableInfo *table_info_;
+  std::vector<Tuple> result_;
+  size_t st_;
+  bool child_done_;
 };
 }  // namespace bustub
@@ -10,28 +10,64 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/b_plus_tree_posting_page.h"
 
 namespace bustub {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
+/** The kind of access a descent into the B+ tree is made for. */
+enum class BPlusTreeOperation { READ, INSERT, REMOVE };
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique unless the tree is created without unique_keys; then the
+ *     record ids of a repeated key are kept in a posting list that its leaf
+ *     entry references (see BPlusTreePostingPage)
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * Concurrent access follows the Lehman-Yao B-link protocol. Every page has a
+ * right link to the next page of its level and fence keys bounding the keys of
+ * its subtree. A descent latches one page at a time: it pins the next page
+ * before releasing the current one and, if a concurrent split moved the key out
+ * of a page, follows the right link. Readers therefore never wait for a split
+ * to finish, and the leaf is the only page a writer write latches on its way
+ * down.
+ *
+ * A split latches only the node being split and then its parent, bottom-up, and
+ * inserts the separator into the parent by key. Merges and redistributions keep
+ * the latch crabbing protocol of the pessimistic descent from the root. They
+ * exclude splits through smo_latch_, which splits share. A descent that reaches
+ * a page that was merged away or lost the key to its left sibling restarts from
+ * the root. The root page id is protected by root_latch_.
+ * Iterators hold a read latch on their current leaf only. Leaves are also
+ * linked to the left for reverse scans; a split or merge latches the leaf to
+ * the right of the new or merged page to update its left link.
+ *
+ * Pages compare keys as byte strings, so KeyComparator must order them that
+ * way and say so through IsByteOrdered(); the constructor throws otherwise.
+ *
+ * The tree remembers its rightmost leaf. While keys keep landing there, as
+ * when they increase, Insert goes straight to it instead of descending from
+ * the root, and a page on the right edge that fills up with a new last key is
+ * split unevenly, so that the pages left behind stay nearly full.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -39,8 +75,15 @@ class BPlusTree {
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
 
  public:
+  /** Default fraction of a page filled by BulkLoad, leaving room for later inserts */
+  static constexpr double DEFAULT_FILL_FACTOR = 0.9;
+
+  /** Fraction of a page on the right edge of the tree that stays in it when it splits at its last key */
+  static constexpr double RIGHT_EDGE_SPLIT_FRACTION = 0.9;
+
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     bool unique_keys = true);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -48,15 +91,35 @@ class BPlusTree {
   // Insert a key-value pair into this B+ tree.
   bool Insert(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  // Remove a key and its value from this B+ tree.
+  // Insert a key-value pair unless the tree has a key that same_key accepts; those keys are the first ones from lowest.
+  bool InsertUnique(const KeyType &key, const ValueType &value, const KeyType &lowest,
+                    const std::function<bool(const KeyType &)> &same_key, Transaction *transaction = nullptr);
+
+  // Insert key-value pairs in ascending key order, descending once per leaf; returns how many were inserted.
+  size_t InsertSorted(const std::vector<MappingType> &pairs, Transaction *transaction = nullptr);
+
+  // Remove a key and all its values from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
-  // return the value associated with a given key
+  // Remove a key & value pair from this B+ tree; the key stays while it has other values.
+  void Remove(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
+
+  // Build the tree bottom-up from key & value pairs in ascending key order.
+  void BulkLoad(const std::function<bool(KeyType *key, ValueType *value)> &next,
+                double fill_factor = DEFAULT_FILL_FACTOR, Transaction *transaction = nullptr);
+
+  // return the values associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
+  // iterates over the keys in [begin, end)
+  INDEXITERATOR_TYPE Begin(const KeyType &begin, const KeyType &end);
+  // reverse iterators, from the last key, the last key less than end, or over the keys in [begin, end) backwards
+  INDEXITERATOR_TYPE RBegin();
+  INDEXITERATOR_TYPE RBegin(const KeyType &end);
+  INDEXITERATOR_TYPE RBegin(const KeyType &begin, const KeyType &end);
   INDEXITERATOR_TYPE End();
 
   void Print(BufferPoolManager *bpm) {
@@ -76,29 +139,107 @@ class BPlusTree {
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
-  // expose for test purpose
+  // the leaf is returned pinned and read latched, or nullptr if the tree is empty; iterators descend again through it
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
  private:
+  /*
+   * Path of write latched pages kept by a pessimistic descent, from the topmost
+   * unsafe ancestor down to the current page. A leading nullptr stands for the
+   * root latch, which is held as long as the root may change.
+   */
+  using LatchedPath = std::vector<Page *>;
+
+  Page *FetchTreePage(page_id_t page_id);
+
+  Page *NewTreePage(page_id_t *page_id);
+
+  // deletes a page removed from the tree, or keeps it for ReclaimPages while another thread has it pinned
+  void DeleteTreePage(page_id_t page_id);
+
+  // deletes the kept pages that are no longer pinned
+  void ReclaimPages();
+
+  // B-link descent holding one read latch at a time; the leaf is write latched unless op is READ
+  Page *FindLeafPage(const KeyType &key, bool leftMost, BPlusTreeOperation op, bool rightMost = false);
+
+  // the page a descent visits after the latched node, INVALID_PAGE_ID at the target leaf
+  page_id_t NextPageOnDescent(BPlusTreePage *node, const KeyType &key, bool leftMost, bool rightMost,
+                              bool *restart) const;
+
+  // descends from the root with write latches for a merge; the caller holds the root latch, recorded in path
+  void FindLeafPagePessimistic(const KeyType &key, BPlusTreeOperation op, LatchedPath *path);
+
+  // the parent of a non-root node in path; nodes that may propagate a change keep their parent latched
+  InternalPage *GetLatchedParent(BPlusTreePage *node, LatchedPath *path);
+
+  // whether an insert or remove on node can not propagate to its parent
+  bool IsSafe(BPlusTreePage *node, BPlusTreeOperation op) const;
+
+  // releases all latches in path, including the root latch, and unpins the pages
+  void ReleaseLatches(LatchedPath *path, bool is_dirty);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                        Transaction *transaction = nullptr);
+  // inserts into the rightmost leaf without a descent; returns false, having done nothing, if key is not for it
+  bool AppendToRightmostLeaf(const KeyType &key, const ValueType &value, bool *inserted);
+
+  // inserts into the write latched leaf that covers key and splits it if needed; the caller holds smo_latch_ shared
+  bool InsertIntoLatchedLeaf(Page *page, const KeyType &key, const ValueType &value);
+
+  // old_page is write latched by the caller; its latch and pin are released here
+  void InsertIntoParent(Page *old_page, const KeyType &key, BPlusTreePage *new_node);
 
+  // a split on the right edge of the tree at the last key of node keeps RIGHT_EDGE_SPLIT_FRACTION in node
   template <typename N>
-  N *Split(N *node);
+  N *Split(N *node, const KeyType &key);
+
+  // links page in to the right of the rightmost page of a level during a bulk load
+  template <typename N>
+  void BulkLoadAppend(std::vector<Page *> *levels, size_t level, const KeyType &separator, Page *page,
+                      int internal_fill, double space_fill);
+
+  // deletes a page that is not part of the tree, with everything below it
+  void DeleteSubtree(page_id_t page_id);
+
+  // removes key, or only the pair of key and *value if value is not nullptr
+  void RemoveKey(const KeyType &key, const ValueType *value, Transaction *transaction);
+
+  void RemoveFromLeaf(const KeyType &key, const ValueType *value, Transaction *transaction = nullptr);
+
+  // whether value references a posting list rather than being the only value of its key
+  bool IsPostingList(const ValueType &value) const;
+
+  // appends value, or the values of the posting list it references, to result
+  void CollectValues(const ValueType &value, std::vector<ValueType> *result);
+
+  // the leaf is write latched; returns false if the key at index already has value
+  bool AddToPostingList(LeafPage *leaf, int index, const ValueType &value);
+
+  // the leaf is write latched; returns false if the posting list of the key at index does not have value
+  bool RemoveFromPostingList(LeafPage *leaf, int index, const ValueType &value);
+
+  // the value that stands for the values of a key: the only one, or a reference to a new posting list
+  ValueType NewPostingList(std::vector<ValueType> *values);
+
+  // writes sorted values into page and as many new pages linked after it as needed, and unpins them
+  void WritePostingPages(Page *page, const std::vector<ValueType> &values);
+
+  void DeletePostingList(const ValueType &value);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
+  void CoalesceOrRedistribute(N *node, LatchedPath *path, std::vector<page_id_t> *deleted_pages);
 
   template <typename N>
-  bool Coalesce(N **neighbor_node, N **node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent,
-                int index, Transaction *transaction = nullptr);
+  void Coalesce(N *left, N *right, InternalPage *parent, int right_index, std::vector<page_id_t> *deleted_pages);
+
+  // points the left link of the leaf to the right of leaf back at it
+  void LinkBack(LeafPage *leaf);
 
   template <typename N>
-  void Redistribute(N *neighbor_node, N *node, int index);
+  bool Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index);
 
   bool AdjustRoot(BPlusTreePage *node);
 
@@ -112,10 +253,22 @@ class BPlusTree {
   // member variable
   std::string index_name_;
   page_id_t root_page_id_;
+  // 保护root_page_id_
+  ReaderWriterLatch root_latch_;
+  // 分裂共享读锁，合并和重分配持有写锁，两者不会同时修改树的结构
+  ReaderWriterLatch smo_latch_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  bool unique_keys_;
+  // 最右边的叶子，分裂和合并时更新；持有smo_latch_读锁时它不会被删除
+  std::atomic<page_id_t> rightmost_leaf_id_;
+  // 最近的插入落在最右边的叶子上，下一次插入先试它
+  std::atomic<bool> appending_;
+  // 从树上摘下时还被其他线程pin着的页，之后再删
+  std::mutex pending_latch_;
+  std::vector<page_id_t> pending_pages_;
 };
 
 }  // namespace bustub
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -23,6 +24,13 @@ namespace bustub {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+/**
+ * A B+ tree index. The tree holds index entries: the key columns followed by
+ * the included columns, if the index has any (see IndexMetadata::GetEntrySchema),
+ * so that a scan that only needs those columns never reads the table. Entries
+ * are ordered by all of their columns, and a key is looked up through the
+ * entries that start with it.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
@@ -32,19 +40,40 @@ class BPlusTreeIndex : public Index {
 
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  void BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) override;
+
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
 
+  // iterates over the keys in [begin, end)
+  INDEXITERATOR_TYPE GetBeginIterator(const KeyType &begin, const KeyType &end);
+
+  // iterates backwards from the last key
+  INDEXITERATOR_TYPE GetReverseIterator();
+
+  // iterates backwards over the keys in [begin, end)
+  INDEXITERATOR_TYPE GetReverseIterator(const KeyType &begin, const KeyType &end);
+
   INDEXITERATOR_TYPE GetEndIterator();
 
  protected:
+  // buffer pool that holds the tree and the runs spilled by bulk loading
+  BufferPoolManager *buffer_pool_manager_;
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+
+ private:
+  // the first entry that can hold the key columns of tuple, with NULL included columns, which sort first
+  KeyType LowestEntry(const Tuple &tuple, const Schema *schema) const;
+  // collects the values of the entries from lowest on that have its key columns
+  void ScanEntries(const KeyType &lowest, std::vector<RID> *result);
+  // whether two entries have the same key columns
+  bool SameKey(const KeyType &lhs, const KeyType &rhs) const;
 };
 
 }  // namespace bustub
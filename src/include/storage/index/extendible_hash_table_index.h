@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <chrono>  // NOLINT
 #include <map>
 #include <memory>
 #include <string>
@@ -28,17 +29,34 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
+  /**
+   * Creates the hash table and starts its background merge thread, so that the
+   * buckets DeleteEntry empties are merged off the deleting thread.
+   *
+   * @param merge_interval the longest time an empty bucket waits to be merged
+   */
   ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
-                           const HashFunction<KeyType> &hash_fn);
+                           const HashFunction<KeyType> &hash_fn,
+                           std::chrono::milliseconds merge_interval = DEFAULT_MERGE_INTERVAL);
 
-  ~ExtendibleHashTableIndex() override = default;
+  /**
+   * Stops the background merge thread. The index must be destroyed before its buffer pool manager.
+   */
+  ~ExtendibleHashTableIndex() override;
+
+  static constexpr std::chrono::milliseconds DEFAULT_MERGE_INTERVAL{100};
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
   void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
+  void BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) override;
+
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                Transaction *transaction) override;
+
  protected:
   // comparator for key
   KeyComparator comparator_;
@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sort.h
+//
+// Identification: src/include/storage/index/external_sort.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+#define EXTERNAL_SORT_TYPE ExternalSort<KeyType, ValueType, KeyComparator>
+
+/**
+ * Sorts a stream of key & value pairs that need not fit in memory, e.g. the
+ * entries of an index that is built bottom-up.
+ *
+ * Added pairs are collected into runs of at most memory_limit bytes. A full run
+ * is sorted and spilled to temporary pages of the buffer pool. Once all pairs
+ * are added, Next returns them in key order by merging the runs, at most
+ * MERGE_FAN_IN at a time, so that only a few pages of every run are pinned.
+ * Pairs with equal keys come out in the order they were added. Runs that arrive
+ * in order are not sorted again, and input that fits in one run never touches
+ * the buffer pool. Temporary pages are deleted as soon as they are consumed.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSort {
+ public:
+  /** Number of runs merged in one pass */
+  static constexpr size_t MERGE_FAN_IN{16};
+  /** Default amount of memory, in bytes, used to sort a run */
+  static constexpr size_t DEFAULT_MEMORY_LIMIT{16 << 20};
+
+  ExternalSort(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+               size_t memory_limit = DEFAULT_MEMORY_LIMIT);
+  ~ExternalSort();
+
+  ExternalSort(const ExternalSort &) = delete;
+  ExternalSort &operator=(const ExternalSort &) = delete;
+
+  /** Adds a pair; must not be called after Next. */
+  void Add(const KeyType &key, const ValueType &value);
+
+  /**
+   * Returns the next pair in key order.
+   * @return false once all pairs have been returned
+   */
+  bool Next(KeyType *key, ValueType *value);
+
+  /** @return the number of pairs added */
+  size_t Size() const { return size_; }
+
+  /** @return the number of runs that were spilled to the buffer pool */
+  size_t NumSpilledRuns() const { return num_spilled_runs_; }
+
+ private:
+  // a spilled run, stored in the listed pages in order
+  using Run = std::vector<page_id_t>;
+
+  // reads a spilled run one page at a time, deleting each page once it is consumed
+  struct RunReader {
+    Run pages_;
+    size_t next_page_{0};
+    Page *page_{nullptr};
+    uint32_t index_{0};
+  };
+
+  // merges runs; equal keys come out in run order
+  class Merger {
+   public:
+    Merger(ExternalSort *sort, std::vector<Run> runs);
+    ~Merger();
+    bool Next(MappingType *pair);
+
+   private:
+    bool Advance(RunReader *reader);
+    bool Less(size_t a, size_t b) const;
+
+    ExternalSort *sort_;
+    std::vector<RunReader> readers_;
+    // min heap of the readers that are not exhausted
+    std::vector<size_t> heap_;
+  };
+
+  Page *NewRunPage(page_id_t *page_id);
+  Run WriteRun(const std::function<bool(MappingType *pair)> &next);
+  void SpillBuffer();
+  void Finish();
+
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  size_t run_size_;
+  std::vector<MappingType> buffer_;
+  // 当前内存中的run是否已经有序
+  bool buffer_sorted_{true};
+  std::vector<Run> runs_;
+  size_t size_{0};
+  size_t num_spilled_runs_{0};
+
+  bool finished_{false};
+  size_t buffer_index_{0};
+  std::unique_ptr<Merger> merger_;
+};
+
+}  // namespace bustub
@@ -12,13 +12,191 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
+#include <string>
 
+#include "common/exception.h"
+#include "common/util/hash_util.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 
+/**
+ * Order-preserving encoding of index keys. Fixed-size numbers are stored
+ * big-endian, with the sign bit of integers flipped and all bits of negative
+ * decimals inverted, so that comparing two keys byte by byte gives the order
+ * of their values. NULL, which is a reserved value of each type, sorts first.
+ * When all columns are fixed-size, each column keeps its offset in the key
+ * tuple. Otherwise the columns are stored one after the other: a VARCHAR is
+ * 0x00 if it is NULL, or 0x01, its characters and a terminating 0x00, so a
+ * string sorts before the strings that extend it. A key that does not fit in
+ * the key size throws an OUT_OF_RANGE exception rather than being cut, which
+ * would make keys that only differ past the cut compare equal.
+ */
+class NormalizedKey {
+ public:
+  /** @return whether keys of key_schema are stored in the normalized encoding */
+  static bool IsNormalized(const Schema *key_schema) {
+    for (const Column &column : key_schema->GetColumns()) {
+      if (column.GetType() == TypeId::INVALID) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** @return whether the columns of a key of key_schema are stored one after the other */
+  static bool IsVariableLength(const Schema *key_schema) { return !key_schema->GetUnlinedColumns().empty(); }
+
+  /** Encode a key tuple with variable-length columns into the first size bytes of data; throws if it is longer */
+  static void EncodeVariableLength(const Tuple &tuple, const Schema *key_schema, char *data, size_t size) {
+    std::string key;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      const Column &column = key_schema->GetColumn(i);
+      if (column.IsInlined()) {
+        char buffer[sizeof(uint64_t)];
+        memcpy(buffer, tuple.GetData() + column.GetOffset(), column.GetFixedLength());
+        Encode(buffer, column.GetType());
+        key.append(buffer, column.GetFixedLength());
+        continue;
+      }
+      Value value = tuple.GetValue(key_schema, i);
+      if (value.IsNull()) {
+        key.push_back('\0');
+        continue;
+      }
+      // 长度里包括结尾的'\0'
+      key.push_back('\1');
+      key.append(value.GetData(), strnlen(value.GetData(), value.GetLength()));
+      key.push_back('\0');
+    }
+    if (key.size() > size) {
+      throw Exception(ExceptionType::OUT_OF_RANGE, "index key is longer than the key size");
+    }
+    memcpy(data, key.data(), key.size());
+  }
+
+  /** Decode a column of a key encoded by EncodeVariableLength; a column cut off in a separator key reads as NULL */
+  static Value DecodeVariableLength(const char *data, size_t size, const Schema *key_schema, uint32_t column_idx) {
+    size_t position = 0;
+    for (uint32_t i = 0; i <= column_idx && position < size; i++) {
+      const Column &column = key_schema->GetColumn(i);
+      if (column.IsInlined()) {
+        size_t end = position + column.GetFixedLength();
+        if (i == column_idx && end <= size) {
+          char buffer[sizeof(uint64_t)];
+          memcpy(buffer, data + position, column.GetFixedLength());
+          Decode(buffer, column.GetType());
+          return Value::DeserializeFrom(buffer, column.GetType());
+        }
+        position = end;
+        continue;
+      }
+      if (data[position] == 0) {
+        if (i == column_idx) {
+          break;
+        }
+        position++;
+        continue;
+      }
+      size_t end = position + 1;
+      while (end < size && data[end] != 0) {
+        end++;
+      }
+      if (i == column_idx) {
+        return Value(TypeId::VARCHAR, std::string(data + position + 1, end - position - 1));
+      }
+      position = end + 1;
+    }
+    return ValueFactory::GetNullValueByType(key_schema->GetColumn(column_idx).GetType());
+  }
+
+  /** Encode the serialized value of a column in place */
+  static void Encode(char *data, TypeId type) {
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        data[0] = static_cast<char>(data[0] ^ 0x80);
+        break;
+      case TypeId::SMALLINT:
+        Store(data, __builtin_bswap16(static_cast<uint16_t>(Load<uint16_t>(data) ^ 0x8000U)));
+        break;
+      case TypeId::INTEGER:
+        Store(data, __builtin_bswap32(Load<uint32_t>(data) ^ 0x80000000U));
+        break;
+      case TypeId::BIGINT:
+        Store(data, __builtin_bswap64(Load<uint64_t>(data) ^ SIGN_BIT));
+        break;
+      case TypeId::TIMESTAMP: {
+        // NULL是最大的timestamp，挪到最前面
+        auto timestamp = Load<uint64_t>(data);
+        Store(data, __builtin_bswap64(timestamp == BUSTUB_TIMESTAMP_NULL ? 0 : timestamp + 1));
+        break;
+      }
+      case TypeId::DECIMAL: {
+        auto bits = Load<uint64_t>(data);
+        // -0.0和+0.0作为Value相等，编码成同一个key
+        if (bits == SIGN_BIT) {
+          bits = 0;
+        }
+        Store(data, __builtin_bswap64((bits & SIGN_BIT) != 0 ? ~bits : bits | SIGN_BIT));
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  /** Turn an encoded column back into its serialized value in place */
+  static void Decode(char *data, TypeId type) {
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        Encode(data, type);
+        break;
+      case TypeId::SMALLINT:
+        Store(data, static_cast<uint16_t>(__builtin_bswap16(Load<uint16_t>(data)) ^ 0x8000U));
+        break;
+      case TypeId::INTEGER:
+        Store(data, __builtin_bswap32(Load<uint32_t>(data)) ^ 0x80000000U);
+        break;
+      case TypeId::BIGINT:
+        Store(data, __builtin_bswap64(Load<uint64_t>(data)) ^ SIGN_BIT);
+        break;
+      case TypeId::TIMESTAMP: {
+        uint64_t timestamp = __builtin_bswap64(Load<uint64_t>(data));
+        Store(data, timestamp == 0 ? BUSTUB_TIMESTAMP_NULL : timestamp - 1);
+        break;
+      }
+      case TypeId::DECIMAL: {
+        uint64_t bits = __builtin_bswap64(Load<uint64_t>(data));
+        Store(data, (bits & SIGN_BIT) != 0 ? bits & ~SIGN_BIT : ~bits);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+ private:
+  static constexpr uint64_t SIGN_BIT = 1ULL << 63;
+
+  template <typename T>
+  static T Load(const char *data) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  static void Store(char *data, T value) {
+    memcpy(data, &value, sizeof(T));
+  }
+};
+
 /**
  * Generic key is used for indexing with opaque data.
  *
@@ -29,16 +207,28 @@ namespace bustub {
 template <size_t KeySize>
 class GenericKey {
  public:
-  inline void SetFromKey(const Tuple &tuple) {
+  // key_schema is the schema of tuple, which decides whether the key is normalized
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
     // intialize to 0
     memset(data_, 0, KeySize);
+    if (NormalizedKey::IsNormalized(key_schema) && NormalizedKey::IsVariableLength(key_schema)) {
+      NormalizedKey::EncodeVariableLength(tuple, key_schema, data_, KeySize);
+      return;
+    }
     memcpy(data_, tuple.GetData(), tuple.GetLength());
+    if (NormalizedKey::IsNormalized(key_schema)) {
+      for (const Column &column : key_schema->GetColumns()) {
+        NormalizedKey::Encode(data_ + column.GetOffset(), column.GetType());
+      }
+    }
   }
 
   // NOTE: for test purpose only
+  // the key of a single bigint column
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
     memcpy(data_, &key, sizeof(int64_t));
+    NormalizedKey::Encode(data_, TypeId::BIGINT);
   }
 
   inline Value ToValue(Schema *schema, uint32_t column_idx) const {
@@ -46,6 +236,15 @@ class GenericKey {
     const auto &col = schema->GetColumn(column_idx);
     const TypeId column_type = col.GetType();
     const bool is_inlined = col.IsInlined();
+    if (NormalizedKey::IsNormalized(schema) && NormalizedKey::IsVariableLength(schema)) {
+      return NormalizedKey::DecodeVariableLength(data_, KeySize, schema, column_idx);
+    }
+    if (NormalizedKey::IsNormalized(schema)) {
+      char buffer[sizeof(uint64_t)];
+      memcpy(buffer, data_ + col.GetOffset(), col.GetFixedLength());
+      NormalizedKey::Decode(buffer, column_type);
+      return Value::DeserializeFrom(buffer, column_type);
+    }
     if (is_inlined) {
       data_ptr = (data_ + col.GetOffset());
     } else {
@@ -56,8 +255,15 @@ class GenericKey {
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
-  inline int64_t ToString() const { return *reinterpret_cast<int64_t *>(const_cast<char *>(data_)); }
+  // interpret the first 8 bytes as the int64_t set by SetFromInteger
+  inline int64_t ToString() const {
+    char buffer[sizeof(int64_t)];
+    memcpy(buffer, data_, sizeof(int64_t));
+    NormalizedKey::Decode(buffer, TypeId::BIGINT);
+    int64_t key;
+    memcpy(&key, buffer, sizeof(int64_t));
+    return key;
+  }
 
   // NOTE: for test purpose only
   // interpret the first 8 bytes as int64_t from data vector
@@ -66,17 +272,44 @@ class GenericKey {
     return os;
   }
 
+  // byte-wise equality; keys built by SetFromKey are zero padded, so equal tuples give equal keys
+  bool operator==(const GenericKey &other) const { return memcmp(data_, other.data_, KeySize) == 0; }
+
   // actual location of data, extends past the end.
   char data_[KeySize];
 };
 
 /**
  * Function object returns true if lhs < rhs, used for trees
+ * Normalized keys are compared as byte strings, keys of up to 8 bytes as one
+ * big-endian integer; other keys column by column through Value.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
   inline int operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const {
+    if (normalized_) {
+      if constexpr (KeySize == sizeof(uint64_t)) {
+        uint64_t l;
+        uint64_t r;
+        memcpy(&l, lhs.data_, sizeof(uint64_t));
+        memcpy(&r, rhs.data_, sizeof(uint64_t));
+        l = __builtin_bswap64(l);
+        r = __builtin_bswap64(r);
+        return static_cast<int>(l > r) - static_cast<int>(l < r);
+      } else if constexpr (KeySize == sizeof(uint32_t)) {
+        uint32_t l;
+        uint32_t r;
+        memcpy(&l, lhs.data_, sizeof(uint32_t));
+        memcpy(&r, rhs.data_, sizeof(uint32_t));
+        l = __builtin_bswap32(l);
+        r = __builtin_bswap32(r);
+        return static_cast<int>(l > r) - static_cast<int>(l < r);
+      } else {
+        return memcmp(lhs.data_, rhs.data_, KeySize);
+      }
+    }
+
     uint32_t column_count = key_schema_->GetColumnCount();
 
     for (uint32_t i = 0; i < column_count; i++) {
@@ -94,13 +327,32 @@ class GenericComparator {
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  /** @return whether keys are ordered as byte strings, which B+ tree pages rely on */
+  bool IsByteOrdered() const { return normalized_; }
+
+  GenericComparator(const GenericComparator &other)
+      : key_schema_{other.key_schema_}, normalized_{other.normalized_} {}
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
+  explicit GenericComparator(Schema *key_schema)
+      : key_schema_(key_schema), normalized_(NormalizedKey::IsNormalized(key_schema)) {}
 
  private:
   Schema *key_schema_;
+  // key列的类型都有效时key按字节比较
+  bool normalized_;
 };
 
 }  // namespace bustub
+
+namespace std {
+
+/** Implements std::hash on GenericKey for in-memory hash tables; the key size is a compile-time constant */
+template <size_t KeySize>
+struct hash<bustub::GenericKey<KeySize>> {
+  std::size_t operator()(const bustub::GenericKey<KeySize> &key) const {
+    return bustub::HashUtil::HashBytes(key.data_, KeySize);
+  }
+};
+
+}  // namespace std
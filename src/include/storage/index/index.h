@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -43,14 +44,26 @@ class IndexMetadata {
    * @param table_name The name of the table on which the index is created
    * @param tuple_schema The schema of the indexed key
    * @param key_attrs The mapping from indexed columns to base table columns
+   * @param is_unique Whether every key maps to at most one tuple
+   * @param included_attrs The base table columns stored in the index entries besides the key (covering columns)
    */
   IndexMetadata(std::string index_name, std::string table_name, const Schema *tuple_schema,
-                std::vector<uint32_t> key_attrs)
-      : name_(std::move(index_name)), table_name_(std::move(table_name)), key_attrs_(std::move(key_attrs)) {
+                std::vector<uint32_t> key_attrs, bool is_unique = false,
+                const std::vector<uint32_t> &included_attrs = {})
+      : name_(std::move(index_name)),
+        table_name_(std::move(table_name)),
+        key_attrs_(std::move(key_attrs)),
+        is_unique_(is_unique) {
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
+    entry_attrs_ = key_attrs_;
+    entry_attrs_.insert(entry_attrs_.end(), included_attrs.begin(), included_attrs.end());
+    entry_schema_ = Schema::CopySchema(tuple_schema, entry_attrs_);
   }
 
-  ~IndexMetadata() { delete key_schema_; }
+  ~IndexMetadata() {
+    delete key_schema_;
+    delete entry_schema_;
+  }
 
   /** @return The name of the index */
   inline const std::string &GetName() const { return name_; }
@@ -72,6 +85,18 @@ class IndexMetadata {
   /** @return The mapping relation between indexed columns and base table columns */
   inline const std::vector<uint32_t> &GetKeyAttrs() const { return key_attrs_; }
 
+  /** @return Whether every key maps to at most one tuple */
+  inline bool IsUnique() const { return is_unique_; }
+
+  /** @return Whether the index stores columns besides the key */
+  inline bool HasIncludedColumns() const { return entry_attrs_.size() > key_attrs_.size(); }
+
+  /** @return The schema of an index entry: the key columns followed by the included columns */
+  inline Schema *GetEntrySchema() const { return entry_schema_; }
+
+  /** @return The mapping relation between the columns of an index entry and base table columns */
+  inline const std::vector<uint32_t> &GetEntryAttrs() const { return entry_attrs_; }
+
   /** @return A string representation for debugging */
   std::string ToString() const {
     std::stringstream os;
@@ -92,8 +117,14 @@ class IndexMetadata {
   std::string table_name_;
   /** The mapping relation between key schema and tuple schema */
   const std::vector<uint32_t> key_attrs_;
+  /** Whether every key maps to at most one tuple */
+  const bool is_unique_;
   /** The schema of the indexed key */
   Schema *key_schema_;
+  /** The mapping relation between entry schema and tuple schema */
+  std::vector<uint32_t> entry_attrs_;
+  /** The schema of an index entry, which is the key schema unless the index has included columns */
+  Schema *entry_schema_;
 };
 
 /////////////////////////////////////////////////////////////////////
@@ -139,6 +170,12 @@ class Index {
   /** @return The index key attributes */
   const std::vector<uint32_t> &GetKeyAttrs() const { return metadata_->GetKeyAttrs(); }
 
+  /** @return The schema of the entries that InsertEntry and DeleteEntry take */
+  Schema *GetEntrySchema() const { return metadata_->GetEntrySchema(); }
+
+  /** @return The index entry attributes, the key attributes followed by the included ones */
+  const std::vector<uint32_t> &GetEntryAttrs() const { return metadata_->GetEntryAttrs(); }
+
   /** @return A string representation for debugging */
   std::string ToString() const {
     std::stringstream os;
@@ -153,7 +190,7 @@ class Index {
 
   /**
    * Insert an entry into the index.
-   * @param key The index key
+   * @param key The index entry, built with GetEntrySchema and GetEntryAttrs
    * @param rid The RID associated with the key (unused)
    * @param transaction The transaction context
    */
@@ -161,12 +198,27 @@ class Index {
 
   /**
    * Delete an index entry by key.
-   * @param key The index key
+   * @param key The index entry, built with GetEntrySchema and GetEntryAttrs
    * @param rid The RID associated with the key (unused)
    * @param transaction The transaction context
    */
   virtual void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) = 0;
 
+  /**
+   * Populate an empty index from a stream of entries. Indexes that can be built
+   * faster than by repeated insertion override this; the default inserts the
+   * entries one at a time.
+   * @param next Produces the next index entry and RID; returns false once the stream is exhausted
+   * @param transaction The transaction context
+   */
+  virtual void BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) {
+    Tuple key;
+    RID rid;
+    while (next(&key, &rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
   /**
    * Search the index for the provided key.
    * @param key The index key
@@ -175,6 +227,21 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Search the index for a batch of keys. Indexes that can share work between
+   * the keys of a batch override this; the default probes one key at a time.
+   * @param keys The index keys
+   * @param results results->at(i) is populated with the RIDs of keys[i]
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->assign(keys.size(), std::vector<RID>());
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
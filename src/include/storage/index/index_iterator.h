@@ -13,17 +13,61 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <vector>
+
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/b_plus_tree_posting_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * Iterates over the pairs of a B+ tree in key order, or in reverse key order.
+ * The iterator keeps its current leaf pinned and read latched. As soon as it
+ * reaches a leaf, it pins the next leaf in the direction of the scan through
+ * the buffer pool, so that the page is read in and can not be evicted while the
+ * current leaf is consumed. It releases the current latch before latching the
+ * next leaf, so it never holds two leaf latches and cannot deadlock with a
+ * merge or split that latches a sibling. An iterator is movable but not copyable.
+ * The next leaf may have been merged into the current one, or have given keys
+ * to it, between the release of the current leaf and the latch of the next: a
+ * forward iterator that finds the next leaf deleted, or its low key different
+ * from the high key of the leaf it left, descends from the tree again to the
+ * leaf holding that high key.
+ * A bounded iterator reaches the end at the bound, without pinning any leaf
+ * past it.
+ * A reverse iterator follows the left links. The leaf it reaches may have been
+ * split or merged away since the link was read, so it checks the fence keys
+ * and moves right, or further left, to the leaf holding the keys below those
+ * it has returned.
+ * A key of a non-unique tree is returned once for each of its values, which
+ * are read from its posting list one page at a time, or all at once by a
+ * reverse iterator.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  // the end iterator
   IndexIterator();
+  /*
+   * Starts at index in a leaf that the caller pinned and read latched. A forward
+   * iterator ends before the first key not less than *bound, a reverse one
+   * after the last key not less than *bound. tree and comparator, the one of
+   * the tree, outlive the iterator.
+   */
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, BufferPoolManager *buffer_pool_manager, Page *page,
+                int index, const KeyComparator *comparator, bool unique_keys = true, bool reverse = false,
+                const KeyType *bound = nullptr);
+  IndexIterator(IndexIterator &&other) noexcept;
+  IndexIterator &operator=(IndexIterator &&other) noexcept;
+  IndexIterator(const IndexIterator &) = delete;
+  IndexIterator &operator=(const IndexIterator &) = delete;
   ~IndexIterator();
 
   bool IsEnd();
@@ -32,12 +76,56 @@ class IndexIterator {
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const {
+    return page_ == itr.page_ && index_ == itr.index_ && posting_index_ == itr.posting_index_;
+  }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  // moves on to the next leaf while the current one is exhausted
+  void SkipExhaustedLeaves();
+
+  // moves on to the leaf on the left while the current one is exhausted
+  void SkipExhaustedLeavesBackward();
+
+  // becomes the end iterator if the current key is past the bound
+  void StopAtBound();
+
+  // makes page, which is pinned and read latched, the current leaf and pins the next one ahead
+  void EnterLeaf(Page *page);
+
+  // the next leaf in the direction of the scan, pinned, or nullptr
+  Page *FetchNextLeaf(page_id_t page_id);
+
+  // reads the posting list of the current key, if it has one
+  void LoadPostingList();
+
+  // reads the posting page at page_id into postings_
+  void LoadPostingPage(page_id_t page_id);
+
+  void Release();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  Page *page_{nullptr};
+  LeafPage *leaf_{nullptr};
+  int index_{0};
+  // the leaf after the current one in the direction of the scan, pinned ahead of time
+  Page *prefetched_page_{nullptr};
+  bool unique_keys_{true};
+  bool reverse_{false};
+  bool has_bound_{false};
+  KeyType bound_{};
+  // whether the bound may fall within the current leaf, so that its keys are compared against it
+  bool bound_in_leaf_{false};
+  const KeyComparator *comparator_{nullptr};
+  // the values of the current posting page, empty unless the current key has a posting list
+  std::vector<ValueType> postings_;
+  size_t posting_index_{0};
+  page_id_t next_posting_page_id_{INVALID_PAGE_ID};
+  // the pair returned by operator*
+  MappingType item_;
 };
 
 }  // namespace bustub
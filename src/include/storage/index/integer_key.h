@@ -0,0 +1,181 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// integer_key.h
+//
+// Identification: src/include/storage/index/integer_key.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+#include "catalog/schema.h"
+#include "common/util/hash_util.h"
+#include "storage/table/tuple.h"
+#include "type/value.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/**
+ * @return the size of the IntegerKey for keys of key_schema, which is 4 bytes for
+ * a single TINYINT, SMALLINT or INTEGER column and 8 bytes for a single BIGINT
+ * column, or 0 if key_schema is not a single integer column
+ */
+inline size_t IntegerKeySize(const Schema *key_schema) {
+  if (key_schema->GetColumnCount() != 1) {
+    return 0;
+  }
+  switch (key_schema->GetColumn(0).GetType()) {
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+      return sizeof(uint32_t);
+    case TypeId::BIGINT:
+      return sizeof(uint64_t);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Index key of a single integer column, which Catalog::CreateIndex and
+ * Catalog::CreateIntegerIndex use instead of GenericKey. The integer is stored big-endian with its sign bit flipped,
+ * like in a normalized GenericKey, because B+ tree pages search and truncate
+ * keys as byte strings; but it is read straight from the key tuple and
+ * compared as one integer, without going through the key schema.
+ */
+template <size_t KeySize>
+class IntegerKey {
+  static_assert(KeySize == sizeof(uint32_t) || KeySize == sizeof(uint64_t), "integer keys take 4 or 8 bytes");
+
+ public:
+  // key_schema is a single integer column, see IntegerKeySize
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    const char *data = tuple.GetData();
+    switch (key_schema->GetColumn(0).GetType()) {
+      case TypeId::TINYINT:
+        Set(Load<int8_t>(data));
+        break;
+      case TypeId::SMALLINT:
+        Set(Load<int16_t>(data));
+        break;
+      case TypeId::INTEGER:
+        Set(Load<int32_t>(data));
+        break;
+      default:
+        Set(Load<int64_t>(data));
+        break;
+    }
+  }
+
+  // NOTE: for test purpose only
+  inline void SetFromInteger(int64_t key) { Set(key); }
+
+  inline Value ToValue(Schema *schema, uint32_t column_idx) const {
+    int64_t key = ToInteger();
+    // NULL是类型的保留值，构造Value时会认出来
+    switch (schema->GetColumn(column_idx).GetType()) {
+      case TypeId::TINYINT:
+        return ValueFactory::GetTinyIntValue(static_cast<int8_t>(key));
+      case TypeId::SMALLINT:
+        return ValueFactory::GetSmallIntValue(static_cast<int16_t>(key));
+      case TypeId::INTEGER:
+        return ValueFactory::GetIntegerValue(static_cast<int32_t>(key));
+      default:
+        return ValueFactory::GetBigIntValue(key);
+    }
+  }
+
+  /** @return the bits of the key in the order of the integers */
+  inline uint64_t Ordinal() const {
+    if constexpr (KeySize == sizeof(uint32_t)) {
+      return __builtin_bswap32(Load<uint32_t>(data_));
+    } else {
+      return __builtin_bswap64(Load<uint64_t>(data_));
+    }
+  }
+
+  inline int64_t ToInteger() const {
+    if constexpr (KeySize == sizeof(uint32_t)) {
+      return static_cast<int32_t>(static_cast<uint32_t>(Ordinal()) ^ SIGN_BIT_32);
+    } else {
+      return static_cast<int64_t>(Ordinal() ^ SIGN_BIT_64);
+    }
+  }
+
+  // NOTE: for test purpose only
+  inline int64_t ToString() const { return ToInteger(); }
+
+  // NOTE: for test purpose only
+  friend std::ostream &operator<<(std::ostream &os, const IntegerKey &key) {
+    os << key.ToInteger();
+    return os;
+  }
+
+  bool operator==(const IntegerKey &other) const { return memcmp(data_, other.data_, KeySize) == 0; }
+
+  char data_[KeySize];
+
+ private:
+  static constexpr uint32_t SIGN_BIT_32 = 1U << 31;
+  static constexpr uint64_t SIGN_BIT_64 = 1ULL << 63;
+
+  template <typename T>
+  static T Load(const char *data) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+  }
+
+  inline void Set(int64_t key) {
+    if constexpr (KeySize == sizeof(uint32_t)) {
+      uint32_t bits = __builtin_bswap32(static_cast<uint32_t>(key) ^ SIGN_BIT_32);
+      memcpy(data_, &bits, sizeof(bits));
+    } else {
+      uint64_t bits = __builtin_bswap64(static_cast<uint64_t>(key) ^ SIGN_BIT_64);
+      memcpy(data_, &bits, sizeof(bits));
+    }
+  }
+};
+
+/**
+ * Function object returns -1, 0 or 1 as lhs is less than, equal to or greater
+ * than rhs, used for trees and hash tables. It takes a key schema only to be
+ * constructed like GenericComparator.
+ */
+template <size_t KeySize>
+class IntegerComparator {
+ public:
+  inline int operator()(const IntegerKey<KeySize> &lhs, const IntegerKey<KeySize> &rhs) const {
+    uint64_t l = lhs.Ordinal();
+    uint64_t r = rhs.Ordinal();
+    return static_cast<int>(l > r) - static_cast<int>(l < r);
+  }
+
+  /** @return true, the keys are stored big-endian so that the byte order is the order of the integers */
+  bool IsByteOrdered() const { return true; }
+
+  explicit IntegerComparator(Schema *key_schema = nullptr) {}
+};
+
+}  // namespace bustub
+
+namespace std {
+
+/** Implements std::hash on IntegerKey for in-memory hash tables */
+template <size_t KeySize>
+struct hash<bustub::IntegerKey<KeySize>> {
+  std::size_t operator()(const bustub::IntegerKey<KeySize> &key) const {
+    return bustub::HashUtil::HashBytes(key.data_, KeySize);
+  }
+};
+
+}  // namespace std
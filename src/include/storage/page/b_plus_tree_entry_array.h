@@ -0,0 +1,429 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_entry_array.h
+//
+// Identification: src/include/storage/page/b_plus_tree_entry_array.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace bustub {
+
+/**
+ * Binary search over the sorted entries of a page: returns the number of
+ * leading entries for which before(entry) holds, like std::partition_point.
+ * Every step halves the range with a conditional move instead of a branch, so
+ * the loop runs the same number of times whatever the keys are and does not
+ * stall on mispredicted branches. Both possible entries of the next step are
+ * prefetched.
+ */
+template <typename T, typename Pred>
+inline int PartitionPoint(const T *entries, int size, Pred before) {
+  if (size == 0) {
+    return 0;
+  }
+  const T *base = entries;
+  while (size > 1) {
+    int half = size / 2;
+    __builtin_prefetch(base + half / 2);
+    __builtin_prefetch(base + half + half / 2);
+    base = before(base[half]) ? base + half : base;
+    size -= half;
+  }
+  return static_cast<int>(base - entries) + static_cast<int>(before(*base));
+}
+
+/** @return the number of leading bytes that two keys share */
+template <typename KeyType>
+inline int CommonPrefixLength(const KeyType &lhs, const KeyType &rhs) {
+  const auto *l = reinterpret_cast<const unsigned char *>(&lhs);
+  const auto *r = reinterpret_cast<const unsigned char *>(&rhs);
+  int length = 0;
+  while (length < static_cast<int>(sizeof(KeyType)) && l[length] == r[length]) {
+    length++;
+  }
+  return length;
+}
+
+/**
+ * Suffix truncation of separator keys: the shortest key, zero padded, that is
+ * greater than left and not greater than right. It is right cut after the
+ * first byte in which the two keys differ.
+ * @pre left < right as byte strings
+ */
+template <typename KeyType>
+inline KeyType ShortestSeparator(const KeyType &left, const KeyType &right) {
+  KeyType separator;
+  auto *data = reinterpret_cast<char *>(&separator);
+  memset(data, 0, sizeof(KeyType));
+  memcpy(data, &right, CommonPrefixLength(left, right) + 1);
+  return separator;
+}
+
+/**
+ * Keys are fixed-size byte strings that are ordered byte by byte, which is how
+ * GenericComparator orders normalized keys. Pages search, compare and truncate
+ * keys this way instead of through the comparator of the tree, so a B+ tree
+ * only takes comparators that order keys as byte strings: they have an
+ * IsByteOrdered() method, which must return true (see BPlusTree).
+ * @return -1, 0 or 1 as lhs is less than, equal to or greater than rhs
+ */
+template <typename KeyType>
+inline int CompareKeys(const KeyType &lhs, const KeyType &rhs) {
+  if constexpr (sizeof(KeyType) == sizeof(uint64_t)) {
+    uint64_t l;
+    uint64_t r;
+    memcpy(&l, &lhs, sizeof(uint64_t));
+    memcpy(&r, &rhs, sizeof(uint64_t));
+    l = __builtin_bswap64(l);
+    r = __builtin_bswap64(r);
+    return static_cast<int>(l > r) - static_cast<int>(l < r);
+  } else if constexpr (sizeof(KeyType) == sizeof(uint32_t)) {
+    uint32_t l;
+    uint32_t r;
+    memcpy(&l, &lhs, sizeof(uint32_t));
+    memcpy(&r, &rhs, sizeof(uint32_t));
+    l = __builtin_bswap32(l);
+    r = __builtin_bswap32(r);
+    return static_cast<int>(l > r) - static_cast<int>(l < r);
+  } else {
+    return memcmp(&lhs, &rhs, sizeof(KeyType));
+  }
+}
+
+/**
+ * The entries of a B+ tree page whose keys are at most a machine word long, so
+ * that a slot would take more space than the key. Keys and values are kept in
+ * two arrays, and a search only reads the cache lines of the keys:
+ *  --------------------------------------------------------------------------
+ * | KEY(1) | ... | KEY(n) | ... | VALUE(1) | ... | VALUE(n) | ... |
+ *  --------------------------------------------------------------------------
+ * Every entry takes the same space and keys are never truncated, so the prefix
+ * methods do nothing. The interface is the one of BPlusTreeSlotArray.
+ */
+template <typename KeyType, typename ValueType, size_t DataSize>
+class BPlusTreeFixedArray {
+ public:
+  /** Number of entries that fit */
+  static constexpr int CAPACITY = DataSize / (sizeof(KeyType) + sizeof(ValueType));
+  static constexpr int MAX_ENTRY_SIZE = sizeof(KeyType) + sizeof(ValueType);
+  static constexpr int DATA_SIZE = CAPACITY * MAX_ENTRY_SIZE;
+
+  void Init() {}
+
+  /** @return 0, keys are stored whole */
+  static int FencePrefixLength(const KeyType &low_key, const KeyType &high_key) { return 0; }
+  int GetPrefixLength() const { return 0; }
+  int GetFreeSpace(int size) const { return DATA_SIZE - GetUsedSpace(size); }
+  int GetUsedSpace(int size) const { return size * MAX_ENTRY_SIZE; }
+  int EntrySizeAt(int index) const { return MAX_ENTRY_SIZE; }
+  static int EntrySize(const KeyType &key, int prefix_length) { return MAX_ENTRY_SIZE; }
+  int RequiredSpace(int size, int prefix_length) const { return GetUsedSpace(size); }
+
+  KeyType KeyAt(int index) const { return keys_[index]; }
+  ValueType ValueAt(int index) const { return values_[index]; }
+  void SetValueAt(int index, const ValueType &value) { values_[index] = value; }
+
+  int Search(const KeyType &key, int begin, int size, bool upper) const {
+    if (upper) {
+      return begin + PartitionPoint(keys_ + begin, size - begin,
+                                    [&](const KeyType &k) { return CompareKeys(k, key) <= 0; });
+    }
+    return begin +
+           PartitionPoint(keys_ + begin, size - begin, [&](const KeyType &k) { return CompareKeys(k, key) < 0; });
+  }
+
+  bool KeyEquals(int index, const KeyType &key) const { return CompareKeys(keys_[index], key) == 0; }
+
+  void Insert(int size, int index, const KeyType &key, const ValueType &value) {
+    std::copy_backward(keys_ + index, keys_ + size, keys_ + size + 1);
+    std::copy_backward(values_ + index, values_ + size, values_ + size + 1);
+    keys_[index] = key;
+    values_[index] = value;
+  }
+
+  void Remove(int size, int index) {
+    std::copy(keys_ + index + 1, keys_ + size, keys_ + index);
+    std::copy(values_ + index + 1, values_ + size, values_ + index);
+  }
+
+  void SetKeyAt(int size, int index, const KeyType &key) { keys_[index] = key; }
+  void Truncate(int size) {}
+  void SetPrefix(int size, const KeyType &key, int prefix_length) {}
+
+ private:
+  KeyType keys_[CAPACITY];
+  ValueType values_[CAPACITY];
+};
+
+/**
+ * The entries of a B+ tree page with keys longer than a machine word: keys of
+ * variable length, each with a value.
+ *
+ * A key is stored without the prefix that all keys of the page share and
+ * without its trailing zero bytes, so a short string in a GenericKey<64> only
+ * takes the bytes it uses. Every entry
+ * has a slot, and the slots are kept in key order. A slot holds the value, the
+ * first 4 bytes of the stored key as a big-endian integer (the head) and the
+ * location of the rest of the key (the tail). Tails grow from the end of the
+ * data area towards the slots, below the prefix:
+ *  -----------------------------------------------------------------------------------
+ * | SLOT(1) | SLOT(2) | ... | SLOT(n) | free space | TAIL(n) | ... | TAIL(1) | PREFIX |
+ *  -----------------------------------------------------------------------------------
+ *  Slot format (size in byte):
+ *  -----------------------------------------------
+ * | Head (4) | TailOffset (2) | Length (2) | Value |
+ *  -----------------------------------------------
+ * A search compares heads and only reads a tail when two heads are equal, so
+ * the slots of a page whose keys differ within 4 bytes after the prefix are
+ * searched like an array of integers. Tails stay contiguous: removing an
+ * entry moves the tails that were added after it.
+ *
+ * The number of entries is kept in the page header, so it is passed in.
+ */
+template <typename KeyType, typename ValueType, size_t DataSize>
+class BPlusTreeSlotArray {
+ public:
+  struct Slot {
+    uint32_t head_;
+    uint16_t offset_;
+    uint16_t length_;
+    ValueType value_;
+  };
+
+  /** Number of key bytes that are stored in the slot */
+  static constexpr int HEAD_SIZE = sizeof(uint32_t);
+  /** Space taken by an entry whose key has no byte in common with the prefix */
+  static constexpr int MAX_ENTRY_SIZE = sizeof(Slot) + std::max(static_cast<int>(sizeof(KeyType)) - HEAD_SIZE, 0);
+  /** Size of the area that holds slots, tails and the prefix */
+  static constexpr int DATA_SIZE = DataSize;
+
+  void Init() {
+    prefix_length_ = 0;
+    tail_begin_ = DataSize;
+  }
+
+  /** @return the length of the prefix of a page with these fence keys, which all of its keys share */
+  static int FencePrefixLength(const KeyType &low_key, const KeyType &high_key) {
+    return CommonPrefixLength(low_key, high_key);
+  }
+  int GetPrefixLength() const { return prefix_length_; }
+  int GetFreeSpace(int size) const { return tail_begin_ - size * static_cast<int>(sizeof(Slot)); }
+  int GetUsedSpace(int size) const { return DATA_SIZE - GetFreeSpace(size); }
+
+  /** @return the space that the entry at index takes */
+  int EntrySizeAt(int index) const { return EntrySize(Slots()[index].length_); }
+
+  /** @return the space that an entry with key takes in a page with the given prefix */
+  static int EntrySize(const KeyType &key, int prefix_length) {
+    return EntrySize(SuffixLength(key, prefix_length));
+  }
+
+  /** @return the space that the first size entries take once encoded with another prefix, without the prefix */
+  int RequiredSpace(int size, int prefix_length) const {
+    int space = 0;
+    for (int i = 0; i < size; i++) {
+      space += prefix_length == prefix_length_ ? EntrySizeAt(i) : EntrySize(KeyAt(i), prefix_length);
+    }
+    return space;
+  }
+
+  KeyType KeyAt(int index) const {
+    KeyType key;
+    char *data = reinterpret_cast<char *>(&key);
+    memset(data, 0, sizeof(KeyType));
+    memcpy(data, Prefix(), prefix_length_);
+    const Slot &slot = Slots()[index];
+    char *suffix = data + prefix_length_;
+    uint32_t head = __builtin_bswap32(slot.head_);
+    memcpy(suffix, &head, std::min<int>(slot.length_, HEAD_SIZE));
+    if (slot.length_ > HEAD_SIZE) {
+      memcpy(suffix + HEAD_SIZE, data_ + slot.offset_, slot.length_ - HEAD_SIZE);
+    }
+    return key;
+  }
+
+  ValueType ValueAt(int index) const { return Slots()[index].value_; }
+  void SetValueAt(int index, const ValueType &value) { Slots()[index].value_ = value; }
+
+  /**
+   * Search the entries in [begin, size).
+   * @return the index of the first entry whose key is not less than key, or
+   * greater than key if upper is set; size if there is none
+   */
+  int Search(const KeyType &key, int begin, int size, bool upper) const {
+    const char *data = reinterpret_cast<const char *>(&key);
+    int cmp = memcmp(data, Prefix(), prefix_length_);
+    if (cmp != 0) {
+      // 前缀不同的key比页中所有的key都小或者都大
+      return cmp < 0 ? begin : size;
+    }
+    const char *suffix = data + prefix_length_;
+    int length = SuffixLength(key, prefix_length_);
+    uint32_t head = Head(suffix, length);
+    if (upper) {
+      return begin + PartitionPoint(Slots() + begin, size - begin,
+                                    [&](const Slot &slot) { return Compare(slot, suffix, head, length) <= 0; });
+    }
+    return begin + PartitionPoint(Slots() + begin, size - begin,
+                                  [&](const Slot &slot) { return Compare(slot, suffix, head, length) < 0; });
+  }
+
+  /** @return whether the key at index equals key */
+  bool KeyEquals(int index, const KeyType &key) const {
+    const char *data = reinterpret_cast<const char *>(&key);
+    if (memcmp(data, Prefix(), prefix_length_) != 0) {
+      return false;
+    }
+    const char *suffix = data + prefix_length_;
+    int length = SuffixLength(key, prefix_length_);
+    return Compare(Slots()[index], suffix, Head(suffix, length), length) == 0;
+  }
+
+  /**
+   * Insert an entry at index, moving the entries from index on.
+   * @pre the free space holds the entry and key shares the prefix
+   */
+  void Insert(int size, int index, const KeyType &key, const ValueType &value) {
+    Slot *slots = Slots();
+    std::copy_backward(slots + index, slots + size, slots + size + 1);
+    slots[index].value_ = value;
+    WriteKey(&slots[index], key);
+  }
+
+  /** Remove the entry at index, moving the entries after it */
+  void Remove(int size, int index) {
+    FreeTail(size, index);
+    Slot *slots = Slots();
+    std::copy(slots + index + 1, slots + size, slots + index);
+  }
+
+  /**
+   * Replace the key at index.
+   * @pre the free space holds the new key once the old one is removed
+   */
+  void SetKeyAt(int size, int index, const KeyType &key) {
+    FreeTail(size, index);
+    WriteKey(&Slots()[index], key);
+  }
+
+  /** Drop all entries from index size on */
+  void Truncate(int size) { Rebuild(size, Prefix(), prefix_length_); }
+
+  /**
+   * Encode the entries again with the first prefix_length bytes of key as the
+   * prefix.
+   * @pre all keys share that prefix and the entries fit once encoded with it
+   */
+  void SetPrefix(int size, const KeyType &key, int prefix_length) {
+    Rebuild(size, reinterpret_cast<const char *>(&key), prefix_length);
+  }
+
+ private:
+  // the length of key after the first prefix_length bytes, without its trailing zero bytes
+  static int SuffixLength(const KeyType &key, int prefix_length) {
+    const char *data = reinterpret_cast<const char *>(&key);
+    int end = sizeof(KeyType);
+    while (end > prefix_length && data[end - 1] == 0) {
+      end--;
+    }
+    return end - prefix_length;
+  }
+
+  static int EntrySize(int length) { return sizeof(Slot) + std::max(length - HEAD_SIZE, 0); }
+
+  // the first bytes of a suffix as a big-endian integer, zero padded
+  static uint32_t Head(const char *suffix, int length) {
+    uint32_t head = 0;
+    memcpy(&head, suffix, std::min(length, HEAD_SIZE));
+    return __builtin_bswap32(head);
+  }
+
+  /*
+   * Compare the key of a slot with a key that has the page prefix, given as its
+   * suffix. Bytes past the length of a key are zero, so once the common bytes
+   * are equal the longer key is the greater one.
+   */
+  int Compare(const Slot &slot, const char *suffix, uint32_t head, int length) const {
+    if (slot.head_ != head) {
+      return slot.head_ < head ? -1 : 1;
+    }
+    int common = std::min<int>(slot.length_, length) - HEAD_SIZE;
+    if (common > 0) {
+      int cmp = memcmp(data_ + slot.offset_, suffix + HEAD_SIZE, common);
+      if (cmp != 0) {
+        return cmp;
+      }
+    }
+    return static_cast<int>(slot.length_) - length;
+  }
+
+  void WriteKey(Slot *slot, const KeyType &key) {
+    const char *suffix = reinterpret_cast<const char *>(&key) + prefix_length_;
+    int length = SuffixLength(key, prefix_length_);
+    slot->head_ = Head(suffix, length);
+    slot->length_ = length;
+    int tail = std::max(length - HEAD_SIZE, 0);
+    tail_begin_ -= tail;
+    if (tail > 0) {
+      memcpy(data_ + tail_begin_, suffix + HEAD_SIZE, tail);
+    }
+    slot->offset_ = tail_begin_;
+  }
+
+  // remove the tail of the entry at index; the tails added after it move up
+  void FreeTail(int size, int index) {
+    Slot *slots = Slots();
+    int tail = std::max(slots[index].length_ - HEAD_SIZE, 0);
+    if (tail == 0) {
+      return;
+    }
+    uint16_t offset = slots[index].offset_;
+    memmove(data_ + tail_begin_ + tail, data_ + tail_begin_, offset - tail_begin_);
+    tail_begin_ += tail;
+    for (int i = 0; i < size; i++) {
+      if (i != index && slots[i].length_ > HEAD_SIZE && slots[i].offset_ < offset) {
+        slots[i].offset_ += tail;
+      }
+    }
+  }
+
+  // write the entries again from a copy of the page, which also makes the tails contiguous
+  void Rebuild(int size, const char *prefix, int prefix_length) {
+    BPlusTreeSlotArray old = *this;
+    prefix_length_ = prefix_length;
+    tail_begin_ = DataSize - prefix_length;
+    // prefix可能指向本页旧的前缀，它和新的前缀的位置重叠
+    memmove(data_ + tail_begin_, prefix, prefix_length);
+    Slot *slots = Slots();
+    for (int i = 0; i < size; i++) {
+      WriteKey(&slots[i], old.KeyAt(i));
+    }
+  }
+
+  Slot *Slots() { return reinterpret_cast<Slot *>(data_); }
+  const Slot *Slots() const { return reinterpret_cast<const Slot *>(data_); }
+  const char *Prefix() const { return data_ + DataSize - prefix_length_; }
+
+  uint16_t prefix_length_;
+  uint16_t tail_begin_;
+  alignas(Slot) char data_[DataSize];
+};
+
+/** The entries of a page with keys of type KeyType */
+template <typename KeyType, typename ValueType, size_t DataSize>
+using BPlusTreeEntryArray = std::conditional_t<sizeof(KeyType) <= sizeof(uint64_t),
+                                               BPlusTreeFixedArray<KeyType, ValueType, DataSize>,
+                                               BPlusTreeSlotArray<KeyType, ValueType, DataSize>>;
+
+}  // namespace bustub
@@ -13,12 +13,16 @@
 #include <queue>
 
 #include "storage/page/b_plus_tree_page.h"
+#include "storage/page/b_plus_tree_entry_array.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE 36
+#define INTERNAL_PAGE_DATA_SIZE (PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE - 2 * sizeof(KeyType))
+// the most children a page can hold, when no key needs more than the bytes of its slot or is shorter
+#define INTERNAL_PAGE_SIZE \
+  (INTERNAL_PAGE_DATA_SIZE / (std::min(sizeof(KeyType), 2 * sizeof(uint32_t)) + sizeof(ValueType)))
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -28,9 +32,21 @@ namespace bustub {
  * should ignore the first key.
  *
  * Internal page format (keys are stored in increasing order):
- *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
- *  --------------------------------------------------------------------------
+ *  ------------------------------------------------------------------------------------
+ * | HEADER | SLOT(1) | ... | SLOT(n) | free space | KEY(n) | ... | KEY(1) | PREFIX |
+ *  ------------------------------------------------------------------------------------
+ * Like in leaf pages, keys longer than 8 bytes are stored with variable length
+ * and without the prefix of the fence keys, behind slots that hold the child
+ * page ids (see BPlusTreeEntryArray). The first key is kept equal to the low
+ * key, or zero, so it has the prefix too. A page is full when it holds more than max_size
+ * children or has no room for one more key, and underflows when it holds less
+ * than min_size children that take less than half of its space.
+ *
+ * Like leaf pages, internal pages are B-link nodes: after the common header come
+ * a right link to the next page of the same level and the fence keys of the
+ * page, | NextPageId (4) | HasLowKey (4) | LowKey | HighKey |. The subtree of the
+ * page holds the keys in [LowKey, HighKey); the leftmost page of a level has no
+ * low key and the rightmost one (NextPageId is invalid) has no high key.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
@@ -43,24 +59,58 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
 
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  KeyType GetHighKey() const;
+  void SetHighKey(const KeyType &key);
+  KeyType GetLowKey() const;
+  void SetLowKey(const KeyType &key);
+  void UpdatePrefix();
+  // whether a concurrent split moved key to a right sibling
+  bool ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const;
+  // whether a concurrent redistribution moved key to the left sibling
+  bool IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const;
+
+  // space checks of splits, merges and redistributions
+  bool IsFull() const;
+  bool IsSafeToInsert() const;
+  bool IsUnderflow() const;
+  bool IsSafeToRemove() const;
+  // whether the keys take more than fill_factor of the space, used by bulk loading
+  bool IsFilledTo(double fill_factor) const;
+  bool CanAbsorb(const BPlusTreeInternalPage *right, const KeyType &middle_key) const;
+  bool CanAddWithLowKey(const KeyType &key, const KeyType &low_key) const;
+  bool CanAddWithHighKey(const KeyType &key, const KeyType &high_key) const;
+  bool CanReplaceKey(int index, const KeyType &key) const;
+
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  int InsertNode(const KeyType &new_key, const ValueType &new_value, const KeyComparator &comparator);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
 
   // Split and Merge utility methods
   void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key, BufferPoolManager *buffer_pool_manager);
-  void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager,
+                  double keep_fraction = 0.5);
   void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                          BufferPoolManager *buffer_pool_manager);
 
  private:
-  void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
+  using EntryArray = BPlusTreeEntryArray<KeyType, ValueType, INTERNAL_PAGE_DATA_SIZE>;
+
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
-  MappingType array_[0];
+  // the prefix shared by the fence keys; a page without both fences has none
+  int FencePrefixLength(bool has_low_key, const KeyType &low_key, bool has_high_key, const KeyType &high_key) const;
+  bool FitsWithPrefix(int prefix_length, int space) const;
+  page_id_t next_page_id_;
+  int has_low_key_;
+  KeyType low_key_;
+  KeyType high_key_;
+  EntryArray entries_;
 };
 }  // namespace bustub
@@ -14,30 +14,53 @@
 #include <vector>
 
 #include "storage/page/b_plus_tree_page.h"
+#include "storage/page/b_plus_tree_entry_array.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_HEADER_SIZE 40
+#define LEAF_PAGE_DATA_SIZE (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - 2 * sizeof(KeyType))
+// the most entries a page can hold, when no key needs more than the bytes of its slot or is shorter
+#define LEAF_PAGE_SIZE (LEAF_PAGE_DATA_SIZE / (std::min(sizeof(KeyType), 2 * sizeof(uint32_t)) + sizeof(ValueType)))
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Every key is stored once; the record ids of a key of a non-unique tree
+ * are kept in a posting list that the value references (see
+ * BPlusTreePostingPage).
  *
  * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ *  ------------------------------------------------------------------------
+ * | HEADER | SLOT(1) | ... | SLOT(n) | free space | KEY(n) | ... | KEY(1) | PREFIX |
+ *  ------------------------------------------------------------------------
+ * Keys longer than 8 bytes are stored with variable length, without the prefix
+ * that all keys of the page share, behind slots that hold the record ids;
+ * shorter keys are stored whole in an array (see BPlusTreeEntryArray). A page
+ * is full when it holds max_size entries or has no room for one more key, and
+ * underflows when it holds less than min_size entries that take less than
+ * half of its space.
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 40 bytes plus two keys in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
- *  -----------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | PrevPageId (4) |
+ *  ---------------------------------------------------------------------
+ *  --------------------------------------------------------------------------
+ * | HasLowKey (4) | LowKey | HighKey | PrefixLength (2) | KeyBegin (2) |
+ *  --------------------------------------------------------------------------
+ *
+ * NextPageId is the B-link right link. The page holds the keys in
+ * [LowKey, HighKey); the leftmost leaf has no low key and the rightmost leaf
+ * (NextPageId is invalid) has no high key. PrevPageId links the leaves the
+ * other way for reverse scans. A leaf that was merged away keeps both links;
+ * its left link leads to the leaf that took over its keys. The prefix is the
+ * one that the fence keys share, so every key that belongs in the page has
+ * it. Whoever changes the fence keys calls UpdatePrefix afterwards, and before
+ * moving in keys when the range of the page grows.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
@@ -48,26 +71,62 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   // helper methods
   page_id_t GetNextPageId() const;
   void SetNextPageId(page_id_t next_page_id);
+  page_id_t GetPrevPageId() const;
+  void SetPrevPageId(page_id_t prev_page_id);
+  bool HasLowKey() const;
+  KeyType GetHighKey() const;
+  void SetHighKey(const KeyType &key);
+  KeyType GetLowKey() const;
+  void SetLowKey(const KeyType &key);
+  void UpdatePrefix();
+  // whether a concurrent split moved key to a right sibling
+  bool ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const;
+  // whether a concurrent redistribution moved key to the left sibling
+  bool IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const;
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
+  MappingType GetItem(int index) const;
+
+  // space checks of splits, merges and redistributions
+  bool IsFull() const;
+  bool IsSafeToInsert() const;
+  bool IsUnderflow() const;
+  bool IsSafeToRemove() const;
+  // whether the keys take more than fill_factor of the space, used by bulk loading
+  bool IsFilledTo(double fill_factor) const;
+  bool CanAbsorb(const BPlusTreeLeafPage *right) const;
+  bool CanAddWithLowKey(const KeyType &key, const KeyType &low_key) const;
+  bool CanAddWithHighKey(const KeyType &key, const KeyType &high_key) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
   bool Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const;
+  // the index of key, or -1 if the page does not hold it
+  int Find(const KeyType &key, const KeyComparator &comparator) const;
   int RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator);
 
   // Split and Merge utility methods
-  void MoveHalfTo(BPlusTreeLeafPage *recipient);
+  // keep_fraction of the space stays in this page, half unless the split is on the right edge of the tree
+  void MoveHalfTo(BPlusTreeLeafPage *recipient, double keep_fraction = 0.5);
   void MoveAllTo(BPlusTreeLeafPage *recipient);
   void MoveFirstToEndOf(BPlusTreeLeafPage *recipient);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size);
+  using EntryArray = BPlusTreeEntryArray<KeyType, ValueType, LEAF_PAGE_DATA_SIZE>;
+
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
+  // the prefix shared by the fence keys; a page without both fences has none
+  int FencePrefixLength(bool has_low_key, const KeyType &low_key, bool has_high_key, const KeyType &high_key) const;
+  bool FitsWithPrefix(int prefix_length, int space) const;
   page_id_t next_page_id_;
-  MappingType array_[0];
+  page_id_t prev_page_id_;
+  int has_low_key_;
+  KeyType low_key_;
+  KeyType high_key_;
+  EntryArray entries_;
 };
 }  // namespace bustub
@@ -17,6 +17,7 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/index/generic_key.h"
+#include "storage/index/integer_key.h"
 
 namespace bustub {
 
@@ -44,6 +45,8 @@ class BPlusTreePage {
  public:
   bool IsLeafPage() const;
   bool IsRootPage() const;
+  // a page merged away or removed as the root is marked INVALID_INDEX_PAGE before it is deleted
+  bool IsDeleted() const;
   void SetPageType(IndexPageType page_type);
 
   int GetSize() const;
@@ -64,12 +67,12 @@ class BPlusTreePage {
 
  private:
   // member variable, attributes that both internal and leaf page share
-  IndexPageType page_type_ __attribute__((__unused__));
-  lsn_t lsn_ __attribute__((__unused__));
-  int size_ __attribute__((__unused__));
-  int max_size_ __attribute__((__unused__));
-  page_id_t parent_page_id_ __attribute__((__unused__));
-  page_id_t page_id_ __attribute__((__unused__));
+  IndexPageType page_type_;
+  lsn_t lsn_;
+  int size_;
+  int max_size_;
+  page_id_t parent_page_id_;
+  page_id_t page_id_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,86 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_posting_page.h
+//
+// Identification: src/include/storage/page/b_plus_tree_posting_page.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+/**
+ * Holds the record ids of a key that appears more than once in a non-unique
+ * B+ tree. The leaf entry of such a key stores a reference to the first page
+ * of a chain of posting pages instead of a record id. The record ids of a
+ * chain are sorted and every page holds a contiguous run of them.
+ *
+ * Posting page format:
+ *  ---------------------------------------------------------------------
+ * | NextPageId (4) | Size (4) | DataLength (4) | RID(1) | DELTA(2) | ... |
+ *  ---------------------------------------------------------------------
+ *
+ * The first record id is stored whole and every following one as its distance
+ * from the previous one, both as varints, so that the record ids of rows on
+ * the same table page take one or two bytes each. A posting page has no latch
+ * of its own; it is protected by the latch of the leaf that references it.
+ */
+class BPlusTreePostingPage {
+ public:
+  /** The slot number of a record id that references a posting list instead of a row */
+  static constexpr uint32_t POSTING_LIST_SLOT = std::numeric_limits<uint32_t>::max();
+
+  /** @return whether value is a reference to a posting list rather than a row */
+  static bool IsPostingList(const RID &value) { return value.GetSlotNum() == POSTING_LIST_SLOT; }
+
+  /** @return the value a leaf stores to reference the posting list that starts at page_id */
+  static RID PostingListReference(page_id_t page_id) { return RID(page_id, POSTING_LIST_SLOT); }
+
+  /** Must be called after the page is created by the buffer pool. */
+  void Init();
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  /** @return the number of record ids in the page */
+  int GetSize() const { return size_; }
+
+  /** @return the smallest record id in the page, which must not be empty */
+  RID FirstRid() const;
+
+  /** Appends the record ids of the page, in order, to rids. */
+  void Decode(std::vector<RID> *rids) const;
+
+  /**
+   * Replaces the content of the page by as many of the given record ids as fit.
+   * @param rids record ids in strictly ascending order
+   * @param count the number of record ids
+   * @return the number of record ids stored, from the first one
+   */
+  int Encode(const RID *rids, int count);
+
+  /** Strict order of record ids in a posting list */
+  static bool Less(const RID &lhs, const RID &rhs) { return lhs.Get() < rhs.Get(); }
+
+ private:
+  static constexpr int DATA_SIZE = PAGE_SIZE - 3 * sizeof(int32_t);
+
+  page_id_t next_page_id_;
+  int32_t size_;
+  int32_t data_length_;
+  uint8_t data_[DATA_SIZE];
+};
+
+}  // namespace bustub
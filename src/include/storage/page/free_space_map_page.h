@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map_page.h
+//
+// Identification: src/include/storage/page/free_space_map_page.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * Records how much free space the pages of a table heap have, as a bucket of
+ * BUCKET_SIZE bytes per page (see FreeSpaceMap). The pages of a map are
+ * chained and list the table pages in the order they were added.
+ *
+ * Free space map page format:
+ *  ---------------------------------------------------------------------------------------
+ * | NextPageId (4) | Size (4) | PAGE_ID(1) | ... | PAGE_ID(n) | BUCKET(1) | ... | BUCKET(n) |
+ *  ---------------------------------------------------------------------------------------
+ */
+class FreeSpaceMapPage {
+ public:
+  /** The number of table pages a map page records */
+  static constexpr int CAPACITY = (PAGE_SIZE - 2 * sizeof(int32_t)) / (sizeof(page_id_t) + sizeof(uint8_t));
+
+  /** Bytes of free space per bucket; a bucket is the free space of a page rounded down */
+  static constexpr uint32_t BUCKET_SIZE = PAGE_SIZE / 256;
+
+  /** @return the bucket of a page with free_space bytes free */
+  static uint8_t ToBucket(uint32_t free_space) { return std::min<uint32_t>(free_space / BUCKET_SIZE, UINT8_MAX); }
+
+  /** @return the smallest bucket of the pages that surely have size bytes free */
+  static uint32_t BucketFor(uint32_t size) { return (size + BUCKET_SIZE - 1) / BUCKET_SIZE; }
+
+  /** Must be called after the page is created by the buffer pool. */
+  void Init() {
+    next_page_id_ = INVALID_PAGE_ID;
+    size_ = 0;
+  }
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+  /** @return the number of table pages recorded in the page */
+  int GetSize() const { return size_; }
+
+  page_id_t PageIdAt(int index) const { return page_ids_[index]; }
+
+  uint8_t BucketAt(int index) const { return buckets_[index]; }
+  void SetBucketAt(int index, uint8_t bucket) { buckets_[index] = bucket; }
+
+  /** Records one more table page; the page must not be full. */
+  void Append(page_id_t page_id, uint8_t bucket) {
+    page_ids_[size_] = page_id;
+    buckets_[size_] = bucket;
+    size_++;
+  }
+
+ private:
+  page_id_t next_page_id_;
+  int32_t size_;
+  page_id_t page_ids_[CAPACITY];
+  uint8_t buckets_[CAPACITY];
+};
+
+static_assert(sizeof(FreeSpaceMapPage) <= PAGE_SIZE);
+
+}  // namespace bustub
@@ -57,21 +57,20 @@ class HashTableBlockPage {
 
   /**
    * Attempts to insert a key and value into an index in the block.
-   * The insert is thread safe. It uses compare and swap to claim the index,
-   * and then writes the key and value into the index, and then marks the
-   * index as readable.
+   * The insert is thread safe. It writes the key and value into the index,
+   * and then marks the index as occupied and readable. A tombstone can be
+   * reused by a later insert.
    *
    * @param bucket_ind index to write the key and value to
    * @param key key to insert
    * @param value value to insert
    * @return If the value is inserted successfully, it returns true. If the
-   * index is marked as occupied before the key and value can be inserted,
-   * Insert returns false.
+   * index already holds a readable key and value, Insert returns false.
    */
   bool Insert(slot_offset_t bucket_ind, const KeyType &key, const ValueType &value);
 
   /**
-   * Removes a key and value at index.
+   * Removes a key and value at index, leaving a tombstone.
    *
    * @param bucket_ind ind to remove the value
    */
@@ -93,50 +92,15 @@ class HashTableBlockPage {
    */
   bool IsReadable(slot_offset_t bucket_ind) const;
 
-  /**
-   * Scan the bucket and collect values that have the matching key
-   *
-   * @return true if at least one key matched
-   */
-  bool GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result);
-
-  /**
-   * Attempts to insert a key and value in the bucket.
-   * The insert is thread safe. It uses compare and swap to claim the index,
-   * and then writes the key and value into the index, and then marks the
-   * index as readable.
-   *
-   * @param key key to insert
-   * @param value value to insert
-   * @return true if inserted, false if duplicate KV pair or bucket is full
-   */
-  bool Insert(KeyType key, ValueType value, KeyComparator cmp);
-
-  /**
-   * Removes a key and value.
-   * @return true if removed, false if not found
-   */
-  bool Remove(KeyType key, ValueType value, KeyComparator cmp);
-
   /**
    * @return the number of readable elements, i.e. current size
    */
-  uint32_t NumReadable();
-
-  /**
-   * @return whether the bucket is full
-   */
-  bool IsFull();
-
-  /**
-   * @return whether the bucket is empty
-   */
-  bool IsEmpty();
+  uint32_t NumReadable() const;
 
   /**
-   * Prints the bucket's occupancy information
+   * Prints the block's occupancy information
    */
-  void PrintBucket();
+  void PrintBlock() const;
 
  private:
   std::atomic_char occupied_[(BLOCK_ARRAY_SIZE - 1) / 8 + 1];
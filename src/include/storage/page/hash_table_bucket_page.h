@@ -12,10 +12,12 @@
 
 #pragma once
 
+#include <functional>
 #include <utility>
 #include <vector>
 
 #include "common/config.h"
+#include "container/hash/hash_function.h"
 #include "storage/index/int_comparator.h"
 #include "storage/page/hash_table_page_defs.h"
 
@@ -33,6 +35,15 @@ namespace bustub {
  *  The above format omits the space required for the occupied_ and
  *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
  *
+ *  Every slot also keeps an 8-bit fingerprint of its key's hash in the
+ *  fingerprints_ array. Probes compare the fingerprints of 64 slots at a time
+ *  with SIMD and only call the comparator on slots whose fingerprint matches.
+ *
+ *  A bucket that cannot be split any further (e.g. it holds many values of one
+ *  key) continues in a chain of overflow bucket pages linked through
+ *  next_page_id_. The page is zero-filled when allocated, so Init() must be
+ *  called before it is linked into a hash table.
+ *
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class HashTableBucketPage {
@@ -41,11 +52,37 @@ class HashTableBucketPage {
   HashTableBucketPage() = delete;
 
   /**
-   * Scan the bucket and collect values that have the matching key
+   * Scan the bucket and collect values that have the matching key. The fingerprint
+   * is derived by the caller from the key's hash with the table's hash function.
+   * With first_only the scan stops at the first matching key, for tables whose keys are unique.
    *
    * @return true if at least one key matched
    */
-  bool GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result);
+  bool GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result, uint8_t fingerprint,
+                bool first_only = false);
+
+  /**
+   * Calls callback for each value that has the matching key, until the callback returns false.
+   *
+   * @return false if the callback stopped the scan, true otherwise
+   */
+  bool ForEachValue(KeyType key, KeyComparator cmp, uint8_t fingerprint,
+                    const std::function<bool(const ValueType &)> &callback);
+
+  /**
+   * @return true if the bucket holds the given key and value
+   */
+  bool Contains(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint);
+
+  /**
+   * @return true if the bucket holds the given key with any value
+   */
+  bool ContainsKey(KeyType key, KeyComparator cmp, uint8_t fingerprint);
+
+  /**
+   * @return true if every pair in the bucket has the given key
+   */
+  bool AllKeysEqual(KeyType key, KeyComparator cmp, uint8_t fingerprint);
 
   /**
    * Attempts to insert a key and value in the bucket.  Uses the occupied_
@@ -53,16 +90,28 @@ class HashTableBucketPage {
    *
    * @param key key to insert
    * @param value value to insert
+   * @param fingerprint fingerprint of the key, from the key's hash with the table's hash function
+   * @param unique_key also reject the insert if the key is already present with another value
    * @return true if inserted, false if duplicate KV pair or bucket is full
    */
-  bool Insert(KeyType key, ValueType value, KeyComparator cmp);
+  bool Insert(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint, bool unique_key = false);
 
   /**
    * Removes a key and value.
    *
+   * @param fingerprint fingerprint of the key, from the key's hash with the table's hash function
    * @return true if removed, false if not found
    */
-  bool Remove(KeyType key, ValueType value, KeyComparator cmp);
+  bool Remove(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint);
+
+  /**
+   * Derives the 8-bit fingerprint stored with a key from the key's 64-bit hash.
+   * The top bits are used since the directory consumes the low bits.
+   *
+   * @param hash the 64-bit hash of the key
+   * @return the fingerprint of the key
+   */
+  static inline uint8_t HashToFingerprint(uint64_t hash) { return static_cast<uint8_t>(hash >> 56); }
 
   /**
    * Gets the key at an index in the bucket.
@@ -80,6 +129,14 @@ class HashTableBucketPage {
    */
   ValueType ValueAt(uint32_t bucket_idx) const;
 
+  /**
+   * Gets the fingerprint at an index in the bucket.
+   *
+   * @param bucket_idx the index in the bucket to get the fingerprint at
+   * @return fingerprint at index bucket_idx of the bucket
+   */
+  uint8_t FingerprintAt(uint32_t bucket_idx) const;
+
   /**
    * Remove the KV pair at bucket_idx
    */
@@ -132,20 +189,70 @@ class HashTableBucketPage {
    */
   bool IsEmpty();
 
-  // reset occupied_ and readable_
+  // reset occupied_ and readable_, and unlink the overflow chain
   void Init();
 
-  MappingType *GetMappingTypeArray();
+  /**
+   * Moves every readable pair whose hash has high_bit set into image, in a single
+   * pass over the readable bitmap. Moved pairs go to the free slots of image and
+   * are left as tombstones here. Stops early when image fills up; the caller can
+   * continue with another image page since already moved pairs are gone.
+   *
+   * @param image the split image
+   * @param high_bit the hash bit that separates this bucket from its image
+   * @param hash_fn the hash function of the owning table
+   * @return false if image filled up before all pairs were moved
+   */
+  bool SplitTo(HashTableBucketPage *image, uint32_t high_bit, HashFunction<KeyType> *hash_fn);
+
+  /**
+   * @return the page_id of the next overflow page in the chain, INVALID_PAGE_ID if none
+   */
+  page_id_t GetNextPageId() const { return next_page_id_; }
+
+  /**
+   * @param next_page_id the page_id of the next overflow page in the chain
+   */
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
   /**
    * Prints the bucket's occupancy information
    */
   void PrintBucket();
 
  private:
+  /**
+   * @return bitmap of the readable slots in [base, base + 64) whose fingerprint equals fingerprint
+   */
+  uint64_t MatchFingerprint(uint8_t fingerprint, uint32_t base) const;
+
+  /**
+   * Loads the word-th 64-bit word of a slot bitmap. Bit i of the result is slot word * 64 + i;
+   * bytes past the end of the bitmap read as 0.
+   */
+  static uint64_t LoadBitmapWord(const char *bitmap, uint32_t word);
+
+  /**
+   * @return mask of the slots that exist in the word-th bitmap word
+   */
+  static uint64_t ValidSlotMask(uint32_t word);
+
+  /**
+   * @return index of the first slot that is not readable, or BUCKET_ARRAY_SIZE if the bucket is full
+   */
+  uint32_t FirstFreeSlot() const;
+
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
-  char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  // bitmap在页上仍按字节存放（第i个槽位是第i/8个字节的第i%8位），计算时按64位字读出
+  static constexpr uint32_t BITMAP_BYTES = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
+  static constexpr uint32_t BITMAP_WORDS = (BUCKET_ARRAY_SIZE - 1) / 64 + 1;
+  // 溢出链上的下一个bucket页
+  page_id_t next_page_id_;
+  char occupied_[BITMAP_BYTES];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
-  char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char readable_[BITMAP_BYTES];
+  // 每个槽位key的hash的高8位，探测时先用SIMD比较fingerprint，命中才调用comparator
+  uint8_t fingerprints_[BUCKET_ARRAY_SIZE];
   MappingType array_[BUCKET_ARRAY_SIZE];
 };
 
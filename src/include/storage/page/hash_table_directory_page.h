@@ -18,6 +18,7 @@
 #include <string>
 
 #include "storage/index/generic_key.h"
+#include "storage/index/integer_key.h"
 #include "storage/page/hash_table_page_defs.h"
 
 namespace bustub {
@@ -114,6 +115,14 @@ class HashTableDirectoryPage {
    */
   uint32_t GetGlobalDepth();
 
+  /**
+   * Sets the global depth without touching the entries. Used when this page
+   * stores one slice of a directory that spans several pages.
+   *
+   * @param global_depth the global depth of the whole directory
+   */
+  void SetGlobalDepth(uint32_t global_depth);
+
   /**
    * Increment the global depth of the directory
    */
@@ -18,18 +18,22 @@
 #include <string>
 
 #include "storage/index/generic_key.h"
+#include "storage/index/integer_key.h"
 #include "storage/page/hash_table_page_defs.h"
 
 namespace bustub {
 
 /**
  *
- * Header Page for linear probing hash table.
+ * Header Page for linear probing hash table. The extendible hash table uses the
+ * same page on two levels to list the pages its directory is spread over: its
+ * header page lists index pages, and each index page lists directory pages.
  *
- * Header format (size in byte, 16 bytes in total):
- * -------------------------------------------------------------
- * | LSN (4) | Size (4) | PageId(4) | NextBlockIndex(4)
- * -------------------------------------------------------------
+ * Header format (size in byte, 32 bytes in total with padding), followed by
+ * the page ids of the blocks, or of the directory pages, to the end of the page:
+ * ------------------------------------------------------------------------------------------------
+ * | LSN (4) | Size (8) | PageId(4) | NextBlockIndex(8) | BlockPageId_0 (4) | BlockPageId_1 (4) | ...
+ * ------------------------------------------------------------------------------------------------
  */
 class HashTableHeaderPage {
  public:
@@ -89,12 +93,17 @@ class HashTableHeaderPage {
    */
   size_t NumBlocks();
 
+  /**
+   * @return the number of block page_ids that fit in a header page
+   */
+  static size_t MaxBlocks();
+
  private:
-  __attribute__((unused)) lsn_t lsn_;
-  __attribute__((unused)) size_t size_;
-  __attribute__((unused)) page_id_t page_id_;
-  __attribute__((unused)) size_t next_ind_;
-  __attribute__((unused)) page_id_t block_page_ids_[0];
+  lsn_t lsn_;
+  size_t size_;
+  page_id_t page_id_;
+  size_t next_ind_;
+  page_id_t block_page_ids_[0];
 };
 
 }  // namespace bustub
@@ -34,13 +34,25 @@
 #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
 #define DIRECTORY_ARRAY_SIZE 512
 
+/**
+ * A directory with more than DIRECTORY_ARRAY_SIZE entries is split into slices of DIRECTORY_ARRAY_SIZE entries, one
+ * directory page per slice. The slice pages are listed in index pages of DIRECTORY_PAGES_PER_INDEX_PAGE page ids each,
+ * and the index pages in the HashTableHeaderPage of the table; both levels use the HashTableHeaderPage layout. The
+ * directory holds at most DIRECTORY_ARRAY_SIZE * MAX_DIRECTORY_PAGES = 2^22 entries.
+ * 目录超过一页时按DIRECTORY_ARRAY_SIZE切片，每片一个目录页，目录页的页号记录在索引页中，索引页的页号记录在header页中
+ */
+#define MAX_DIRECTORY_PAGES 8192
+#define DIRECTORY_PAGES_PER_INDEX_PAGE 512
+
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
  * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
- * 一个Page可以存放的Pair个数，因为需要额外的2 bits来存放occupied_和readable_标志，所以size =
- * page_size/(sizeof(MappingType + 0.25))
+ * The page starts with the page_id of the next overflow page. For each key/value pair, we need two additional bits
+ * for occupied_ and readable_ and one byte for the hash fingerprint.
+ * 4 * (PAGE_SIZE - 4) / (4 * sizeof (MappingType) + 5) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 1.25) because
+ * 1.25 bytes = 1 byte + 2 bits is the space required to maintain the fingerprint and the occupied and readable flags
+ * for a key value pair.
+ * 一个Page除去开头4字节的溢出页页号之后可以存放的Pair个数，因为需要额外的1 byte存放fingerprint以及2 bits来存放
+ * occupied_和readable_标志，所以size = (page_size - 4)/(sizeof(MappingType) + 1.25)
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE (4 * (PAGE_SIZE - sizeof(page_id_t)) / (4 * sizeof(MappingType) + 5))
@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.h
+//
+// Identification: src/include/storage/table/free_space_map.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/page/free_space_map_page.h"
+
+namespace bustub {
+
+/**
+ * FreeSpaceMap tracks the free space of the pages of a table heap, so that an
+ * insert goes straight to a page with room instead of trying the pages one by
+ * one. It is stored in a chain of FreeSpaceMapPage and mirrored in memory by
+ * an index from table page to entry and by an upper bound of the buckets of
+ * every map page, which lets searches skip map pages that have no room.
+ *
+ * The map is a hint: it is not logged, and whoever inserts into a page it
+ * returns checks the page itself and records its actual free space if the
+ * tuple did not fit. A page handed out by Claim is kept from other claims
+ * until it is released, so that concurrent inserters fill different pages.
+ */
+class FreeSpaceMap {
+ public:
+  /**
+   * Create an empty free space map.
+   * @param buffer_pool_manager the buffer pool manager
+   */
+  explicit FreeSpaceMap(BufferPoolManager *buffer_pool_manager);
+
+  /**
+   * Open the free space map stored from first_page_id on.
+   * @param buffer_pool_manager the buffer pool manager
+   * @param first_page_id the id of the first page of the map
+   */
+  FreeSpaceMap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id);
+
+  /** @return the id of the first page of the map */
+  page_id_t GetFirstPageId() const { return first_page_id_; }
+
+  /** @return the table page added last, INVALID_PAGE_ID if the map is empty */
+  page_id_t GetLastPageId() {
+    std::scoped_lock guard(latch_);
+    return last_page_id_;
+  }
+
+  /**
+   * Record a new table page.
+   * @param page_id the table page
+   * @param free_space its free space in bytes
+   * @param claim whether the page is claimed right away, as if Claim had returned it
+   * @return false if no map page could be allocated; the page is not recorded then
+   */
+  bool AddPage(page_id_t page_id, uint32_t free_space, bool claim);
+
+  /**
+   * Find an unclaimed page that has at least size bytes free and claim it.
+   * Searches start where the last one succeeded and wrap around.
+   * @param size the free space needed, in bytes
+   * @return the page, or INVALID_PAGE_ID if no page is known to have room
+   */
+  page_id_t Claim(uint32_t size);
+
+  /**
+   * Record the free space of a table page; a claimed page stays claimed.
+   * @param page_id the table page
+   * @param free_space its free space in bytes
+   */
+  void Update(page_id_t page_id, uint32_t free_space);
+
+  /**
+   * Record the free space of a claimed page and make it available to Claim again.
+   * @param page_id the table page
+   * @param free_space its free space in bytes
+   */
+  void Release(page_id_t page_id, uint32_t free_space);
+
+ private:
+  // records the bucket of a table page; latch_ is held
+  void SetBucket(page_id_t page_id, uint32_t free_space);
+
+  BufferPoolManager *buffer_pool_manager_;
+  page_id_t first_page_id_{INVALID_PAGE_ID};
+  std::mutex latch_;
+  // map pages in chain order
+  std::vector<page_id_t> map_pages_;
+  // 每个map页中bucket的上界，搜索时跳过放不下的map页
+  std::vector<uint8_t> max_buckets_;
+  // table page -> map page index * CAPACITY + slot
+  std::unordered_map<page_id_t, size_t> entries_;
+  std::unordered_set<page_id_t> claimed_;
+  page_id_t last_page_id_{INVALID_PAGE_ID};
+  // the map page where the last claim succeeded
+  size_t cursor_{0};
+};
+
+}  // namespace bustub
@@ -12,9 +12,14 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>  // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
+#include "storage/table/free_space_map.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
 
@@ -23,6 +28,13 @@ namespace bustub {
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * Inserts find a page with room through a FreeSpaceMap, which is created with
+ * the table and whose first page id is kept in the first page of the table, so
+ * that an opened table reopens it. An opened table whose first page records no
+ * map builds one from its pages on first use. Every inserting thread keeps
+ * filling the page it claimed last, so concurrent inserters work on different
+ * pages.
  */
 class TableHeap {
   friend class TableIterator;
@@ -108,11 +120,39 @@ class TableHeap {
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /** @return the id of the first page of the free space map of this table */
+  page_id_t GetFreeSpaceMapPageId() { return GetFreeSpaceMap()->GetFirstPageId(); }
+
  private:
+  /** The number of pages that concurrent inserts fill at a time, one per lane */
+  static constexpr size_t INSERT_LANES = 16;
+
+  /** The page that the inserting threads hashed to a lane fill */
+  struct InsertLane {
+    // 只保护page_id_：插入时取出这一页，插完再放回
+    std::mutex latch_;
+    page_id_t page_id_{INVALID_PAGE_ID};
+  };
+
+  /** @return the free space map, which is opened or else built from the pages of the table on the first call */
+  FreeSpaceMap *GetFreeSpaceMap();
+
+  /**
+   * Append a new page to the table and record it in the free space map, claimed.
+   * @return the new page, or INVALID_PAGE_ID if it could not be created
+   */
+  page_id_t AppendPage(Transaction *txn);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  std::once_flag free_space_map_once_;
+  std::unique_ptr<FreeSpaceMap> free_space_map_;
+  // 保护last_page_id_，同一时间只有一个线程在表的末尾加页
+  std::mutex extend_latch_;
+  page_id_t last_page_id_{INVALID_PAGE_ID};
+  std::array<InsertLane, INSERT_LANES> lanes_;
 };
 
 }  // namespace bustub
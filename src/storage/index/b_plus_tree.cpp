@@ -9,7 +9,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
+#include <type_traits>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -19,30 +21,52 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, bool unique_keys)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      // 内部页分裂前会暂时多放一个孩子，要给它留出位置
+      internal_max_size_(std::min(internal_max_size, static_cast<int>(INTERNAL_PAGE_SIZE) - 1)),
+      unique_keys_(unique_keys),
+      rightmost_leaf_id_(INVALID_PAGE_ID),
+      appending_(false) {
+  // 页内的查找和前缀截断都按字节比较key，不经过comparator
+  if (!comparator_.IsByteOrdered()) {
+    throw Exception(ExceptionType::INVALID, "B+ tree keys must be ordered as byte strings");
+  }
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 /*
- * Return the only value that associated with input key
+ * Append the values associated with input key to result, in record id order if
+ * there are several
  * This method is used for point query
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  return false;
+  Page *page = FindLeafPage(key, false, BPlusTreeOperation::READ);
+  if (page == nullptr) {
+    return false;
+  }
+  ValueType value;
+  bool found = reinterpret_cast<LeafPage *>(page->GetData())->Lookup(key, &value, comparator_);
+  if (found) {
+    // posting list受叶子的锁保护，读完再放锁
+    CollectValues(value, result);
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return found;
 }
 
 /*****************************************************************************
@@ -52,11 +76,194 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * A key that is already in a non-unique tree gets value added to its values.
+ * @return: false if the tree has unique keys and key is a duplicate, or if it
+ * already has the pair, otherwise true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) { return false; }
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  bool appended;
+  if (appending_.load(std::memory_order_relaxed) && AppendToRightmostLeaf(key, value, &appended)) {
+    return appended;
+  }
+
+  // 乐观插入：只对叶子加写锁，叶子插入后不会分裂时直接完成
+  Page *page = FindLeafPage(key, false, BPlusTreeOperation::INSERT);
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+      appending_.store(true, std::memory_order_relaxed);
+    }
+    int index = leaf->Find(key, comparator_);
+    bool duplicate = index >= 0;
+    bool safe = IsSafe(leaf, BPlusTreeOperation::INSERT);
+    bool inserted = false;
+    if (duplicate) {
+      // 重复的key只会改变叶子中的value，叶子不会分裂
+      inserted = !unique_keys_ && AddToPostingList(leaf, index, value);
+    } else if (safe) {
+      leaf->Insert(key, value, comparator_);
+      inserted = true;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+    if (duplicate || safe) {
+      return inserted;
+    }
+  }
+  // 叶子可能分裂（或者树是空的），从根开始悲观地加写锁重来
+  return InsertIntoLeaf(key, value, transaction);
+}
+
+/*
+ * Insert key & value pair unless the tree already has a key that same_key
+ * accepts. Such keys must sort together, from lowest on, with key among them,
+ * as the entries of a unique index that share their key columns do. The check
+ * and the insert happen under the write latch of the leaves from the one that
+ * covers lowest to the one that holds the first key from lowest on, so a
+ * concurrent InsertUnique of a key that shares lowest waits for this one.
+ * @return: false if a key that same_key accepts is already in the tree,
+ * otherwise true.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertUnique(const KeyType &key, const ValueType &value, const KeyType &lowest,
+                                  const std::function<bool(const KeyType &)> &same_key, Transaction *transaction) {
+  // 和InsertIntoLeaf一样，持有smo_latch_时叶子不会被合并掉
+  smo_latch_.RLock();
+  Page *page = FindLeafPage(lowest, false, BPlusTreeOperation::INSERT);
+  if (page == nullptr) {
+    root_latch_.WLock();
+    bool empty = IsEmpty();
+    if (empty) {
+      StartNewTree(key, value);
+    }
+    root_latch_.WUnlock();
+    if (empty) {
+      smo_latch_.RUnlock();
+      return true;
+    }
+    page = FindLeafPage(lowest, false, BPlusTreeOperation::INSERT);
+  }
+
+  // 从左往右给叶子加锁，直到找到lowest之后的第一个key；key要插入的叶子在这些叶子当中
+  std::vector<Page *> pages{page};
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->KeyIndex(lowest, comparator_);
+  while (index == leaf->GetSize() && leaf->GetNextPageId() != INVALID_PAGE_ID) {
+    page = FetchTreePage(leaf->GetNextPageId());
+    page->WLatch();
+    pages.push_back(page);
+    leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    index = 0;
+  }
+  bool duplicate = index < leaf->GetSize() && same_key(leaf->KeyAt(index));
+
+  Page *target = nullptr;
+  for (Page *latched : pages) {
+    if (!duplicate && target == nullptr &&
+        !reinterpret_cast<LeafPage *>(latched->GetData())->ShouldMoveRight(key, comparator_)) {
+      target = latched;
+      continue;
+    }
+    latched->WUnlatch();
+    buffer_pool_manager_->UnpinPage(latched->GetPageId(), false);
+  }
+  bool inserted = target != nullptr && InsertIntoLatchedLeaf(target, key, value);
+  smo_latch_.RUnlock();
+  return inserted;
+}
+
+/*
+ * Insert pairs sorted by key, as Insert would one at a time. Consecutive keys
+ * that fall into the same leaf are inserted under one latch of it, after a
+ * single descent; a key that fills its leaf goes through InsertIntoLeaf to
+ * split it, and the rest of the run descends again. Keys out of order throw an
+ * INVALID exception before anything is inserted.
+ * @return: the number of pairs inserted, leaving out those Insert would reject
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::InsertSorted(const std::vector<MappingType> &pairs, Transaction *transaction) {
+  auto less = [this](const MappingType &lhs, const MappingType &rhs) {
+    return comparator_(lhs.first, rhs.first) < 0;
+  };
+  if (!std::is_sorted(pairs.begin(), pairs.end(), less)) {
+    throw Exception(ExceptionType::INVALID, "keys to insert into a B+ tree as a batch are not sorted");
+  }
+
+  size_t inserted = 0;
+  size_t i = 0;
+  while (i < pairs.size()) {
+    Page *page = FindLeafPage(pairs[i].first, false, BPlusTreeOperation::INSERT);
+    if (page == nullptr) {
+      inserted += InsertIntoLeaf(pairs[i].first, pairs[i].second, transaction) ? 1 : 0;
+      i++;
+      continue;
+    }
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    bool dirty = false;
+    bool split = false;
+    // 后面的key都不小于叶子的下界，到了上界就该去右边的叶子了
+    do {
+      const auto &[key, value] = pairs[i];
+      int index = leaf->Find(key, comparator_);
+      if (index >= 0) {
+        if (!unique_keys_ && AddToPostingList(leaf, index, value)) {
+          inserted++;
+          dirty = true;
+        }
+      } else if (IsSafe(leaf, BPlusTreeOperation::INSERT)) {
+        leaf->Insert(key, value, comparator_);
+        inserted++;
+        dirty = true;
+      } else {
+        split = true;
+        break;
+      }
+      i++;
+    } while (i < pairs.size() && !leaf->ShouldMoveRight(pairs[i].first, comparator_));
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+    if (split) {
+      inserted += InsertIntoLeaf(pairs[i].first, pairs[i].second, transaction) ? 1 : 0;
+      i++;
+    }
+  }
+  return inserted;
+}
+
+/*
+ * Insert into the rightmost leaf without descending from the root, when key
+ * belongs there. The leaf is split here if it fills up, which is why smo_latch_
+ * is held shared throughout, as in InsertIntoLeaf; it also keeps the cached
+ * leaf from being merged away.
+ * @return: false if the rightmost leaf does not cover key, and then nothing was
+ * inserted; otherwise true, with inserted set as Insert would return it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::AppendToRightmostLeaf(const KeyType &key, const ValueType &value, bool *inserted) {
+  smo_latch_.RLock();
+  page_id_t page_id = rightmost_leaf_id_.load();
+  if (page_id == INVALID_PAGE_ID) {
+    smo_latch_.RUnlock();
+    return false;
+  }
+  Page *page = FetchTreePage(page_id);
+  page->WLatch();
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  // 读缓存之后叶子可能刚分裂过，它不再是最右边的叶子
+  bool restart = leaf->GetNextPageId() != INVALID_PAGE_ID;
+  if (restart || NextPageOnDescent(leaf, key, false, false, &restart) != INVALID_PAGE_ID || restart) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    smo_latch_.RUnlock();
+    appending_.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  *inserted = InsertIntoLatchedLeaf(page, key, value);
+  smo_latch_.RUnlock();
+  return true;
+}
+
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -64,19 +271,77 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t page_id;
+  Page *page = NewTreePage(&page_id);
+  auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  root->Insert(key, value, comparator_);
+  root_page_id_ = page_id;
+  rightmost_leaf_id_ = page_id;
+  UpdateRootPageId(1);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 /*
  * Insert constant key & value pair into leaf page
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: false if the tree has unique keys and key is a duplicate, or if it
+ * already has the pair, otherwise true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  return false;
+  // 分裂期间不能有合并，否则节点可能在分裂传到父页之前被合并掉
+  smo_latch_.RLock();
+  Page *page = FindLeafPage(key, false, BPlusTreeOperation::INSERT);
+  if (page == nullptr) {
+    root_latch_.WLock();
+    bool empty = IsEmpty();
+    if (empty) {
+      StartNewTree(key, value);
+    }
+    root_latch_.WUnlock();
+    if (empty) {
+      smo_latch_.RUnlock();
+      return true;
+    }
+    // 另一个线程刚刚建好了树，持有smo_latch_时树不会再变空
+    page = FindLeafPage(key, false, BPlusTreeOperation::INSERT);
+  }
+  bool inserted = InsertIntoLatchedLeaf(page, key, value);
+  smo_latch_.RUnlock();
+  return inserted;
+}
+
+/*
+ * Insert key & value pair into the write latched leaf page that covers key,
+ * splitting it if it becomes full. The latch and pin of the leaf are released.
+ * @return: false if the tree has unique keys and key is a duplicate, or if it
+ * already has the pair, otherwise true.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertIntoLatchedLeaf(Page *page, const KeyType &key, const ValueType &value) {
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->Find(key, comparator_);
+  if (index >= 0) {
+    // 乐观插入放锁之后别的线程插入了同一个key
+    bool inserted = !unique_keys_ && AddToPostingList(leaf, index, value);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+    return inserted;
+  }
+  leaf->Insert(key, value, comparator_);
+  if (leaf->IsFull()) {
+    LeafPage *new_leaf = Split(leaf, key);
+    InsertIntoParent(page, new_leaf->GetLowKey(), new_leaf);
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+  } else {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  return true;
 }
 
 /*
@@ -88,22 +353,282 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
-  return nullptr;
+N *BPLUSTREE_TYPE::Split(N *node, const KeyType &key) {
+  // node在树的右边缘、刚插入的key是它最后一个key时，key多半是递增插入的，新页只分走node顶上的一小部分
+  bool right_edge = node->GetNextPageId() == INVALID_PAGE_ID && comparator_(key, node->KeyAt(node->GetSize() - 1)) == 0;
+  double keep_fraction = right_edge ? RIGHT_EDGE_SPLIT_FRACTION : 0.5;
+  page_id_t page_id;
+  Page *page = NewTreePage(&page_id);
+  // 内部页移动的孩子会马上指向新页，其他分裂可能顺着父指针找过来，填好之前一直锁住
+  page->WLatch();
+  auto *new_node = reinterpret_cast<N *>(page->GetData());
+  new_node->Init(page_id, node->GetParentPageId(), node->GetMaxSize());
+  // 新页接过node上面的一段key范围，链在node右边，它的下界就是插入父页的分隔key
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    node->MoveHalfTo(new_node, keep_fraction);
+    // 新叶子右边的叶子要加锁，把左指针指回新叶子
+    LinkBack(new_node);
+    if (new_node->GetNextPageId() == INVALID_PAGE_ID) {
+      rightmost_leaf_id_ = page_id;
+    }
+  } else {
+    node->MoveHalfTo(new_node, buffer_pool_manager_, keep_fraction);
+  }
+  page->WUnlatch();
+  return new_node;
 }
 
 /*
  * Insert key & value pair into internal page after split
- * @param   old_node      input page from split() method
- * @param   key
+ * @param   old_page      the page that was split, write latched
+ * @param   key           the separator, the low key of new_node
  * @param   new_node      returned page from split() method
- * User needs to first find the parent page of old_node, parent node must be
- * adjusted to take info of new_node into account. Remember to deal with split
- * recursively if necessary.
+ * The parent is found through the parent page id of old_node, moving right
+ * from there when the parent has been split since. The parent is latched
+ * before old_page is released, so two splits of the same node reach the parent
+ * in order. A parent that overflows is split recursively.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+void BPLUSTREE_TYPE::InsertIntoParent(Page *old_page, const KeyType &key, BPlusTreePage *new_node) {
+  auto *old_node = reinterpret_cast<BPlusTreePage *>(old_page->GetData());
+  if (old_node->IsRootPage()) {
+    // 只有持有根页写锁的线程能让树长高
+    page_id_t root_id;
+    Page *page = NewTreePage(&root_id);
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(root_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(root_id);
+    new_node->SetParentPageId(root_id);
+    root_latch_.WLock();
+    root_page_id_ = root_id;
+    UpdateRootPageId(0);
+    root_latch_.WUnlock();
+    buffer_pool_manager_->UnpinPage(root_id, true);
+    old_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(old_page->GetPageId(), true);
+    return;
+  }
+
+  Page *parent_page = FetchTreePage(old_node->GetParentPageId());
+  parent_page->WLatch();
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  while (parent->ShouldMoveRight(key, comparator_)) {
+    Page *next_page = FetchTreePage(parent->GetNextPageId());
+    parent_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);
+    next_page->WLatch();
+    parent_page = next_page;
+    parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  }
+  // 和AdoptChild一样不对孩子加锁写父指针
+  new_node->SetParentPageId(parent->GetPageId());
+  old_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(old_page->GetPageId(), true);
+
+  parent->InsertNode(key, new_node->GetPageId(), comparator_);
+  if (parent->IsFull()) {
+    InternalPage *new_parent = Split(parent, key);
+    InsertIntoParent(parent_page, new_parent->GetLowKey(), new_parent);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+    return;
+  }
+  parent_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from pairs returned by next in ascending key order,
+ * instead of descending from the root for every pair. Leaves are filled to
+ * fill_factor of their capacity, in pairs or in bytes, and appended left to
+ * right; each new page is
+ * linked to its left neighbour and its separator is appended to the rightmost
+ * page of the level above, which grows the tree as needed. Only the rightmost
+ * page of every level is pinned, so the input does not have to fit in memory.
+ * Pages on the right edge may be less full than the others.
+ * Like Insert, a unique tree ignores a key that repeats the previous one; a
+ * non-unique tree collects the values of the repeated key into a posting list.
+ * Keys out of order throw an INVALID exception; the tree stays empty in that
+ * case, and the pages built so far are deleted, as they are when next throws.
+ * A tree that already has keys falls back to inserting one pair at a time. The
+ * new tree is published once it is complete, but concurrent inserts into the
+ * empty tree while it is built are not supported.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(const std::function<bool(KeyType *key, ValueType *value)> &next, double fill_factor,
+                              Transaction *transaction) {
+  KeyType key;
+  ValueType value;
+  if (!IsEmpty()) {
+    while (next(&key, &value)) {
+      Insert(key, value, transaction);
+    }
+    return;
+  }
+
+  // 叶子最多保存max_size - 1个pair；内部页至少留3个孩子，右边缘补齐孩子时才能借出一个
+  int leaf_fill = std::clamp(static_cast<int>(fill_factor * (leaf_max_size_ - 1)), 1, leaf_max_size_ - 1);
+  int internal_fill = std::clamp(static_cast<int>(fill_factor * internal_max_size_), 3, internal_max_size_);
+  // 按字节算的填充率至少一半，否则长key的页刚建好就是下溢的
+  double space_fill = std::max(fill_factor, 0.5);
+  // 每一层最右边的页，都是pin住的，从叶子往上
+  std::vector<Page *> levels;
+  LeafPage *leaf = nullptr;
+  // leaf的最后一个key重复之后，它的所有value
+  std::vector<ValueType> duplicates;
+  try {
+    while (next(&key, &value)) {
+      if (leaf != nullptr) {
+        int cmp = comparator_(key, leaf->KeyAt(leaf->GetSize() - 1));
+        if (cmp == 0) {
+          if (!unique_keys_) {
+            if (duplicates.empty()) {
+              duplicates.push_back(leaf->ValueAt(leaf->GetSize() - 1));
+            }
+            duplicates.push_back(value);
+          }
+          continue;
+        }
+        if (cmp < 0) {
+          throw Exception(ExceptionType::INVALID, "keys to bulk load into a B+ tree are not sorted");
+        }
+        if (!duplicates.empty()) {
+          leaf->SetValueAt(leaf->GetSize() - 1, NewPostingList(&duplicates));
+          duplicates.clear();
+        }
+      }
+      if (leaf == nullptr || leaf->GetSize() >= leaf_fill || leaf->IsFilledTo(space_fill) || !leaf->IsSafeToInsert()) {
+        page_id_t page_id;
+        Page *page = NewTreePage(&page_id);
+        auto *new_leaf = reinterpret_cast<LeafPage *>(page->GetData());
+        new_leaf->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+        if (leaf == nullptr) {
+          levels.push_back(page);
+        } else {
+          // 分隔key只需要把两边分开，截短之后内部页能放下更多的key
+          KeyType separator = ShortestSeparator(leaf->KeyAt(leaf->GetSize() - 1), key);
+          BulkLoadAppend<LeafPage>(&levels, 0, separator, page, internal_fill, space_fill);
+        }
+        leaf = new_leaf;
+      }
+      leaf->Insert(key, value, comparator_);
+    }
+    if (!duplicates.empty()) {
+      leaf->SetValueAt(leaf->GetSize() - 1, NewPostingList(&duplicates));
+    }
+  } catch (...) {
+    // 建到一半的页都挂在levels.back()下面，连同posting list一起删掉
+    if (!levels.empty()) {
+      page_id_t root_id = levels.back()->GetPageId();
+      for (Page *page : levels) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      }
+      DeleteSubtree(root_id);
+    }
+    throw;
+  }
+  if (levels.empty()) {
+    return;
+  }
+
+  // 右边缘的内部页可能只有一个孩子，从左边的兄弟借一个，从上往下补，父页总有至少两个孩子
+  for (int level = static_cast<int>(levels.size()) - 2; level >= 1; level--) {
+    auto *parent = reinterpret_cast<InternalPage *>(levels[level + 1]->GetData());
+    auto *node = reinterpret_cast<InternalPage *>(levels[level]->GetData());
+    if (node->GetSize() >= 2) {
+      continue;
+    }
+    int index = parent->GetSize() - 1;
+    Page *sibling_page = FetchTreePage(parent->ValueAt(index - 1));
+    auto *sibling = reinterpret_cast<InternalPage *>(sibling_page->GetData());
+    Redistribute(sibling, node, parent, index);
+    buffer_pool_manager_->UnpinPage(sibling_page->GetPageId(), true);
+  }
+
+  page_id_t root_id = levels.back()->GetPageId();
+  rightmost_leaf_id_ = levels.front()->GetPageId();
+  for (Page *page : levels) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  root_latch_.WLock();
+  root_page_id_ = root_id;
+  UpdateRootPageId(1);
+  root_latch_.WUnlock();
+}
+
+/*
+ * Append page to the right of the rightmost page of a level and insert
+ * separator, its low key, into the rightmost page of the level above. A full
+ * parent gets a new right neighbour first, recursively; the rightmost page of
+ * the top level gets a new root above it instead. The replaced rightmost page
+ * is unpinned.
+ * Using template N to represent either internal page or leaf page.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N>
+void BPLUSTREE_TYPE::BulkLoadAppend(std::vector<Page *> *levels, size_t level, const KeyType &separator, Page *page,
+                                    int internal_fill, double space_fill) {
+  auto *node = reinterpret_cast<N *>(page->GetData());
+  auto *prev = reinterpret_cast<N *>((*levels)[level]->GetData());
+  prev->SetNextPageId(node->GetPageId());
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    node->SetPrevPageId(prev->GetPageId());
+  }
+  prev->SetHighKey(separator);
+  prev->UpdatePrefix();
+  node->SetLowKey(separator);
+
+  if (level + 1 == levels->size()) {
+    page_id_t root_id;
+    Page *root_page = NewTreePage(&root_id);
+    auto *root = reinterpret_cast<InternalPage *>(root_page->GetData());
+    root->Init(root_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(prev->GetPageId(), separator, node->GetPageId());
+    prev->SetParentPageId(root_id);
+    node->SetParentPageId(root_id);
+    levels->push_back(root_page);
+  } else {
+    auto *parent = reinterpret_cast<InternalPage *>((*levels)[level + 1]->GetData());
+    if (parent->GetSize() >= internal_fill || parent->IsFilledTo(space_fill) || !parent->IsSafeToInsert()) {
+      page_id_t parent_id;
+      Page *parent_page = NewTreePage(&parent_id);
+      auto *new_parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+      new_parent->Init(parent_id, INVALID_PAGE_ID, internal_max_size_);
+      BulkLoadAppend<InternalPage>(levels, level + 1, separator, parent_page, internal_fill, space_fill);
+      parent = new_parent;
+    }
+    parent->InsertNode(separator, node->GetPageId(), comparator_);
+    node->SetParentPageId(parent->GetPageId());
+  }
+  buffer_pool_manager_->UnpinPage(prev->GetPageId(), true);
+  (*levels)[level] = page;
+}
+
+/*
+ * Delete the page page_id, the pages below it and the posting lists its leaves
+ * reference, none of which may be reachable from the tree.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteSubtree(page_id_t page_id) {
+  Page *page = FetchTreePage(page_id);
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      DeletePostingList(leaf->ValueAt(i));
+    }
+  } else {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    for (int i = 0; i < internal->GetSize(); i++) {
+      DeleteSubtree(internal->ValueAt(i));
+    }
+  }
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  DeleteTreePage(page_id);
+}
 
 /*****************************************************************************
  * REMOVE
@@ -114,55 +639,276 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ * All the values of the key are removed.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) { RemoveKey(key, nullptr, transaction); }
+
+/*
+ * Delete the pair of key and value. The key is removed once it has no other
+ * value; a key whose value differs is left alone.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  RemoveKey(key, &value, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveKey(const KeyType &key, const ValueType *value, Transaction *transaction) {
+  // 乐观删除：叶子删除后不会下溢时只需要叶子的写锁
+  Page *page = FindLeafPage(key, false, BPlusTreeOperation::REMOVE);
+  if (page == nullptr) {
+    return;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int index = leaf->Find(key, comparator_);
+  ValueType old_value;
+  bool dirty = false;
+  bool remove_key = false;
+  if (index >= 0) {
+    old_value = leaf->ValueAt(index);
+    if (value != nullptr && IsPostingList(old_value)) {
+      // 只从posting list中删掉一个value，叶子的key不变
+      dirty = RemoveFromPostingList(leaf, index, *value);
+    } else {
+      remove_key = value == nullptr || old_value == *value;
+    }
+  }
+  bool safe = IsSafe(leaf, BPlusTreeOperation::REMOVE);
+  if (remove_key && safe) {
+    leaf->RemoveAndDeleteRecord(key, comparator_);
+    dirty = true;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+  if (remove_key && safe) {
+    DeletePostingList(old_value);
+  } else if (remove_key) {
+    RemoveFromLeaf(key, value, transaction);
+  }
+}
+
+/*
+ * Remove the key with write latches held from the topmost unsafe ancestor down,
+ * then merge or redistribute the pages that underflowed. Pages emptied by merges
+ * are deleted once all latches are released. If value is not nullptr, only the
+ * pair of key and *value is removed, as in Remove.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveFromLeaf(const KeyType &key, const ValueType *value, Transaction *transaction) {
+  // 等所有进行中的分裂完成，合并时树中没有只挂在右指针上的节点
+  smo_latch_.WLock();
+  LatchedPath path;
+  root_latch_.WLock();
+  path.push_back(nullptr);
+  if (IsEmpty()) {
+    ReleaseLatches(&path, false);
+    smo_latch_.WUnlock();
+    return;
+  }
+  FindLeafPagePessimistic(key, BPlusTreeOperation::REMOVE, &path);
+
+  auto *leaf = reinterpret_cast<LeafPage *>(path.back()->GetData());
+  int index = leaf->Find(key, comparator_);
+  ValueType old_value;
+  if (index >= 0) {
+    old_value = leaf->ValueAt(index);
+  }
+  // 乐观删除放锁之后，key可能被删掉了，也可能有了别的value
+  if (index >= 0 && value != nullptr && IsPostingList(old_value)) {
+    bool removed = RemoveFromPostingList(leaf, index, *value);
+    ReleaseLatches(&path, removed);
+    smo_latch_.WUnlock();
+    return;
+  }
+  if (index < 0 || (value != nullptr && !(old_value == *value))) {
+    ReleaseLatches(&path, false);
+    smo_latch_.WUnlock();
+    return;
+  }
+  leaf->RemoveAndDeleteRecord(key, comparator_);
+  std::vector<page_id_t> deleted_pages;
+  if (leaf->IsRootPage() ? leaf->GetSize() == 0 : leaf->IsUnderflow()) {
+    CoalesceOrRedistribute(leaf, &path, &deleted_pages);
+  }
+  ReleaseLatches(&path, true);
+  smo_latch_.WUnlock();
+  // 其他线程要访问一个页，总是在释放指向它的页的锁之前先pin住它，
+  // 所以这里还pin着被删页的线程会发现它已经被标记删除；这些页等它们放开之后再删
+  for (page_id_t page_id : deleted_pages) {
+    DeleteTreePage(page_id);
+  }
+  DeletePostingList(old_value);
+  ReclaimPages();
+}
 
 /*
- * User needs to first find the sibling of input page. If sibling's size + input
- * page's size > page's max size, then redistribute. Otherwise, merge.
+ * User needs to first find the sibling of input page. If the left one of the
+ * two can absorb the right one, merge. Otherwise, redistribute. When the keys
+ * are too long for either, node is left underflowed.
  * Using template N to represent either internal page or leaf page.
- * @return: true means target leaf page should be deleted, false means no
- * deletion happens
+ * Pages that become empty are appended to deleted_pages.
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  return false;
+void BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, LatchedPath *path, std::vector<page_id_t> *deleted_pages) {
+  if (node->IsRootPage()) {
+    if (AdjustRoot(node)) {
+      node->SetPageType(IndexPageType::INVALID_INDEX_PAGE);
+      deleted_pages->push_back(node->GetPageId());
+    }
+    return;
+  }
+
+  InternalPage *parent = GetLatchedParent(node, path);
+  int index = parent->ValueIndex(node->GetPageId());
+  // 第一个孩子和右边的兄弟合并/重分配，其他的和左边的兄弟
+  int sibling_index = index == 0 ? 1 : index - 1;
+  page_id_t sibling_page_id = parent->ValueAt(sibling_index);
+  // 兄弟页只能通过持有写锁的父页到达，这里加锁不会和其他写者交叉
+  Page *sibling_page = FetchTreePage(sibling_page_id);
+  sibling_page->WLatch();
+  auto *sibling = reinterpret_cast<N *>(sibling_page->GetData());
+
+  N *left = index == 0 ? node : sibling;
+  N *right = index == 0 ? sibling : node;
+  bool can_merge;
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    can_merge = left->CanAbsorb(right);
+  } else {
+    can_merge = left->CanAbsorb(right, parent->KeyAt(index == 0 ? 1 : index));
+  }
+  if (!can_merge) {
+    bool redistributed = Redistribute(sibling, node, parent, index);
+    sibling_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(sibling_page_id, redistributed);
+    return;
+  }
+
+  // 总是把右边的页并入左边的页
+  if (index == 0) {
+    Coalesce(node, sibling, parent, sibling_index, deleted_pages);
+  } else {
+    Coalesce(sibling, node, parent, index, deleted_pages);
+  }
+  sibling_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(sibling_page_id, true);
+  if (parent->IsRootPage() ? parent->GetSize() == 1 : parent->IsUnderflow()) {
+    CoalesceOrRedistribute(parent, path, deleted_pages);
+  }
 }
 
 /*
- * Move all the key & value pairs from one page to its sibling page, and notify
- * buffer pool manager to delete this page. Parent page must be adjusted to
- * take info of deletion into account. Remember to deal with coalesce or
- * redistribute recursively if necessary.
+ * Move all the key & value pairs from the right page into its left sibling and
+ * remove the right page from the parent. The right page is recorded in
+ * deleted_pages and deleted by the caller once its latch is released.
  * Using template N to represent either internal page or leaf page.
- * @param   neighbor_node      sibling page of input "node"
- * @param   node               input from method coalesceOrRedistribute()
- * @param   parent             parent page of input "node"
- * @return  true means parent node should be deleted, false means no deletion
- * happend
+ * @param   left          the left one of two sibling pages
+ * @param   right         the right one, emptied by the merge
+ * @param   parent        parent page of both, write latched
+ * @param   right_index   index of right in parent
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
-                              BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
-                              Transaction *transaction) {
-  return false;
+void BPLUSTREE_TYPE::Coalesce(N *left, N *right, InternalPage *parent, int right_index,
+                              std::vector<page_id_t> *deleted_pages) {
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    right->MoveAllTo(left);
+    LinkBack(left);
+    if (left->GetNextPageId() == INVALID_PAGE_ID) {
+      rightmost_leaf_id_ = left->GetPageId();
+    }
+  } else {
+    right->MoveAllTo(left, parent->KeyAt(right_index), buffer_pool_manager_);
+  }
+  parent->Remove(right_index);
+  right->SetPageType(IndexPageType::INVALID_INDEX_PAGE);
+  deleted_pages->push_back(right->GetPageId());
+}
+
+/*
+ * Point the left link of the leaf to the right of leaf back at leaf. Leaves are
+ * latched from left to right here, and reverse scans release a leaf before
+ * they latch the one to its left, so this can not deadlock.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LinkBack(LeafPage *leaf) {
+  if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+    return;
+  }
+  Page *page = FetchTreePage(leaf->GetNextPageId());
+  page->WLatch();
+  reinterpret_cast<LeafPage *>(page->GetData())->SetPrevPageId(leaf->GetPageId());
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
 }
 
 /*
  * Redistribute key & value pairs from one page to its sibling page. If index ==
  * 0, move sibling page's first key & value pair into end of input "node",
  * otherwise move sibling page's last key & value pair into head of input
- * "node".
+ * "node". The new separator is the low key of the right page and the high key
+ * of the left one; for leaves it is cut as short as possible. The fence keys
+ * move before a key moves in, so that the key shares the prefix of the page.
  * Using template N to represent either internal page or leaf page.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
+ * @param   parent             parent page of both
+ * @param   index              index of node in parent
+ * @return  false if nothing was moved, because the neighbor has a single pair
+ * or the moved key or the new separator do not fit
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+bool BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index) {
+  constexpr bool is_leaf = std::is_same_v<N, LeafPage>;
+  int size = neighbor_node->GetSize();
+  if (size < 2) {
+    return false;
+  }
+  int key_index = index == 0 ? 1 : index;
+  KeyType separator;
+  KeyType moved_key;
+  if (index == 0) {
+    // 内部页移过去的是父页中的分隔key，邻居的第二个key成为新的分隔key
+    separator = is_leaf ? ShortestSeparator(neighbor_node->KeyAt(0), neighbor_node->KeyAt(1)) : neighbor_node->KeyAt(1);
+    moved_key = is_leaf ? neighbor_node->KeyAt(0) : parent->KeyAt(1);
+    if (!node->CanAddWithHighKey(moved_key, separator) || !parent->CanReplaceKey(key_index, separator)) {
+      return false;
+    }
+    node->SetHighKey(separator);
+    node->UpdatePrefix();
+  } else {
+    separator = is_leaf ? ShortestSeparator(neighbor_node->KeyAt(size - 2), neighbor_node->KeyAt(size - 1))
+                        : neighbor_node->KeyAt(size - 1);
+    moved_key = neighbor_node->KeyAt(size - 1);
+    if (!node->CanAddWithLowKey(moved_key, separator) || !parent->CanReplaceKey(key_index, separator)) {
+      return false;
+    }
+    node->SetLowKey(separator);
+    node->UpdatePrefix();
+  }
+
+  if (index == 0) {
+    if constexpr (is_leaf) {
+      neighbor_node->MoveFirstToEndOf(node);
+    } else {
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
+    }
+    neighbor_node->SetLowKey(separator);
+  } else {
+    if constexpr (is_leaf) {
+      neighbor_node->MoveLastToFrontOf(node);
+    } else {
+      neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
+    }
+    neighbor_node->SetHighKey(separator);
+  }
+  // 邻居的范围变小了，前缀只会变长
+  neighbor_node->UpdatePrefix();
+  parent->SetKeyAt(key_index, separator);
+  return true;
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -174,7 +920,211 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
+  if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() > 0) {
+      return false;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+    rightmost_leaf_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId(0);
+    return true;
+  }
+  if (old_root_node->GetSize() > 1) {
+    return false;
+  }
+  root_page_id_ = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+  UpdateRootPageId(0);
+  Page *page = FetchTreePage(root_page_id_);
+  reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+  buffer_pool_manager_->UnpinPage(root_page_id_, true);
+  return true;
+}
+
+/*****************************************************************************
+ * POSTING LIST
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsPostingList(const ValueType &value) const {
+  // 唯一索引的value都是记录，不去解释它的slot
+  return !unique_keys_ && BPlusTreePostingPage::IsPostingList(value);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CollectValues(const ValueType &value, std::vector<ValueType> *result) {
+  if (!IsPostingList(value)) {
+    result->push_back(value);
+    return;
+  }
+  page_id_t page_id = value.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = FetchTreePage(page_id);
+    auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    posting->Decode(result);
+    page_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+}
+
+/*
+ * Add value to the values of the key at index of a leaf. The second value of a
+ * key turns its entry into a reference to a new posting list; later ones go
+ * into the page of the list whose range covers them, which is split when it
+ * overflows. The keys of the leaf never change.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::AddToPostingList(LeafPage *leaf, int index, const ValueType &value) {
+  ValueType head = leaf->ValueAt(index);
+  if (!IsPostingList(head)) {
+    if (head == value) {
+      return false;
+    }
+    std::vector<ValueType> values{head, value};
+    leaf->SetValueAt(index, NewPostingList(&values));
+    return true;
+  }
+
+  // 找到第一个value不大于value的最后一页
+  Page *page = FetchTreePage(head.GetPageId());
+  auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  while (posting->GetNextPageId() != INVALID_PAGE_ID) {
+    Page *next_page = FetchTreePage(posting->GetNextPageId());
+    auto *next = reinterpret_cast<BPlusTreePostingPage *>(next_page->GetData());
+    if (BPlusTreePostingPage::Less(value, next->FirstRid())) {
+      buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+      break;
+    }
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+    posting = next;
+  }
+  std::vector<ValueType> values;
+  posting->Decode(&values);
+  auto it = std::lower_bound(values.begin(), values.end(), value, BPlusTreePostingPage::Less);
+  if (it != values.end() && *it == value) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  values.insert(it, value);
+  WritePostingPages(page, values);
+  return true;
+}
+
+/*
+ * Remove value from the posting list of the key at index of a leaf. A page
+ * that becomes empty is unlinked and deleted, and a list that is down to a
+ * single value is replaced by the value itself.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::RemoveFromPostingList(LeafPage *leaf, int index, const ValueType &value) {
+  page_id_t head_id = leaf->ValueAt(index).GetPageId();
+  page_id_t prev_id = INVALID_PAGE_ID;
+  Page *page = FetchTreePage(head_id);
+  auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  while (posting->GetNextPageId() != INVALID_PAGE_ID) {
+    Page *next_page = FetchTreePage(posting->GetNextPageId());
+    auto *next = reinterpret_cast<BPlusTreePostingPage *>(next_page->GetData());
+    if (BPlusTreePostingPage::Less(value, next->FirstRid())) {
+      buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+      break;
+    }
+    prev_id = page->GetPageId();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+    posting = next;
+  }
+  std::vector<ValueType> values;
+  posting->Decode(&values);
+  auto it = std::lower_bound(values.begin(), values.end(), value, BPlusTreePostingPage::Less);
+  if (it == values.end() || !(*it == value)) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  values.erase(it);
+
+  page_id_t page_id = page->GetPageId();
+  if (!values.empty()) {
+    // 两个差合成一个差，编码只会变短
+    posting->Encode(values.data(), static_cast<int>(values.size()));
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  } else {
+    page_id_t next_id = posting->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    DeleteTreePage(page_id);
+    if (prev_id == INVALID_PAGE_ID) {
+      // 一个key至少有两个value时才有posting list，删掉的页后面一定还有页
+      head_id = next_id;
+      leaf->SetValueAt(index, BPlusTreePostingPage::PostingListReference(head_id));
+    } else {
+      Page *prev_page = FetchTreePage(prev_id);
+      reinterpret_cast<BPlusTreePostingPage *>(prev_page->GetData())->SetNextPageId(next_id);
+      buffer_pool_manager_->UnpinPage(prev_id, true);
+    }
+  }
+
+  Page *head_page = FetchTreePage(head_id);
+  auto *head = reinterpret_cast<BPlusTreePostingPage *>(head_page->GetData());
+  if (head->GetSize() == 1 && head->GetNextPageId() == INVALID_PAGE_ID) {
+    leaf->SetValueAt(index, head->FirstRid());
+    buffer_pool_manager_->UnpinPage(head_id, false);
+    DeleteTreePage(head_id);
+  } else {
+    buffer_pool_manager_->UnpinPage(head_id, false);
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType BPLUSTREE_TYPE::NewPostingList(std::vector<ValueType> *values) {
+  std::sort(values->begin(), values->end(), BPlusTreePostingPage::Less);
+  values->erase(std::unique(values->begin(), values->end()), values->end());
+  if (values->size() == 1) {
+    return values->front();
+  }
+  page_id_t page_id;
+  Page *page = NewTreePage(&page_id);
+  reinterpret_cast<BPlusTreePostingPage *>(page->GetData())->Init();
+  WritePostingPages(page, *values);
+  return BPlusTreePostingPage::PostingListReference(page_id);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::WritePostingPages(Page *page, const std::vector<ValueType> &values) {
+  auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  size_t written = posting->Encode(values.data(), static_cast<int>(values.size()));
+  if (written < values.size() && values.size() - written < written) {
+    // 只多出几个value时两页各放一半，否则之后插到这一页的value每次都会分出一个新页
+    written = posting->Encode(values.data(), static_cast<int>(values.size() / 2));
+  }
+  while (written < values.size()) {
+    page_id_t page_id;
+    Page *new_page = NewTreePage(&page_id);
+    auto *new_posting = reinterpret_cast<BPlusTreePostingPage *>(new_page->GetData());
+    new_posting->Init();
+    new_posting->SetNextPageId(posting->GetNextPageId());
+    posting->SetNextPageId(page_id);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    page = new_page;
+    posting = new_posting;
+    written += posting->Encode(values.data() + written, static_cast<int>(values.size() - written));
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeletePostingList(const ValueType &value) {
+  if (!IsPostingList(value)) {
+    return;
+  }
+  page_id_t page_id = value.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = FetchTreePage(page_id);
+    page_id_t next_id = reinterpret_cast<BPlusTreePostingPage *>(page->GetData())->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    DeleteTreePage(page_id);
+    page_id = next_id;
+  }
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -185,15 +1135,82 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  KeyType key{};
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, FindLeafPage(key, true), 0, &comparator_, unique_keys_);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
  * first, then construct index iterator
+ * The iterator starts at the first value of the first key not less than key.
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  Page *page = FindLeafPage(key, false);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, &comparator_, unique_keys_);
+}
+
+/*
+ * Range scan over the keys in [begin, end). The iterator reaches the end
+ * iterator at the first key not less than end, without visiting the leaves
+ * after it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &begin, const KeyType &end) {
+  Page *page = FindLeafPage(begin, false);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(begin, comparator_);
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, &comparator_, unique_keys_, false, &end);
+}
+
+/*
+ * Reverse scan from the last key, found by a descent along the right edge of
+ * the tree. Used for ORDER BY ... DESC and MAX.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin() {
+  KeyType key{};
+  Page *page = FindLeafPage(key, false, BPlusTreeOperation::READ, true);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->GetSize() - 1;
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, &comparator_, unique_keys_, true);
+}
+
+/*
+ * Reverse scan from the last key less than end.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(const KeyType &end) {
+  Page *page = FindLeafPage(end, false);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(end, comparator_) - 1;
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, &comparator_, unique_keys_, true);
+}
+
+/*
+ * Reverse scan over the keys in [begin, end), from the last one.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(const KeyType &begin, const KeyType &end) {
+  Page *page = FindLeafPage(end, false);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(end, comparator_) - 1;
+  return INDEXITERATOR_TYPE(this, buffer_pool_manager_, page, index, &comparator_, unique_keys_, true, &begin);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -212,7 +1229,198 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  return FindLeafPage(key, leftMost, BPlusTreeOperation::READ);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FetchTreePage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a B+ tree page");
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::NewTreePage(page_id_t *page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a B+ tree page");
+  }
+  return page;
+}
+
+/*
+ * Delete a page that is no longer reachable in the tree. A thread that reached
+ * it before it was removed may still have it pinned, and the buffer pool does
+ * not delete pinned pages; such a page is kept and deleted by ReclaimPages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeleteTreePage(page_id_t page_id) {
+  if (!buffer_pool_manager_->DeletePage(page_id)) {
+    std::scoped_lock guard(pending_latch_);
+    pending_pages_.push_back(page_id);
+  }
+}
+
+/*
+ * Retry the deletion of the pages that were still pinned when they were
+ * removed from the tree. Called after every merge; the threads pinning them
+ * only read them to find out that they were deleted, so they are soon unpinned.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReclaimPages() {
+  std::scoped_lock guard(pending_latch_);
+  auto it = std::remove_if(pending_pages_.begin(), pending_pages_.end(),
+                           [this](page_id_t page_id) { return buffer_pool_manager_->DeletePage(page_id); });
+  pending_pages_.erase(it, pending_pages_.end());
+}
+
+/*
+ * B-link descent. The next page is pinned before the latch on the current page
+ * is released, so it can not be deleted in between, and only then latched; a
+ * split that happens meanwhile is recovered from by moving right. Internal pages
+ * are read latched; the leaf is write latched for INSERT and REMOVE.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost, BPlusTreeOperation op, bool rightMost) {
+  // 页的类型在它挂在树上的整个期间都不会变，持有指向它的页的锁时可以先看类型再决定加什么锁
+  auto needs_write = [op](Page *page) {
+    return op != BPlusTreeOperation::READ && reinterpret_cast<BPlusTreePage *>(page->GetData())->IsLeafPage();
+  };
+  auto latch = [](Page *page, bool write) { write ? page->WLatch() : page->RLatch(); };
+  auto unlatch = [this](Page *page, bool write) {
+    write ? page->WUnlatch() : page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  };
+
+  while (true) {
+    root_latch_.RLock();
+    if (IsEmpty()) {
+      root_latch_.RUnlock();
+      return nullptr;
+    }
+    Page *page = FetchTreePage(root_page_id_);
+    bool write = needs_write(page);
+    root_latch_.RUnlock();
+    latch(page, write);
+
+    bool restart = false;
+    page_id_t next_page_id;
+    while ((next_page_id = NextPageOnDescent(reinterpret_cast<BPlusTreePage *>(page->GetData()), key, leftMost,
+                                             rightMost, &restart)) != INVALID_PAGE_ID) {
+      Page *next_page = FetchTreePage(next_page_id);
+      bool next_write = needs_write(next_page);
+      unlatch(page, write);
+      latch(next_page, next_write);
+      page = next_page;
+      write = next_write;
+    }
+    if (!restart) {
+      return page;
+    }
+    unlatch(page, write);
+  }
+}
+
+/*
+ * One step of a B-link descent on a latched node: the right sibling if a split
+ * moved key there, otherwise the child that covers key, or INVALID_PAGE_ID if
+ * node is the leaf that covers it. Sets restart, and returns INVALID_PAGE_ID,
+ * when node was deleted by a merge or a redistribution moved key to its left
+ * sibling. A leftmost descent always takes the first child, a rightmost one the
+ * right sibling or else the last child.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::NextPageOnDescent(BPlusTreePage *node, const KeyType &key, bool leftMost, bool rightMost,
+                                            bool *restart) const {
+  if (node->IsDeleted()) {
+    *restart = true;
+    return INVALID_PAGE_ID;
+  }
+  if (node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    if (leftMost || rightMost) {
+      return rightMost ? leaf->GetNextPageId() : INVALID_PAGE_ID;
+    }
+    *restart = leaf->IsBelowLowKey(key, comparator_);
+    return !*restart && leaf->ShouldMoveRight(key, comparator_) ? leaf->GetNextPageId() : INVALID_PAGE_ID;
+  }
+  auto *internal = reinterpret_cast<InternalPage *>(node);
+  if (leftMost) {
+    return internal->ValueAt(0);
+  }
+  if (rightMost) {
+    return internal->GetNextPageId() != INVALID_PAGE_ID ? internal->GetNextPageId()
+                                                        : internal->ValueAt(internal->GetSize() - 1);
+  }
+  if (internal->IsBelowLowKey(key, comparator_)) {
+    *restart = true;
+    return INVALID_PAGE_ID;
+  }
+  return internal->ShouldMoveRight(key, comparator_) ? internal->GetNextPageId() : internal->Lookup(key, comparator_);
+}
+
+/*
+ * Write latched descent for merges. Whenever the page just latched is safe for
+ * op, the modification can not reach its ancestors, so all latches above it
+ * (and the root latch) are released. The caller holds smo_latch_ exclusively, so
+ * no split is half done and the descent never has to move right.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FindLeafPagePessimistic(const KeyType &key, BPlusTreeOperation op, LatchedPath *path) {
+  page_id_t page_id = root_page_id_;
+  while (true) {
+    Page *page = FetchTreePage(page_id);
+    page->WLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op)) {
+      ReleaseLatches(path, false);
+    }
+    path->push_back(page);
+    if (node->IsLeafPage()) {
+      return;
+    }
+    page_id = reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename BPLUSTREE_TYPE::InternalPage *BPLUSTREE_TYPE::GetLatchedParent(BPlusTreePage *node, LatchedPath *path) {
+  auto it = std::find_if(path->begin(), path->end(),
+                         [node](Page *page) { return page != nullptr && page->GetPageId() == node->GetPageId(); });
+  assert(it != path->end() && it != path->begin() && *(it - 1) != nullptr);
+  return reinterpret_cast<InternalPage *>((*(it - 1))->GetData());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, BPlusTreeOperation op) const {
+  if (op == BPlusTreeOperation::INSERT) {
+    return node->IsLeafPage() ? reinterpret_cast<LeafPage *>(node)->IsSafeToInsert()
+                              : reinterpret_cast<InternalPage *>(node)->IsSafeToInsert();
+  }
+  if (op == BPlusTreeOperation::REMOVE) {
+    if (node->IsRootPage()) {
+      // 根叶子删空、根内部页只剩一个孩子时根会改变
+      return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+    }
+    return node->IsLeafPage() ? reinterpret_cast<LeafPage *>(node)->IsSafeToRemove()
+                              : reinterpret_cast<InternalPage *>(node)->IsSafeToRemove();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseLatches(LatchedPath *path, bool is_dirty) {
+  for (Page *page : *path) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+      continue;
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), is_dirty);
+  }
+  path->clear();
 }
 
 /*
@@ -226,13 +1434,14 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
+  // 多个索引共用header页
+  header_page->WLatch();
+  // a tree that became empty and starts over already has its record
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
+  header_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
@@ -400,5 +1609,7 @@ template class BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTree<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class BPlusTree<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 }  // namespace bustub
@@ -11,6 +11,9 @@
 
 #include "storage/index/b_plus_tree_index.h"
 
+#include "storage/index/external_sort.h"
+#include "type/value_factory.h"
+
 namespace bustub {
 /*
  * Constructor
@@ -18,15 +21,24 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
     : Index(std::move(metadata)),
-      comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(GetMetadata()->GetEntrySchema()),
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 GetMetadata()->IsUnique()) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetEntrySchema());
 
+  // 有included列时树按整个entry判重，唯一索引要让树在叶子的锁下检查key列
+  if (GetMetadata()->IsUnique() && GetMetadata()->HasIncludedColumns()) {
+    KeyType lowest = LowestEntry(key, GetEntrySchema());
+    container_.InsertUnique(
+        index_key, rid, lowest, [&](const KeyType &entry) { return SameKey(entry, lowest); }, transaction);
+    return;
+  }
   container_.Insert(index_key, rid, transaction);
 }
 
@@ -34,16 +46,52 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetEntrySchema());
+
+  // 非唯一索引只删掉这一行的记录
+  container_.Remove(index_key, rid, transaction);
+}
 
-  container_.Remove(index_key, transaction);
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(const std::function<bool(Tuple *key, RID *rid)> &next, Transaction *transaction) {
+  // sort all index keys, spilling to the buffer pool if needed, then build the tree bottom-up
+  ExternalSort<KeyType, ValueType, KeyComparator> sorter(buffer_pool_manager_, comparator_);
+  Tuple key;
+  RID rid;
+  while (next(&key, &rid)) {
+    KeyType index_key;
+    index_key.SetFromKey(key, GetEntrySchema());
+    sorter.Add(index_key, rid);
+  }
+
+  // entries of a key are next to each other; a unique index keeps the first one, as the tree does for equal entries
+  bool skip_duplicates = GetMetadata()->IsUnique() && GetMetadata()->HasIncludedColumns();
+  bool has_last = false;
+  KeyType last;
+  container_.BulkLoad(
+      [&](KeyType *index_key, RID *value) {
+        while (sorter.Next(index_key, value)) {
+          if (!skip_duplicates || !has_last || !SameKey(*index_key, last)) {
+            last = *index_key;
+            has_last = true;
+            return true;
+          }
+        }
+        return false;
+      },
+      BPlusTree<KeyType, ValueType, KeyComparator>::DEFAULT_FILL_FACTOR, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
+  if (GetMetadata()->HasIncludedColumns()) {
+    ScanEntries(LowestEntry(key, GetKeySchema()), result);
+    return;
+  }
+
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetKeySchema());
 
   container_.GetValue(index_key, result, transaction);
 }
@@ -54,13 +102,71 @@ INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) { return container_.Begin(key); }
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &begin, const KeyType &end) {
+  return container_.Begin(begin, end);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetReverseIterator() { return container_.RBegin(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetReverseIterator(const KeyType &begin, const KeyType &end) {
+  return container_.RBegin(begin, end);
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() { return container_.End(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+KeyType BPLUSTREE_INDEX_TYPE::LowestEntry(const Tuple &tuple, const Schema *schema) const {
+  Schema *entry_schema = GetEntrySchema();
+  std::vector<Value> values;
+  values.reserve(entry_schema->GetColumnCount());
+  for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+    values.push_back(tuple.GetValue(schema, i));
+  }
+  for (uint32_t i = GetIndexColumnCount(); i < entry_schema->GetColumnCount(); i++) {
+    values.push_back(ValueFactory::GetNullValueByType(entry_schema->GetColumn(i).GetType()));
+  }
+  KeyType index_key;
+  index_key.SetFromKey(Tuple(values, entry_schema), entry_schema);
+  return index_key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanEntries(const KeyType &lowest, std::vector<RID> *result) {
+  for (auto iterator = container_.Begin(lowest); !iterator.IsEnd() && SameKey((*iterator).first, lowest);
+       ++iterator) {
+    result->push_back((*iterator).second);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::SameKey(const KeyType &lhs, const KeyType &rhs) const {
+  Schema *entry_schema = GetEntrySchema();
+  for (uint32_t i = 0; i < GetIndexColumnCount(); i++) {
+    Value lhs_value = lhs.ToValue(entry_schema, i);
+    Value rhs_value = rhs.ToValue(entry_schema, i);
+    if (lhs_value.IsNull() || rhs_value.IsNull()) {
+      if (lhs_value.IsNull() != rhs_value.IsNull()) {
+        return false;
+      }
+      continue;
+    }
+    if (lhs_value.CompareEquals(rhs_value) != CmpBool::CmpTrue) {
+      return false;
+    }
+  }
+  return true;
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTreeIndex<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class BPlusTreeIndex<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 }  // namespace bustub
@@ -0,0 +1,270 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sort.cpp
+//
+// Identification: src/storage/index/external_sort.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/external_sort.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "common/exception.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+/*
+ * Run page format: | Size (4) | KEY(1)+VALUE(1) | ... | KEY(n)+VALUE(n) |
+ */
+static constexpr size_t RUN_PAGE_HEADER_SIZE = sizeof(uint32_t);
+
+INDEX_TEMPLATE_ARGUMENTS
+static uint32_t *RunPageSize(Page *page) { return reinterpret_cast<uint32_t *>(page->GetData()); }
+
+INDEX_TEMPLATE_ARGUMENTS
+static MappingType *RunPagePairs(Page *page) {
+  return reinterpret_cast<MappingType *>(page->GetData() + RUN_PAGE_HEADER_SIZE);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORT_TYPE::ExternalSort(BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                                 size_t memory_limit)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      // a run fills at least one page
+      run_size_(std::max((PAGE_SIZE - RUN_PAGE_HEADER_SIZE) / sizeof(MappingType),
+                         memory_limit / sizeof(MappingType))) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORT_TYPE::~ExternalSort() {
+  merger_.reset();
+  // runs that were never merged
+  for (const Run &run : runs_) {
+    for (page_id_t page_id : run) {
+      buffer_pool_manager_->DeletePage(page_id);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORT_TYPE::Add(const KeyType &key, const ValueType &value) {
+  assert(!finished_);
+  if (!buffer_.empty() && comparator_(key, buffer_.back().first) < 0) {
+    buffer_sorted_ = false;
+  }
+  buffer_.emplace_back(key, value);
+  size_++;
+  if (buffer_.size() >= run_size_) {
+    SpillBuffer();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORT_TYPE::Next(KeyType *key, ValueType *value) {
+  if (!finished_) {
+    Finish();
+  }
+  if (merger_ == nullptr) {
+    // 所有pair都在内存里
+    if (buffer_index_ == buffer_.size()) {
+      return false;
+    }
+    *key = buffer_[buffer_index_].first;
+    *value = buffer_[buffer_index_].second;
+    buffer_index_++;
+    return true;
+  }
+  MappingType pair;
+  if (!merger_->Next(&pair)) {
+    return false;
+  }
+  *key = pair.first;
+  *value = pair.second;
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORT_TYPE::Finish() {
+  finished_ = true;
+  auto less = [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; };
+  if (runs_.empty()) {
+    if (!buffer_sorted_) {
+      std::stable_sort(buffer_.begin(), buffer_.end(), less);
+    }
+    return;
+  }
+  SpillBuffer();
+  buffer_.shrink_to_fit();
+
+  // merge passes until the remaining runs can be merged at once; adjacent runs are merged so that equal keys keep
+  // their order
+  while (runs_.size() > MERGE_FAN_IN) {
+    std::vector<Run> merged;
+    for (size_t begin = 0; begin < runs_.size(); begin += MERGE_FAN_IN) {
+      size_t end = std::min(begin + MERGE_FAN_IN, runs_.size());
+      Merger merger(this, std::vector<Run>(runs_.begin() + begin, runs_.begin() + end));
+      merged.push_back(WriteRun([&merger](MappingType *pair) { return merger.Next(pair); }));
+    }
+    runs_ = std::move(merged);
+  }
+  merger_ = std::make_unique<Merger>(this, std::move(runs_));
+  runs_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORT_TYPE::SpillBuffer() {
+  if (buffer_.empty()) {
+    return;
+  }
+  if (!buffer_sorted_) {
+    std::stable_sort(buffer_.begin(), buffer_.end(),
+                     [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; });
+  }
+  size_t index = 0;
+  runs_.push_back(WriteRun([this, &index](MappingType *pair) {
+    if (index == buffer_.size()) {
+      return false;
+    }
+    *pair = buffer_[index++];
+    return true;
+  }));
+  num_spilled_runs_++;
+  buffer_.clear();
+  buffer_sorted_ = true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *EXTERNAL_SORT_TYPE::NewRunPage(page_id_t *page_id) {
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate a page to spill a sorted run");
+  }
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+typename EXTERNAL_SORT_TYPE::Run EXTERNAL_SORT_TYPE::WriteRun(const std::function<bool(MappingType *pair)> &next) {
+  const uint32_t pairs_per_page = (PAGE_SIZE - RUN_PAGE_HEADER_SIZE) / sizeof(MappingType);
+  Run run;
+  Page *page = nullptr;
+  MappingType pair;
+  while (next(&pair)) {
+    if (page == nullptr || *RunPageSize<KeyType, ValueType, KeyComparator>(page) == pairs_per_page) {
+      if (page != nullptr) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+      }
+      page_id_t page_id;
+      page = NewRunPage(&page_id);
+      *RunPageSize<KeyType, ValueType, KeyComparator>(page) = 0;
+      run.push_back(page_id);
+    }
+    uint32_t *size = RunPageSize<KeyType, ValueType, KeyComparator>(page);
+    RunPagePairs<KeyType, ValueType, KeyComparator>(page)[(*size)++] = pair;
+  }
+  if (page != nullptr) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  return run;
+}
+
+/*****************************************************************************
+ * MERGER
+ *****************************************************************************/
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORT_TYPE::Merger::Merger(ExternalSort *sort, std::vector<Run> runs) : sort_(sort) {
+  readers_.resize(runs.size());
+  for (size_t i = 0; i < runs.size(); i++) {
+    readers_[i].pages_ = std::move(runs[i]);
+    if (Advance(&readers_[i])) {
+      heap_.push_back(i);
+    }
+  }
+  std::make_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) { return Less(b, a); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORT_TYPE::Merger::~Merger() {
+  // pages of runs that were not consumed to the end
+  for (RunReader &reader : readers_) {
+    if (reader.page_ != nullptr) {
+      sort_->buffer_pool_manager_->UnpinPage(reader.page_->GetPageId(), false);
+      sort_->buffer_pool_manager_->DeletePage(reader.page_->GetPageId());
+    }
+    for (size_t i = reader.next_page_; i < reader.pages_.size(); i++) {
+      sort_->buffer_pool_manager_->DeletePage(reader.pages_[i]);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORT_TYPE::Merger::Next(MappingType *pair) {
+  if (heap_.empty()) {
+    return false;
+  }
+  auto greater = [this](size_t a, size_t b) { return Less(b, a); };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  RunReader *reader = &readers_[heap_.back()];
+  *pair = RunPagePairs<KeyType, ValueType, KeyComparator>(reader->page_)[reader->index_++];
+  if (Advance(reader)) {
+    std::push_heap(heap_.begin(), heap_.end(), greater);
+  } else {
+    heap_.pop_back();
+  }
+  return true;
+}
+
+/*
+ * Makes sure that the reader is positioned on an unread pair, moving on to the
+ * next page of its run when the current one is consumed.
+ * @return false if the run is exhausted
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORT_TYPE::Merger::Advance(RunReader *reader) {
+  BufferPoolManager *bpm = sort_->buffer_pool_manager_;
+  while (reader->page_ == nullptr ||
+         reader->index_ == *RunPageSize<KeyType, ValueType, KeyComparator>(reader->page_)) {
+    if (reader->page_ != nullptr) {
+      page_id_t page_id = reader->page_->GetPageId();
+      bpm->UnpinPage(page_id, false);
+      bpm->DeletePage(page_id);
+      reader->page_ = nullptr;
+    }
+    if (reader->next_page_ == reader->pages_.size()) {
+      return false;
+    }
+    reader->page_ = bpm->FetchPage(reader->pages_[reader->next_page_++]);
+    if (reader->page_ == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch a page of a sorted run");
+    }
+    reader->index_ = 0;
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORT_TYPE::Merger::Less(size_t a, size_t b) const {
+  const RunReader &reader_a = readers_[a];
+  const RunReader &reader_b = readers_[b];
+  const KeyType &key_a = RunPagePairs<KeyType, ValueType, KeyComparator>(reader_a.page_)[reader_a.index_].first;
+  const KeyType &key_b = RunPagePairs<KeyType, ValueType, KeyComparator>(reader_b.page_)[reader_b.index_].first;
+  int cmp = sort_->comparator_(key_a, key_b);
+  // 相等的key按run的顺序输出，保证排序是稳定的
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+template class ExternalSort<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSort<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSort<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSort<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSort<GenericKey<64>, RID, GenericComparator<64>>;
+template class ExternalSort<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class ExternalSort<IntegerKey<8>, RID, IntegerComparator<8>>;
+
+}  // namespace bustub
@@ -2,7 +2,9 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
@@ -15,16 +17,270 @@ INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree,
+                                  BufferPoolManager *buffer_pool_manager, Page *page, int index,
+                                  const KeyComparator *comparator, bool unique_keys, bool reverse, const KeyType *bound)
+    : tree_(tree),
+      buffer_pool_manager_(buffer_pool_manager),
+      unique_keys_(unique_keys),
+      reverse_(reverse),
+      has_bound_(bound != nullptr),
+      comparator_(comparator) {
+  if (page == nullptr) {
+    return;
+  }
+  if (has_bound_) {
+    bound_ = *bound;
+  }
+  EnterLeaf(page);
+  index_ = index;
+  if (reverse_) {
+    SkipExhaustedLeavesBackward();
+  } else {
+    SkipExhaustedLeaves();
+  }
+  StopAtBound();
+  LoadPostingList();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept {
+  *this = std::move(other);
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept {
+  if (this != &other) {
+    Release();
+    tree_ = other.tree_;
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    page_ = std::exchange(other.page_, nullptr);
+    leaf_ = std::exchange(other.leaf_, nullptr);
+    index_ = std::exchange(other.index_, 0);
+    prefetched_page_ = std::exchange(other.prefetched_page_, nullptr);
+    unique_keys_ = other.unique_keys_;
+    reverse_ = other.reverse_;
+    has_bound_ = other.has_bound_;
+    bound_ = other.bound_;
+    bound_in_leaf_ = other.bound_in_leaf_;
+    comparator_ = other.comparator_;
+    postings_ = std::move(other.postings_);
+    other.postings_.clear();
+    posting_index_ = std::exchange(other.posting_index_, 0);
+    next_posting_page_id_ = other.next_posting_page_id_;
+  }
+  return *this;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::IsEnd() { return page_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() {
+  assert(!IsEnd());
+  // 叶子页的key和value分开存放，拼成pair后返回
+  item_ = leaf_->GetItem(index_);
+  if (!postings_.empty()) {
+    item_.second = postings_[posting_index_];
+  }
+  return item_;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  if (!postings_.empty()) {
+    if (reverse_ && posting_index_ > 0) {
+      posting_index_--;
+      return *this;
+    }
+    if (!reverse_ && ++posting_index_ < postings_.size()) {
+      return *this;
+    }
+    if (!reverse_ && next_posting_page_id_ != INVALID_PAGE_ID) {
+      LoadPostingPage(next_posting_page_id_);
+      return *this;
+    }
+    postings_.clear();
+    posting_index_ = 0;
+  }
+  if (reverse_) {
+    index_--;
+    SkipExhaustedLeavesBackward();
+  } else {
+    index_++;
+    SkipExhaustedLeaves();
+  }
+  StopAtBound();
+  LoadPostingList();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  while (page_ != nullptr && index_ >= leaf_->GetSize()) {
+    // 下一个叶子在进入当前叶子时已经pin住了，当前叶子没有释放时它不会被删掉
+    Page *next_page = std::exchange(prefetched_page_, nullptr);
+    if (next_page == nullptr) {
+      Release();
+      return;
+    }
+    // 已经返回了小于boundary的key，接下来从它开始
+    KeyType boundary = leaf_->GetHighKey();
+    Release();
+    next_page->RLatch();
+    auto *next = reinterpret_cast<LeafPage *>(next_page->GetData());
+    // 放锁之后下一个叶子可能被合并进了当前叶子，或者把前面的key重分配给了它，顺着右指针会漏掉这些key
+    if (next->IsDeleted() || !next->HasLowKey() || (*comparator_)(next->GetLowKey(), boundary) != 0) {
+      next_page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(next_page->GetPageId(), false);
+      next_page = tree_->FindLeafPage(boundary);
+      if (next_page == nullptr) {
+        return;
+      }
+      EnterLeaf(next_page);
+      index_ = leaf_->KeyIndex(boundary, *comparator_);
+      continue;
+    }
+    EnterLeaf(next_page);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedLeavesBackward() {
+  while (page_ != nullptr && index_ < 0) {
+    if (bound_in_leaf_ || !leaf_->HasLowKey()) {
+      Release();
+      return;
+    }
+    // 已经返回了不小于boundary的key，接下来找存放比它小的key的叶子
+    KeyType boundary = leaf_->GetLowKey();
+    Page *page = std::exchange(prefetched_page_, nullptr);
+    Release();
+    if (page == nullptr) {
+      return;
+    }
+    page->RLatch();
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    while (true) {
+      // 读左指针之后，左边的叶子可能被合并掉了（它的左指针指向接收它的key的叶子），也可能分裂了
+      page_id_t page_id;
+      if (leaf->IsDeleted()) {
+        page_id = leaf->GetPrevPageId();
+      } else if (leaf->GetNextPageId() != INVALID_PAGE_ID && (*comparator_)(leaf->GetHighKey(), boundary) < 0) {
+        page_id = leaf->GetNextPageId();
+      } else {
+        break;
+      }
+      Page *next_page = FetchNextLeaf(page_id);
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      next_page->RLatch();
+      page = next_page;
+      leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    }
+    EnterLeaf(page);
+    index_ = leaf_->KeyIndex(boundary, *comparator_) - 1;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::StopAtBound() {
+  if (page_ == nullptr || !bound_in_leaf_) {
+    return;
+  }
+  int cmp = (*comparator_)(leaf_->KeyAt(index_), bound_);
+  if (reverse_ ? cmp < 0 : cmp >= 0) {
+    Release();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::EnterLeaf(Page *page) {
+  page_ = page;
+  leaf_ = reinterpret_cast<LeafPage *>(page->GetData());
+  index_ = 0;
+  // 范围在这个叶子结束时不用看后面的叶子
+  if (reverse_) {
+    bound_in_leaf_ = has_bound_ && (!leaf_->HasLowKey() || (*comparator_)(bound_, leaf_->GetLowKey()) >= 0);
+  } else {
+    bound_in_leaf_ = has_bound_ && (leaf_->GetNextPageId() == INVALID_PAGE_ID ||
+                                    (*comparator_)(bound_, leaf_->GetHighKey()) <= 0);
+  }
+  // 持有当前叶子的读锁时它的左右指针都不会变
+  if (!bound_in_leaf_) {
+    prefetched_page_ = FetchNextLeaf(reverse_ ? leaf_->GetPrevPageId() : leaf_->GetNextPageId());
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *INDEXITERATOR_TYPE::FetchNextLeaf(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  assert(page != nullptr);
+  return page;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::LoadPostingList() {
+  if (page_ == nullptr || unique_keys_) {
+    return;
+  }
+  ValueType value = leaf_->ValueAt(index_);
+  if (!BPlusTreePostingPage::IsPostingList(value)) {
+    return;
+  }
+  if (!reverse_) {
+    LoadPostingPage(value.GetPageId());
+    return;
+  }
+  // 反向迭代从最后一个value开始，整个posting list一起读进来
+  postings_.clear();
+  for (page_id_t page_id = value.GetPageId(); page_id != INVALID_PAGE_ID;) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    assert(page != nullptr);
+    auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+    posting->Decode(&postings_);
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = posting->GetNextPageId();
+  }
+  posting_index_ = postings_.size() - 1;
+  next_posting_page_id_ = INVALID_PAGE_ID;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::LoadPostingPage(page_id_t page_id) {
+  // posting list由当前叶子的读锁保护，在迭代器离开这个key之前不会变
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  assert(page != nullptr);
+  auto *posting = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  postings_.clear();
+  posting->Decode(&postings_);
+  posting_index_ = 0;
+  next_posting_page_id_ = posting->GetNextPageId();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+  }
+  if (prefetched_page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(prefetched_page_->GetPageId(), false);
+  }
+  page_ = nullptr;
+  prefetched_page_ = nullptr;
+  leaf_ = nullptr;
+  index_ = 0;
+  postings_.clear();
+  posting_index_ = 0;
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -35,5 +291,7 @@ template class IndexIterator<GenericKey<16>, RID, GenericComparator<16>>;
 template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
+template class IndexIterator<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class IndexIterator<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 }  // namespace bustub
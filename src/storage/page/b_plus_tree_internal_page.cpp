@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -16,6 +17,17 @@
 #include "storage/page/b_plus_tree_internal_page.h"
 
 namespace bustub {
+
+// 把孩子页的父指针改为新的父页，分裂/合并/重分配移动孩子时调用
+static void AdoptChild(page_id_t child_page_id, page_id_t parent_page_id, BufferPoolManager *buffer_pool_manager) {
+  Page *page = buffer_pool_manager->FetchPage(child_page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch the child page of a B+ tree internal page");
+  }
+  reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(parent_page_id);
+  buffer_pool_manager->UnpinPage(child_page_id, true);
+}
+
 /*****************************************************************************
  * HELPER METHODS AND UTILITIES
  *****************************************************************************/
@@ -25,34 +37,199 @@ namespace bustub {
  * max page size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+  static_assert(sizeof(BPlusTreeInternalPage) <= PAGE_SIZE, "internal page does not fit in a page");
+  SetPageType(IndexPageType::INTERNAL_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  has_low_key_ = 0;
+  entries_.Init();
+  SetMaxSize(max_size);
+  SetLSN();
+}
+
+/*
+ * Helper methods to set/get the right link and the fence keys. The high key
+ * only means something while the page has a right sibling.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetHighKey() const { return high_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetHighKey(const KeyType &key) { high_key_ = key; }
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetLowKey() const { return low_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetLowKey(const KeyType &key) {
+  low_key_ = key;
+  has_low_key_ = 1;
+}
+
+/*
+ * Encode the keys again with the prefix of the current fence keys, see
+ * BPlusTreeLeafPage::UpdatePrefix.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::UpdatePrefix() {
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, next_page_id_ != INVALID_PAGE_ID, high_key_);
+  if (prefix_length != entries_.GetPrefixLength()) {
+    entries_.SetPrefix(GetSize(), low_key_, prefix_length);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::FencePrefixLength(bool has_low_key, const KeyType &low_key, bool has_high_key,
+                                                      const KeyType &high_key) const {
+  return has_low_key && has_high_key ? EntryArray::FencePrefixLength(low_key, high_key) : 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const {
+  return next_page_id_ != INVALID_PAGE_ID && comparator(key, high_key_) >= 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const {
+  return has_low_key_ != 0 && comparator(key, low_key_) < 0;
+}
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  KeyType key{};
-  return key;
-}
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const { return entries_.KeyAt(index); }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  entries_.SetKeyAt(GetSize(), index, key);
+}
 
 /*
  * Helper method to find and return array index(or offset), so that its value
  * equals to input "value"
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const { return 0; }
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const {
+  for (int i = 0; i < GetSize(); i++) {
+    if (entries_.ValueAt(i) == value) {
+      return i;
+    }
+  }
+  return -1;
+}
 
 /*
  * Helper method to get the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return 0; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return entries_.ValueAt(index); }
+
+/*****************************************************************************
+ * SPACE
+ *****************************************************************************/
+/*
+ * The page has to split: it holds more than max_size children or can not take
+ * one more key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsFull() const {
+  return GetSize() > GetMaxSize() || entries_.GetFreeSpace(GetSize()) < EntryArray::MAX_ENTRY_SIZE;
+}
+
+/*
+ * Inserting any key leaves the page not full.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsSafeToInsert() const {
+  return GetSize() < GetMaxSize() && entries_.GetFreeSpace(GetSize()) >= 2 * EntryArray::MAX_ENTRY_SIZE;
+}
+
+/*
+ * A page that is not the root has to be merged or redistributed: it holds less
+ * than min_size children, and their keys take less than half of the space.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsUnderflow() const {
+  return GetSize() < GetMinSize() && 2 * entries_.GetUsedSpace(GetSize()) < EntryArray::DATA_SIZE;
+}
+
+/*
+ * Removing any child leaves a page that is not the root without underflow.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsSafeToRemove() const {
+  return GetSize() > GetMinSize() ||
+         2 * (entries_.GetUsedSpace(GetSize()) - EntryArray::MAX_ENTRY_SIZE) >= EntryArray::DATA_SIZE;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::IsFilledTo(double fill_factor) const {
+  return entries_.GetUsedSpace(GetSize()) > fill_factor * EntryArray::DATA_SIZE;
+}
+
+/*
+ * Whether I, the left sibling, can take all children of right without becoming
+ * full. The invalid first key of right is replaced by middle_key from the
+ * parent, and the merged page has my low key and the high key of right.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanAbsorb(const BPlusTreeInternalPage *right, const KeyType &middle_key) const {
+  if (GetSize() + right->GetSize() > GetMaxSize()) {
+    return false;
+  }
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, right->next_page_id_ != INVALID_PAGE_ID,
+                                        right->high_key_);
+  int space = entries_.RequiredSpace(GetSize(), prefix_length) +
+              right->entries_.RequiredSpace(right->GetSize(), prefix_length) -
+              EntryArray::EntrySize(right->KeyAt(0), prefix_length) + EntryArray::EntrySize(middle_key, prefix_length);
+  return FitsWithPrefix(prefix_length, space);
+}
+
+/*
+ * Whether key can be added, without the page becoming full, once the low or
+ * the high key is moved to widen the key range for it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanAddWithLowKey(const KeyType &key, const KeyType &low_key) const {
+  int prefix_length = FencePrefixLength(true, low_key, next_page_id_ != INVALID_PAGE_ID, high_key_);
+  return FitsWithPrefix(prefix_length,
+                        entries_.RequiredSpace(GetSize(), prefix_length) + EntryArray::EntrySize(key, prefix_length));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanAddWithHighKey(const KeyType &key, const KeyType &high_key) const {
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, true, high_key);
+  return FitsWithPrefix(prefix_length,
+                        entries_.RequiredSpace(GetSize(), prefix_length) + EntryArray::EntrySize(key, prefix_length));
+}
+
+/*
+ * Whether the key at index can be replaced by key, a separator of the same
+ * key range, without the page becoming full.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanReplaceKey(int index, const KeyType &key) const {
+  return entries_.GetFreeSpace(GetSize()) + entries_.EntrySizeAt(index) -
+             EntryArray::EntrySize(key, entries_.GetPrefixLength()) >=
+         EntryArray::MAX_ENTRY_SIZE;
+}
+
+// 放下之后还要留出一个最长的孩子的空间，否则页就满了
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::FitsWithPrefix(int prefix_length, int space) const {
+  return prefix_length + space <= EntryArray::DATA_SIZE - EntryArray::MAX_ENTRY_SIZE;
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -64,7 +241,8 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const { return 0; }
  */
 INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const {
-  return INVALID_PAGE_ID;
+  // 二分查找最后一个key <= 查找key的位置，第一个key无效，从1开始
+  return entries_.ValueAt(entries_.Search(key, 1, GetSize(), true) - 1);
 }
 
 /*****************************************************************************
@@ -78,7 +256,12 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyCo
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
-                                                     const ValueType &new_value) {}
+                                                     const ValueType &new_value) {
+  // 根没有上下界，无效的第一个key存成全零的key，不占tail空间
+  entries_.Insert(0, 0, KeyType{}, old_value);
+  entries_.Insert(1, 1, new_key, new_value);
+  SetSize(2);
+}
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
  * old_value
@@ -87,7 +270,26 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value,
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                                                     const ValueType &new_value) {
-  return 0;
+  entries_.Insert(GetSize(), ValueIndex(old_value) + 1, new_key, new_value);
+  IncreaseSize(1);
+  return GetSize();
+}
+
+/*
+ * Insert new_key & new_value pair at the position given by new_key. Unlike
+ * InsertNodeAfter it does not need the left neighbour of the new child to be in
+ * this page yet, which is the case when the separators of concurrent splits
+ * reach the parent out of order.
+ * @return:  new size after insertion
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNode(const KeyType &new_key, const ValueType &new_value,
+                                               const KeyComparator &comparator) {
+  // 批量加载新建的空页，孩子放在第一个位置
+  int index = GetSize() == 0 ? 0 : entries_.Search(new_key, 1, GetSize(), true);
+  entries_.Insert(GetSize(), index, new_key, new_value);
+  IncreaseSize(1);
+  return GetSize();
 }
 
 /*****************************************************************************
@@ -95,17 +297,37 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * The halves take about the same space, or keep_fraction of it stays here; an
+ * uneven split leaves the recipient at least two children. The recipient
+ * becomes my right sibling: it takes over my right link and high key, and its
+ * first key, the separator to insert into the parent, becomes its low key and
+ * my high key.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
-                                                BufferPoolManager *buffer_pool_manager) {}
-
-/* Copy entries into me, starting from {items} and copy {size} entries.
- * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
- * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
- */
-INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager) {}
+                                                BufferPoolManager *buffer_pool_manager, double keep_fraction) {
+  int total = entries_.RequiredSpace(GetSize(), entries_.GetPrefixLength());
+  // 和批量加载的右边缘一样，不留下只有一个孩子的内部页
+  int max_keep = keep_fraction > 0.5 ? std::max(GetSize() - 2, 1) : GetSize() - 1;
+  int keep = 1;
+  int space = entries_.EntrySizeAt(0);
+  while (keep < max_keep && space < keep_fraction * total) {
+    space += entries_.EntrySizeAt(keep++);
+  }
+  KeyType separator = KeyAt(keep);
+  recipient->SetNextPageId(GetNextPageId());
+  recipient->SetHighKey(GetHighKey());
+  recipient->SetLowKey(separator);
+  recipient->UpdatePrefix();
+  for (int i = keep; i < GetSize(); i++) {
+    recipient->CopyLastFrom(MappingType(KeyAt(i), ValueAt(i)), buffer_pool_manager);
+  }
+  SetSize(keep);
+  SetNextPageId(recipient->GetPageId());
+  SetHighKey(separator);
+  // 按新的上界重新编码，同时去掉移走的key占的空间
+  entries_.SetPrefix(keep, low_key_, FencePrefixLength(has_low_key_ != 0, low_key_, true, high_key_));
+}
 
 /*****************************************************************************
  * REMOVE
@@ -116,14 +338,20 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size, Buf
  * NOTE: store key&value pair continuously after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
+  entries_.Remove(GetSize(), index);
+  IncreaseSize(-1);
+}
 
 /*
  * Remove the only key & value pair in internal page and return the value
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
 INDEX_TEMPLATE_ARGUMENTS
-ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() { return INVALID_PAGE_ID; }
+ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
+  SetSize(0);
+  return ValueAt(0);
+}
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
@@ -136,7 +364,16 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() { return IN
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                               BufferPoolManager *buffer_pool_manager) {}
+                                               BufferPoolManager *buffer_pool_manager) {
+  // 合并后recipient接管我的右指针和上界，先换好前缀再把key移过去
+  recipient->SetNextPageId(GetNextPageId());
+  recipient->SetHighKey(GetHighKey());
+  recipient->UpdatePrefix();
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->CopyLastFrom(MappingType(i == 0 ? middle_key : KeyAt(i), ValueAt(i)), buffer_pool_manager);
+  }
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
@@ -151,14 +388,22 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient,
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                      BufferPoolManager *buffer_pool_manager) {}
+                                                      BufferPoolManager *buffer_pool_manager) {
+  // 移动之后新的第一个key就是父页中新的分隔key，由调用者写回父页
+  recipient->CopyLastFrom(MappingType(middle_key, ValueAt(0)), buffer_pool_manager);
+  Remove(0);
+}
 
 /* Append an entry at the end.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  entries_.Insert(GetSize(), GetSize(), pair.first, pair.second);
+  AdoptChild(pair.second, GetPageId(), buffer_pool_manager);
+  IncreaseSize(1);
+}
 
 /*
  * Remove the last key & value pair from this page to head of "recipient" page.
@@ -169,14 +414,23 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair, Buffe
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
-                                                       BufferPoolManager *buffer_pool_manager) {}
+                                                       BufferPoolManager *buffer_pool_manager) {
+  // 移过去的key留在recipient无效的第一个位置上，就是父页中新的分隔key
+  recipient->SetKeyAt(0, middle_key);
+  recipient->CopyFirstFrom(MappingType(KeyAt(GetSize() - 1), ValueAt(GetSize() - 1)), buffer_pool_manager);
+  Remove(GetSize() - 1);
+}
 
 /* Append an entry at the beginning.
  * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
  * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {}
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
+  entries_.Insert(GetSize(), 0, pair.first, pair.second);
+  AdoptChild(pair.second, GetPageId(), buffer_pool_manager);
+  IncreaseSize(1);
+}
 
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
@@ -184,4 +438,6 @@ template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator
 template class BPlusTreeInternalPage<GenericKey<16>, page_id_t, GenericComparator<16>>;
 template class BPlusTreeInternalPage<GenericKey<32>, page_id_t, GenericComparator<32>>;
 template class BPlusTreeInternalPage<GenericKey<64>, page_id_t, GenericComparator<64>>;
+template class BPlusTreeInternalPage<IntegerKey<4>, page_id_t, IntegerComparator<4>>;
+template class BPlusTreeInternalPage<IntegerKey<8>, page_id_t, IntegerComparator<8>>;
 }  // namespace bustub
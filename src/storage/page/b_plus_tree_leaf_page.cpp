@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <sstream>
 
 #include "common/exception.h"
@@ -27,43 +28,197 @@ namespace bustub {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+  static_assert(sizeof(BPlusTreeLeafPage) <= PAGE_SIZE, "leaf page does not fit in a page");
+  SetPageType(IndexPageType::LEAF_PAGE);
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(parent_id);
+  SetNextPageId(INVALID_PAGE_ID);
+  SetPrevPageId(INVALID_PAGE_ID);
+  has_low_key_ = 0;
+  entries_.Init();
+  SetMaxSize(max_size);
+  SetLSN();
+}
 
 /**
  * Helper methods to set/get next page id
  */
 INDEX_TEMPLATE_ARGUMENTS
-page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const { return INVALID_PAGE_ID; }
+page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
 
 /**
- * Helper method to find the first index i so that array[i].first >= key
+ * Helper methods to set/get prev page id
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetPrevPageId() const { return prev_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetPrevPageId(page_id_t prev_page_id) { prev_page_id_ = prev_page_id; }
+
+/*
+ * Helper methods to get/set the fence keys. The high key only means something
+ * while the page has a right sibling, the low key once it has been set.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::GetHighKey() const { return high_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetHighKey(const KeyType &key) { high_key_ = key; }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::HasLowKey() const { return has_low_key_ != 0; }
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::GetLowKey() const { return low_key_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetLowKey(const KeyType &key) {
+  low_key_ = key;
+  has_low_key_ = 1;
+}
+
+/*
+ * Encode the keys again with the prefix of the current fence keys. The prefix
+ * grows when the key range of the page shrank and shrinks when it grew.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::UpdatePrefix() {
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, next_page_id_ != INVALID_PAGE_ID, high_key_);
+  if (prefix_length != entries_.GetPrefixLength()) {
+    entries_.SetPrefix(GetSize(), low_key_, prefix_length);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::FencePrefixLength(bool has_low_key, const KeyType &low_key, bool has_high_key,
+                                                  const KeyType &high_key) const {
+  return has_low_key && has_high_key ? EntryArray::FencePrefixLength(low_key, high_key) : 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::ShouldMoveRight(const KeyType &key, const KeyComparator &comparator) const {
+  return next_page_id_ != INVALID_PAGE_ID && comparator(key, high_key_) >= 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsBelowLowKey(const KeyType &key, const KeyComparator &comparator) const {
+  return has_low_key_ != 0 && comparator(key, low_key_) < 0;
+}
+
+/**
+ * Helper method to find the first index i so that keys[i] >= key
  * NOTE: This method is only used when generating index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const { return 0; }
+int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const {
+  return entries_.Search(key, 0, GetSize(), false);
+}
 
 /*
  * Helper method to find and return the key associated with input "index"(a.k.a
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
-  // replace with your own code
-  KeyType key{};
-  return key;
-}
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const { return entries_.KeyAt(index); }
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const { return entries_.ValueAt(index); }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, const ValueType &value) { entries_.SetValueAt(index, value); }
 
 /*
  * Helper method to find and return the key & value pair associated with input
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-  // replace with your own code
-  return array_[0];
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const { return MappingType(KeyAt(index), ValueAt(index)); }
+
+/*****************************************************************************
+ * SPACE
+ *****************************************************************************/
+/*
+ * The page has to split: it holds max_size pairs or can not take one more key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsFull() const {
+  return GetSize() >= GetMaxSize() || entries_.GetFreeSpace(GetSize()) < EntryArray::MAX_ENTRY_SIZE;
+}
+
+/*
+ * Inserting any key leaves the page not full.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsSafeToInsert() const {
+  return GetSize() + 1 < GetMaxSize() && entries_.GetFreeSpace(GetSize()) >= 2 * EntryArray::MAX_ENTRY_SIZE;
+}
+
+/*
+ * A page that is not the root has to be merged or redistributed: it holds less
+ * than min_size pairs, and they take less than half of the space.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsUnderflow() const {
+  return GetSize() < GetMinSize() && 2 * entries_.GetUsedSpace(GetSize()) < EntryArray::DATA_SIZE;
+}
+
+/*
+ * Removing any key leaves a page that is not the root without underflow.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsSafeToRemove() const {
+  return GetSize() > GetMinSize() ||
+         2 * (entries_.GetUsedSpace(GetSize()) - EntryArray::MAX_ENTRY_SIZE) >= EntryArray::DATA_SIZE;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::IsFilledTo(double fill_factor) const {
+  return entries_.GetUsedSpace(GetSize()) > fill_factor * EntryArray::DATA_SIZE;
+}
+
+/*
+ * Whether I, the left sibling, can take all pairs of right without becoming
+ * full. The merged page has the low key of me and the high key of right, so
+ * its prefix may be shorter and the keys longer.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanAbsorb(const BPlusTreeLeafPage *right) const {
+  if (GetSize() + right->GetSize() >= GetMaxSize()) {
+    return false;
+  }
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, right->next_page_id_ != INVALID_PAGE_ID,
+                                        right->high_key_);
+  return FitsWithPrefix(prefix_length, entries_.RequiredSpace(GetSize(), prefix_length) +
+                                           right->entries_.RequiredSpace(right->GetSize(), prefix_length));
+}
+
+/*
+ * Whether key can be added, without the page becoming full, once the low or
+ * the high key is moved to widen the key range for it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanAddWithLowKey(const KeyType &key, const KeyType &low_key) const {
+  int prefix_length = FencePrefixLength(true, low_key, next_page_id_ != INVALID_PAGE_ID, high_key_);
+  return FitsWithPrefix(prefix_length,
+                        entries_.RequiredSpace(GetSize(), prefix_length) + EntryArray::EntrySize(key, prefix_length));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanAddWithHighKey(const KeyType &key, const KeyType &high_key) const {
+  int prefix_length = FencePrefixLength(has_low_key_ != 0, low_key_, true, high_key);
+  return FitsWithPrefix(prefix_length,
+                        entries_.RequiredSpace(GetSize(), prefix_length) + EntryArray::EntrySize(key, prefix_length));
+}
+
+// 放下之后还要留出一个最长的pair的空间，否则页就满了
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::FitsWithPrefix(int prefix_length, int space) const {
+  return prefix_length + space <= EntryArray::DATA_SIZE - EntryArray::MAX_ENTRY_SIZE;
 }
 
 /*****************************************************************************
@@ -75,7 +230,14 @@ const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) {
-  return 0;
+  int index = KeyIndex(key, comparator);
+  // key已经存在时不插入，调用者通过size没有变化判断出是重复的key
+  if (index < GetSize() && entries_.KeyEquals(index, key)) {
+    return GetSize();
+  }
+  entries_.Insert(GetSize(), index, key, value);
+  IncreaseSize(1);
+  return GetSize();
 }
 
 /*****************************************************************************
@@ -83,15 +245,36 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &valu
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * The halves take about the same space, or keep_fraction of it stays here. The
+ * recipient always gets at least one pair. The recipient becomes my right
+ * sibling: it takes over my right link and high key, and the shortest key
+ * between the halves becomes its low key and my high key. The caller links
+ * my old right sibling back to the recipient.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {}
-
-/*
- * Copy starting from items, and copy {size} number of elements into me.
- */
-INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient, double keep_fraction) {
+  int total = entries_.RequiredSpace(GetSize(), entries_.GetPrefixLength());
+  int keep = 1;
+  int space = entries_.EntrySizeAt(0);
+  while (keep < GetSize() - 1 && space + entries_.EntrySizeAt(keep) <= keep_fraction * total) {
+    space += entries_.EntrySizeAt(keep++);
+  }
+  KeyType separator = ShortestSeparator(KeyAt(keep - 1), KeyAt(keep));
+  // 先设好recipient的范围和前缀再移动，移过去的key按新的前缀编码
+  recipient->SetNextPageId(GetNextPageId());
+  recipient->SetPrevPageId(GetPageId());
+  recipient->SetHighKey(GetHighKey());
+  recipient->SetLowKey(separator);
+  recipient->UpdatePrefix();
+  for (int i = keep; i < GetSize(); i++) {
+    recipient->CopyLastFrom(GetItem(i));
+  }
+  SetSize(keep);
+  SetNextPageId(recipient->GetPageId());
+  SetHighKey(separator);
+  // 按新的上界重新编码，同时去掉移走的key占的空间
+  entries_.SetPrefix(keep, low_key_, FencePrefixLength(has_low_key_ != 0, low_key_, true, high_key_));
+}
 
 /*****************************************************************************
  * LOOKUP
@@ -103,7 +286,18 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {}
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const {
-  return false;
+  int index = KeyIndex(key, comparator);
+  if (index == GetSize() || !entries_.KeyEquals(index, key)) {
+    return false;
+  }
+  *value = ValueAt(index);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Find(const KeyType &key, const KeyComparator &comparator) const {
+  int index = KeyIndex(key, comparator);
+  return index < GetSize() && entries_.KeyEquals(index, key) ? index : -1;
 }
 
 /*****************************************************************************
@@ -116,7 +310,15 @@ bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
  * @return   page size after deletion
  */
 INDEX_TEMPLATE_ARGUMENTS
-int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) { return 0; }
+int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) {
+  int index = KeyIndex(key, comparator);
+  if (index == GetSize() || !entries_.KeyEquals(index, key)) {
+    return GetSize();
+  }
+  entries_.Remove(GetSize(), index);
+  IncreaseSize(-1);
+  return GetSize();
+}
 
 /*****************************************************************************
  * MERGE
@@ -124,40 +326,69 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const
 /*
  * Remove all of key & value pairs from this page to "recipient" page. Don't forget
  * to update the next_page id in the sibling page
+ * The recipient also takes over my high key, and its prefix is updated before
+ * my keys move in. My own links stay, so an iterator that still reaches me
+ * skips to the right page, or back to the recipient. The caller links the
+ * right page back to the recipient.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  recipient->SetNextPageId(GetNextPageId());
+  recipient->SetHighKey(GetHighKey());
+  recipient->UpdatePrefix();
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->CopyLastFrom(GetItem(i));
+  }
+  SetSize(0);
+}
 
 /*****************************************************************************
  * REDISTRIBUTE
  *****************************************************************************/
 /*
  * Remove the first key & value pair from this page to "recipient" page.
+ * The caller moves the fence keys between us.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyLastFrom(GetItem(0));
+  entries_.Remove(GetSize(), 0);
+  IncreaseSize(-1);
+}
 
 /*
  * Copy the item into the end of my item list. (Append item to my array)
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
+  entries_.Insert(GetSize(), GetSize(), item.first, item.second);
+  IncreaseSize(1);
+}
 
 /*
  * Remove the last key & value pair from this page to "recipient" page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
+  recipient->CopyFirstFrom(GetItem(GetSize() - 1));
+  entries_.Remove(GetSize(), GetSize() - 1);
+  IncreaseSize(-1);
+}
 
 /*
  * Insert item at the front of my items. Move items accordingly.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {}
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
+  entries_.Insert(GetSize(), 0, item.first, item.second);
+  IncreaseSize(1);
+}
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeLeafPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeLeafPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeLeafPage<GenericKey<64>, RID, GenericComparator<64>>;
+template class BPlusTreeLeafPage<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class BPlusTreeLeafPage<IntegerKey<8>, RID, IntegerComparator<8>>;
 }  // namespace bustub
@@ -0,0 +1,87 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_posting_page.cpp
+//
+// Identification: src/storage/page/b_plus_tree_posting_page.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/b_plus_tree_posting_page.h"
+
+#include <cassert>
+
+namespace bustub {
+
+namespace {
+// a uint64_t takes at most 10 bytes as a varint
+constexpr int MAX_VARINT_LENGTH = 10;
+
+int PutVarint(uint8_t *out, uint64_t value) {
+  int length = 0;
+  while (value >= 0x80) {
+    out[length++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = static_cast<uint8_t>(value);
+  return length;
+}
+
+int GetVarint(const uint8_t *in, uint64_t *value) {
+  int length = 0;
+  int shift = 0;
+  *value = 0;
+  while ((in[length] & 0x80) != 0) {
+    *value |= static_cast<uint64_t>(in[length++] & 0x7f) << shift;
+    shift += 7;
+  }
+  *value |= static_cast<uint64_t>(in[length++]) << shift;
+  return length;
+}
+}  // namespace
+
+void BPlusTreePostingPage::Init() {
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+  data_length_ = 0;
+}
+
+RID BPlusTreePostingPage::FirstRid() const {
+  assert(size_ > 0);
+  uint64_t value;
+  GetVarint(data_, &value);
+  return RID(static_cast<int64_t>(value));
+}
+
+void BPlusTreePostingPage::Decode(std::vector<RID> *rids) const {
+  uint64_t value = 0;
+  int offset = 0;
+  for (int i = 0; i < size_; i++) {
+    uint64_t delta;
+    offset += GetVarint(data_ + offset, &delta);
+    // 第一个是完整的值，之后的都是和前一个的差
+    value += delta;
+    rids->emplace_back(static_cast<int64_t>(value));
+  }
+}
+
+int BPlusTreePostingPage::Encode(const RID *rids, int count) {
+  uint64_t prev = 0;
+  int offset = 0;
+  int size = 0;
+  while (size < count && offset + MAX_VARINT_LENGTH <= DATA_SIZE) {
+    auto value = static_cast<uint64_t>(rids[size].Get());
+    assert(size == 0 || value > prev);
+    offset += PutVarint(data_ + offset, value - prev);
+    prev = value;
+    size++;
+  }
+  size_ = size;
+  data_length_ = offset;
+  return size;
+}
+
+}  // namespace bustub
@@ -10,50 +10,121 @@
 //
 //===----------------------------------------------------------------------===//
 #include "storage/page/hash_table_bucket_page.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+
 #include "common/logger.h"
 #include "common/util/hash_util.h"
+#include "container/hash/hash_function.h"
 #include "storage/index/generic_key.h"
+#include "storage/index/integer_key.h"
 #include "storage/index/hash_comparator.h"
 #include "storage/table/tmp_tuple.h"
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) {
+bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result,
+                                      uint8_t fingerprint, bool first_only) {
   bool ok = false;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i) && cmp(key, array_[i].first) == 0) {
-      result->push_back(array_[i].second);
-      ok = true;
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    for (uint64_t mask = MatchFingerprint(fingerprint, base); mask != 0; mask &= mask - 1) {
+      uint32_t i = base + __builtin_ctzll(mask);
+      if (cmp(key, array_[i].first) == 0) {
+        result->push_back(array_[i].second);
+        ok = true;
+        // key唯一时找到第一个就可以返回，不用扫完剩下的槽位
+        if (first_only) {
+          return true;
+        }
+      }
     }
   }
   return ok;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) {
-  int32_t ava = -1;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
-      if (cmp(key, array_[i].first) == 0 && (value == array_[i].second)) {
+bool HASH_TABLE_BUCKET_TYPE::ForEachValue(KeyType key, KeyComparator cmp, uint8_t fingerprint,
+                                          const std::function<bool(const ValueType &)> &callback) {
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    for (uint64_t mask = MatchFingerprint(fingerprint, base); mask != 0; mask &= mask - 1) {
+      uint32_t i = base + __builtin_ctzll(mask);
+      if (cmp(key, array_[i].first) == 0 && !callback(array_[i].second)) {
         return false;
       }
-    } else if (ava == -1) {
-      ava = i;
     }
   }
-  if (ava != -1) {
-    SetOccupied(ava);
-    SetReadable(ava);
-    array_[ava] = MappingType(key, value);
-    return true;
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::Contains(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint) {
+  // 只有fingerprint相同的槽位才可能是重复的pair
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    for (uint64_t mask = MatchFingerprint(fingerprint, base); mask != 0; mask &= mask - 1) {
+      uint32_t i = base + __builtin_ctzll(mask);
+      if (cmp(key, array_[i].first) == 0 && (value == array_[i].second)) {
+        return true;
+      }
+    }
   }
   return false;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
+bool HASH_TABLE_BUCKET_TYPE::ContainsKey(KeyType key, KeyComparator cmp, uint8_t fingerprint) {
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    for (uint64_t mask = MatchFingerprint(fingerprint, base); mask != 0; mask &= mask - 1) {
+      if (cmp(key, array_[base + __builtin_ctzll(mask)].first) == 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::AllKeysEqual(KeyType key, KeyComparator cmp, uint8_t fingerprint) {
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    uint64_t match = MatchFingerprint(fingerprint, base);
+    // 有fingerprint不同的pair，key一定不同
+    if (match != LoadBitmapWord(readable_, base / 64)) {
+      return false;
+    }
+    for (; match != 0; match &= match - 1) {
+      if (cmp(key, array_[base + __builtin_ctzll(match)].first) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint,
+                                    bool unique_key) {
+  if (unique_key ? ContainsKey(key, cmp, fingerprint) : Contains(key, value, cmp, fingerprint)) {
+    return false;
+  }
+  uint32_t i = FirstFreeSlot();
+  if (i == BUCKET_ARRAY_SIZE) {
+    return false;
+  }
+  SetOccupied(i);
+  SetReadable(i);
+  fingerprints_[i] = fingerprint;
+  array_[i] = MappingType(key, value);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp, uint8_t fingerprint) {
+  for (uint32_t base = 0; base < BUCKET_ARRAY_SIZE; base += 64) {
+    for (uint64_t mask = MatchFingerprint(fingerprint, base); mask != 0; mask &= mask - 1) {
+      uint32_t i = base + __builtin_ctzll(mask);
       if (cmp(key, array_[i].first) == 0 && (value == array_[i].second)) {
         RemoveAt(i);
         return true;
@@ -63,6 +134,75 @@ bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator
   return false;
 }
 
+/*
+ * 比较[base, base + 64)这64个槽位的fingerprint，返回其中fingerprint相同且readable的槽位bitmap。
+ * 有AVX2时一次比较32个字节，否则用SSE2一次比较16个字节
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint64_t HASH_TABLE_BUCKET_TYPE::MatchFingerprint(uint8_t fingerprint, uint32_t base) const {
+  uint32_t n = std::min<uint32_t>(64, BUCKET_ARRAY_SIZE - base);
+  const uint8_t *fps = fingerprints_ + base;
+  // 末尾不足64个槽位时拷贝到临时缓冲区，避免读出fingerprints_的范围
+  uint8_t tail[64];
+  if (n < 64) {
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, fps, n);
+    fps = tail;
+  }
+
+  uint64_t match = 0;
+#if defined(__AVX2__)
+  __m256i needle = _mm256_set1_epi8(static_cast<char>(fingerprint));
+  for (int i = 0; i < 2; i++) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(fps + 32 * i));
+    auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    match |= static_cast<uint64_t>(bits) << (32 * i);
+  }
+#elif defined(__SSE2__)
+  __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+  for (int i = 0; i < 4; i++) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fps + 16 * i));
+    auto bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    match |= static_cast<uint64_t>(bits) << (16 * i);
+  }
+#else
+  for (uint32_t i = 0; i < 64; i++) {
+    match |= static_cast<uint64_t>(fps[i] == fingerprint) << i;
+  }
+#endif
+
+  return match & LoadBitmapWord(readable_, base / 64);
+}
+
+/*
+ * 页上的bitmap第i个槽位是第i/8个字节的第i%8位，在小端机器上直接按8字节读出来就是64位的bitmap。
+ * 最后一个字可能不足8字节，多出来的部分补0
+ */
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint64_t HASH_TABLE_BUCKET_TYPE::LoadBitmapWord(const char *bitmap, uint32_t word) {
+  static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "bucket bitmaps are read as little-endian words");
+  uint64_t bits = 0;
+  memcpy(&bits, bitmap + word * 8, std::min<uint32_t>(8, BITMAP_BYTES - word * 8));
+  return bits;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint64_t HASH_TABLE_BUCKET_TYPE::ValidSlotMask(uint32_t word) {
+  uint32_t remain = BUCKET_ARRAY_SIZE - word * 64;
+  return remain >= 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << remain) - 1;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::FirstFreeSlot() const {
+  for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+    uint64_t free = ~LoadBitmapWord(readable_, w) & ValidSlotMask(w);
+    if (free != 0) {
+      return w * 64 + __builtin_ctzll(free);
+    }
+  }
+  return BUCKET_ARRAY_SIZE;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const {
   return array_[bucket_idx].first;
@@ -73,6 +213,11 @@ ValueType HASH_TABLE_BUCKET_TYPE::ValueAt(uint32_t bucket_idx) const {
   return array_[bucket_idx].second;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint8_t HASH_TABLE_BUCKET_TYPE::FingerprintAt(uint32_t bucket_idx) const {
+  return fingerprints_[bucket_idx];
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::RemoveAt(uint32_t bucket_idx) {
   readable_[bucket_idx / 8] &= (~(1 << (bucket_idx % 8)));
@@ -106,68 +251,66 @@ void HASH_TABLE_BUCKET_TYPE::SetReadable(uint32_t bucket_idx) {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::IsFull() {
-  size_t len = (BUCKET_ARRAY_SIZE) / 8;
-  u_int8_t mask = 255;
-  for (size_t i = 0; i < len; i++) {
-    if ((mask & static_cast<uint8_t>(readable_[i])) != mask) {
+  for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+    if (LoadBitmapWord(readable_, w) != ValidSlotMask(w)) {
       return false;
     }
   }
-  size_t remain = BUCKET_ARRAY_SIZE % 8;
-  size_t cnt = 0;
-  for (size_t i = 0; i < remain; i++) {
-    if ((static_cast<uint8_t>(1 << i) & static_cast<uint8_t>(readable_[len])) != 0) {
-      cnt++;
-    }
-  }
-  return cnt == remain;
+  return true;
 }
 
 // 统计bucket中的pair数目有多少个
 template <typename KeyType, typename ValueType, typename KeyComparator>
 uint32_t HASH_TABLE_BUCKET_TYPE::NumReadable() {
   uint32_t ans = 0;
-  size_t len = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
-  for (size_t i = 0; i < len; i++) {
-    for (size_t j = 0; j < 8; j++) {
-      if (readable_[i] & (1 << j)) {
-        ans++;
-      }
-    }
+  for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+    ans += __builtin_popcountll(LoadBitmapWord(readable_, w));
   }
   return ans;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::IsEmpty() {
-  bool is_empty = true;
-  u_int8_t mask = 255;
-  size_t len = (BUCKET_ARRAY_SIZE - 1) / 8 + 1;
-  for (size_t i = 0; i < len; i++) {
-    if ((mask & readable_[i]) > 0) {
-      is_empty = false;
+  for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+    if (LoadBitmapWord(readable_, w) != 0) {
+      return false;
     }
   }
-  return is_empty;
+  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::Init() {
+  static_assert(sizeof(HashTableBucketPage) <= PAGE_SIZE, "bucket page does not fit in a page");
   memset(occupied_, 0, sizeof(occupied_));
   memset(readable_, 0, sizeof(readable_));
-  memset(array_, 0, sizeof(array_));
+  memset(fingerprints_, 0, sizeof(fingerprints_));
+  memset(reinterpret_cast<char *>(array_), 0, sizeof(array_));
+  next_page_id_ = INVALID_PAGE_ID;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-MappingType *HASH_TABLE_BUCKET_TYPE::GetMappingTypeArray() {
-  uint32_t num = NumReadable();
-  MappingType *ans = new MappingType[num];
-  for (uint32_t i = 0, id = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
-      ans[id++] = array_[i];
+bool HASH_TABLE_BUCKET_TYPE::SplitTo(HashTableBucketPage *image, uint32_t high_bit, HashFunction<KeyType> *hash_fn) {
+  // 两个bucket中的pair不可能重复，搬过去时不需要查重，只需要找image的空槽
+  uint32_t next = image->FirstFreeSlot();
+  for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+    for (uint64_t mask = LoadBitmapWord(readable_, w); mask != 0; mask &= mask - 1) {
+      uint32_t i = w * 64 + __builtin_ctzll(mask);
+      if ((static_cast<uint32_t>(hash_fn->GetHash(array_[i].first)) & high_bit) == 0) {
+        continue;
+      }
+      if (next == BUCKET_ARRAY_SIZE) {
+        return false;
+      }
+      image->SetOccupied(next);
+      image->SetReadable(next);
+      image->fingerprints_[next] = fingerprints_[i];
+      image->array_[next] = array_[i];
+      next = image->FirstFreeSlot();
+      RemoveAt(i);
     }
   }
-  return ans;
+  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -200,6 +343,8 @@ template class HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>>;
 template class HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>;
+template class HashTableBucketPage<IntegerKey<4>, RID, IntegerComparator<4>>;
+template class HashTableBucketPage<IntegerKey<8>, RID, IntegerComparator<8>>;
 
 // template class HashTableBucketPage<hash_t, TmpTuple, HashComparator>;
 
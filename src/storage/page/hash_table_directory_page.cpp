@@ -36,6 +36,8 @@ uint32_t HashTableDirectoryPage::GetLocalDepthMask(uint32_t bucket_idx) { return
 
 uint32_t HashTableDirectoryPage::GetGlobalDepthMask() { return (1 << global_depth_) - 1; }
 
+void HashTableDirectoryPage::SetGlobalDepth(uint32_t global_depth) { global_depth_ = global_depth; }
+
 void HashTableDirectoryPage::IncrGlobalDepth() {
   assert(global_depth_ < MAX_BUCKET_DEPTH);
   int old_size = Size();
@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.cpp
+//
+// Identification: src/storage/table/free_space_map.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/free_space_map.h"
+
+#include <algorithm>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+FreeSpaceMap::FreeSpaceMap(BufferPoolManager *buffer_pool_manager) : buffer_pool_manager_(buffer_pool_manager) {
+  Page *page = buffer_pool_manager_->NewPage(&first_page_id_);
+  BUSTUB_ASSERT(page != nullptr, "Couldn't create a page for the free space map.");
+  page->WLatch();
+  reinterpret_cast<FreeSpaceMapPage *>(page->GetData())->Init();
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  map_pages_.push_back(first_page_id_);
+  max_buckets_.push_back(0);
+}
+
+FreeSpaceMap::FreeSpaceMap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id)
+    : buffer_pool_manager_(buffer_pool_manager), first_page_id_(first_page_id) {
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a page of the free space map.");
+    page->RLatch();
+    auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+    size_t base = map_pages_.size() * FreeSpaceMapPage::CAPACITY;
+    uint8_t max_bucket = 0;
+    for (int i = 0; i < map_page->GetSize(); i++) {
+      entries_.emplace(map_page->PageIdAt(i), base + i);
+      max_bucket = std::max(max_bucket, map_page->BucketAt(i));
+      last_page_id_ = map_page->PageIdAt(i);
+    }
+    map_pages_.push_back(page_id);
+    max_buckets_.push_back(max_bucket);
+    page_id_t next_page_id = map_page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+bool FreeSpaceMap::AddPage(page_id_t page_id, uint32_t free_space, bool claim) {
+  std::scoped_lock guard(latch_);
+  page_id_t map_page_id = map_pages_.back();
+  Page *page = buffer_pool_manager_->FetchPage(map_page_id);
+  if (page == nullptr) {
+    return false;
+  }
+  page->WLatch();
+  auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+  if (map_page->GetSize() == FreeSpaceMapPage::CAPACITY) {
+    // 最后一个map页满了，在后面接一个新的
+    page_id_t new_page_id;
+    Page *new_page = buffer_pool_manager_->NewPage(&new_page_id);
+    if (new_page == nullptr) {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(map_page_id, false);
+      return false;
+    }
+    new_page->WLatch();
+    auto *new_map_page = reinterpret_cast<FreeSpaceMapPage *>(new_page->GetData());
+    new_map_page->Init();
+    map_page->SetNextPageId(new_page_id);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(map_page_id, true);
+    page = new_page;
+    map_page = new_map_page;
+    map_page_id = new_page_id;
+    map_pages_.push_back(new_page_id);
+    max_buckets_.push_back(0);
+  }
+  uint8_t bucket = FreeSpaceMapPage::ToBucket(free_space);
+  entries_.emplace(page_id, (map_pages_.size() - 1) * FreeSpaceMapPage::CAPACITY + map_page->GetSize());
+  map_page->Append(page_id, bucket);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(map_page_id, true);
+  max_buckets_.back() = std::max(max_buckets_.back(), bucket);
+  last_page_id_ = page_id;
+  if (claim) {
+    claimed_.insert(page_id);
+  }
+  return true;
+}
+
+page_id_t FreeSpaceMap::Claim(uint32_t size) {
+  uint32_t needed = FreeSpaceMapPage::BucketFor(size);
+  std::scoped_lock guard(latch_);
+  for (size_t k = 0; k < map_pages_.size(); k++) {
+    size_t index = (cursor_ + k) % map_pages_.size();
+    if (max_buckets_[index] < needed) {
+      continue;
+    }
+    Page *page = buffer_pool_manager_->FetchPage(map_pages_[index]);
+    if (page == nullptr) {
+      continue;
+    }
+    page->RLatch();
+    auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+    page_id_t found = INVALID_PAGE_ID;
+    uint8_t max_bucket = 0;
+    for (int i = 0; i < map_page->GetSize() && found == INVALID_PAGE_ID; i++) {
+      // 被占用的页释放时会重新记录空闲空间，上界不必算上它们
+      if (claimed_.count(map_page->PageIdAt(i)) != 0) {
+        continue;
+      }
+      if (map_page->BucketAt(i) >= needed) {
+        found = map_page->PageIdAt(i);
+      }
+      max_bucket = std::max(max_bucket, map_page->BucketAt(i));
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(map_pages_[index], false);
+    if (found != INVALID_PAGE_ID) {
+      claimed_.insert(found);
+      cursor_ = index;
+      return found;
+    }
+    max_buckets_[index] = max_bucket;
+  }
+  return INVALID_PAGE_ID;
+}
+
+void FreeSpaceMap::Update(page_id_t page_id, uint32_t free_space) {
+  std::scoped_lock guard(latch_);
+  SetBucket(page_id, free_space);
+}
+
+void FreeSpaceMap::Release(page_id_t page_id, uint32_t free_space) {
+  std::scoped_lock guard(latch_);
+  SetBucket(page_id, free_space);
+  claimed_.erase(page_id);
+}
+
+void FreeSpaceMap::SetBucket(page_id_t page_id, uint32_t free_space) {
+  auto entry = entries_.find(page_id);
+  if (entry == entries_.end()) {
+    return;
+  }
+  size_t index = entry->second / FreeSpaceMapPage::CAPACITY;
+  int slot = static_cast<int>(entry->second % FreeSpaceMapPage::CAPACITY);
+  Page *page = buffer_pool_manager_->FetchPage(map_pages_[index]);
+  if (page == nullptr) {
+    return;
+  }
+  uint8_t bucket = FreeSpaceMapPage::ToBucket(free_space);
+  page->WLatch();
+  auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+  bool changed = map_page->BucketAt(slot) != bucket;
+  map_page->SetBucketAt(slot, bucket);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(map_pages_[index], changed);
+  max_buckets_[index] = std::max(max_buckets_[index], bucket);
+}
+
+}  // namespace bustub
@@ -11,6 +11,9 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <functional>
+#include <thread>  // NOLINT
+#include <utility>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
@@ -34,57 +37,136 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
   first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  // A new table gets its free space map right away.
+  GetFreeSpaceMap();
 }
 
-bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) {  // larger than one page size
-    txn->SetState(TransactionState::ABORTED);
-    return false;
+FreeSpaceMap *TableHeap::GetFreeSpaceMap() {
+  std::call_once(free_space_map_once_, [this] {
+    page_id_t page_id = first_page_id_;
+    bool recorded = false;
+    auto first_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+    BUSTUB_ASSERT(first_page != nullptr, "Couldn't fetch the first page of the table heap.");
+    first_page->WLatch();
+    page_id_t free_space_map_page_id = first_page->GetFreeSpaceMapPageId();
+    if (free_space_map_page_id != INVALID_PAGE_ID) {
+      free_space_map_ = std::make_unique<FreeSpaceMap>(buffer_pool_manager_, free_space_map_page_id);
+      // 映射里最后记录的页之后可能还有没记下的页，从它开始往后找
+      if (free_space_map_->GetLastPageId() != INVALID_PAGE_ID) {
+        page_id = free_space_map_->GetLastPageId();
+        recorded = true;
+      }
+    } else {
+      free_space_map_ = std::make_unique<FreeSpaceMap>(buffer_pool_manager_);
+      first_page->SetFreeSpaceMapPageId(free_space_map_->GetFirstPageId());
+    }
+    first_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(first_page_id_, free_space_map_page_id == INVALID_PAGE_ID);
+    while (page_id != INVALID_PAGE_ID) {
+      auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+      BUSTUB_ASSERT(page != nullptr, "Couldn't fetch a page of the table heap.");
+      page->RLatch();
+      uint32_t free_space = page->GetFreeSpaceRemaining();
+      page_id_t next_page_id = page->GetNextPageId();
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      if (!recorded) {
+        free_space_map_->AddPage(page_id, free_space, false);
+      }
+      recorded = false;
+      last_page_id_ = page_id;
+      page_id = next_page_id;
+    }
+  });
+  return free_space_map_.get();
+}
+
+page_id_t TableHeap::AppendPage(Transaction *txn) {
+  std::scoped_lock guard(extend_latch_);
+  page_id_t new_page_id;
+  auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&new_page_id));
+  if (new_page == nullptr) {
+    return INVALID_PAGE_ID;
+  }
+  auto last_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id_));
+  if (last_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(new_page_id, false);
+    buffer_pool_manager_->DeletePage(new_page_id);
+    return INVALID_PAGE_ID;
   }
+  new_page->WLatch();
+  last_page->WLatch();
+  last_page->SetNextPageId(new_page_id);
+  new_page->Init(new_page_id, PAGE_SIZE, last_page_id_, log_manager_, txn);
+  last_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(last_page_id_, true);
+  uint32_t free_space = new_page->GetFreeSpaceRemaining();
+  new_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  last_page_id_ = new_page_id;
+  free_space_map_->AddPage(new_page_id, free_space, true);
+  return new_page_id;
+}
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-  if (cur_page == nullptr) {
+bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
+  if (tuple.size_ + 36 > PAGE_SIZE) {  // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
-  cur_page->WLatch();
-  // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
-  // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
-    auto next_page_id = cur_page->GetNextPageId();
-    // If the next page is a valid page,
-    if (next_page_id != INVALID_PAGE_ID) {
-      // Unlatch and unpin the current page.
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-      // And repeat the process with the next page.
-      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
-      cur_page->WLatch();
-    } else {
-      // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
-      // If we could not create a new page,
-      if (new_page == nullptr) {
-        // Then life sucks and we abort the transaction.
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-        txn->SetState(TransactionState::ABORTED);
-        return false;
-      }
-      // Otherwise we were able to create a new page. We initialize it now.
-      new_page->WLatch();
-      cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
-      cur_page = new_page;
+  FreeSpaceMap *free_space_map = GetFreeSpaceMap();
+  // 同一个线程的插入落在同一个lane，一直往这个lane占着的页里插，不同lane占着不同的页
+  InsertLane &lane = lanes_[std::hash<std::thread::id>()(txn->GetThreadId()) % INSERT_LANES];
+  // lane的锁只在取出和放回它的页时持有，读写页和加页时不持有
+  page_id_t page_id;
+  {
+    std::scoped_lock guard(lane.latch_);
+    page_id = std::exchange(lane.page_id_, INVALID_PAGE_ID);
+  }
+  // Insert into the page of the lane, or else into a page the free space map says has enough space.
+  // If no such page exists, create a new page and insert into that.
+  bool is_inserted = false;
+  uint32_t free_space = 0;
+  while (!is_inserted) {
+    if (page_id == INVALID_PAGE_ID) {
+      page_id = free_space_map->Claim(TablePage::RequiredSpace(tuple));
+    }
+    if (page_id == INVALID_PAGE_ID) {
+      page_id = AppendPage(txn);
+    }
+    if (page_id == INVALID_PAGE_ID) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (cur_page == nullptr) {
+      break;
+    }
+    cur_page->WLatch();
+    is_inserted = cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_);
+    free_space = cur_page->GetFreeSpaceRemaining();
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, is_inserted);
+    if (!is_inserted) {
+      // 这一页放不下了，记下它实际的空闲空间后放给别人，再找一页
+      free_space_map->Release(page_id, free_space);
+      page_id = INVALID_PAGE_ID;
     }
   }
-  // This line has caused most of us to double-take and "whoa double unlatch".
-  // We are not, in fact, double unlatching. See the invariant above.
-  cur_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+  // 把页放回lane；同一个lane的另一个线程已经放回了一页时，这一页还给free space map
+  {
+    std::scoped_lock guard(lane.latch_);
+    if (lane.page_id_ == INVALID_PAGE_ID) {
+      lane.page_id_ = std::exchange(page_id, INVALID_PAGE_ID);
+    }
+  }
+  if (page_id != INVALID_PAGE_ID) {
+    free_space_map->Release(page_id, free_space);
+  }
+  if (!is_inserted) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
   return true;
@@ -121,8 +203,12 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   Tuple old_tuple;
   page->WLatch();
   bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  uint32_t free_space = page->GetFreeSpaceRemaining();
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
+  if (is_updated) {
+    GetFreeSpaceMap()->Update(rid.GetPageId(), free_space);
+  }
   // Update the transaction's write set.
   if (is_updated && txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
@@ -138,8 +224,11 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   page->WLatch();
   page->ApplyDelete(rid, txn, log_manager_);
   lock_manager_->Unlock(txn, rid);
+  uint32_t free_space = page->GetFreeSpaceRemaining();
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  // The freed space can take new tuples now.
+  GetFreeSpaceMap()->Update(rid.GetPageId(), free_space);
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
@@ -688,4 +688,250 @@ TEST(CatalogTest, DISABLED_IndexInteraction3) {
   remove("catalog_test.log");
 }
 
+// A linear probe hash index is populated from the existing tuples and can be queried like the default index
+TEST(CatalogTest, LinearProbeIndex) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::BIGINT}, {"B", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  EXPECT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  const int num_tuples = 1000;
+  for (int i = 0; i < num_tuples; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetBigIntValue(i), ValueFactory::GetIntegerValue(i)}, &table_schema};
+    RID rid{};
+    EXPECT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+
+  std::vector<Column> key_columns{{"A", TypeId::BIGINT}};
+  std::vector<uint32_t> key_attrs{0};
+  Schema key_schema{key_columns};
+  auto *index_info = catalog->CreateIndex<BigintKeyType, BigintValueType, BigintComparatorType>(
+      txn.get(), "index1", table_name, table_schema, key_schema, key_attrs, BIGINT_SIZE, BigintHashFunctionType{},
+      IndexType::LinearProbeHashTableIndex);
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  auto *index = index_info->index_.get();
+
+  for (int i = 0; i < num_tuples; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetBigIntValue(i)}, &key_schema};
+    std::vector<RID> results{};
+    index->ScanKey(key, &results, txn.get());
+    ASSERT_EQ(1, results.size()) << "Missing key " << i;
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(CatalogTest, UniqueIndex) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::BIGINT}, {"B", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  EXPECT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  // every key appears twice in the table; the unique index keeps the first tuple of each
+  const int num_keys = 500;
+  for (int i = 0; i < 2 * num_keys; i++) {
+    Tuple tuple{std::vector<Value>{ValueFactory::GetBigIntValue(i % num_keys), ValueFactory::GetIntegerValue(i)},
+                &table_schema};
+    RID rid{};
+    EXPECT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+
+  std::vector<Column> key_columns{{"A", TypeId::BIGINT}};
+  std::vector<uint32_t> key_attrs{0};
+  Schema key_schema{key_columns};
+  for (auto index_type : {IndexType::ExtendibleHashTableIndex, IndexType::LinearProbeHashTableIndex}) {
+    auto *index_info = catalog->CreateIndex<BigintKeyType, BigintValueType, BigintComparatorType>(
+        txn.get(), "index" + std::to_string(static_cast<int>(index_type)), table_name, table_schema, key_schema,
+        key_attrs, BIGINT_SIZE, BigintHashFunctionType{}, index_type, true);
+    EXPECT_NE(Catalog::NULL_INDEX_INFO, index_info);
+    auto *index = index_info->index_.get();
+    EXPECT_TRUE(index->GetMetadata()->IsUnique());
+
+    for (int i = 0; i < num_keys; i++) {
+      Tuple key{std::vector<Value>{ValueFactory::GetBigIntValue(i)}, &key_schema};
+      // later entries for an indexed key are rejected
+      index->InsertEntry(key, RID(0, i + num_keys), txn.get());
+      std::vector<RID> results{};
+      index->ScanKey(key, &results, txn.get());
+      ASSERT_EQ(1, results.size()) << "Wrong values for key " << i;
+    }
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+// A B+ tree index is built bottom-up from the sorted keys of the existing tuples
+// NOLINTNEXTLINE
+TEST(CatalogTest, BPlusTreeIndex) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+  // the tree keeps its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::BIGINT}, {"B", TypeId::INTEGER}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  EXPECT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  // keys in the table are not sorted
+  const int num_tuples = 5000;
+  for (int i = 0; i < num_tuples; i++) {
+    int64_t key = (static_cast<int64_t>(i) * 7919) % num_tuples;
+    Tuple tuple{std::vector<Value>{ValueFactory::GetBigIntValue(key), ValueFactory::GetIntegerValue(i)},
+                &table_schema};
+    RID rid{};
+    EXPECT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+
+  std::vector<Column> key_columns{{"A", TypeId::BIGINT}};
+  std::vector<uint32_t> key_attrs{0};
+  Schema key_schema{key_columns};
+  auto *index_info = catalog->CreateIndex<BigintKeyType, BigintValueType, BigintComparatorType>(
+      txn.get(), "index1", table_name, table_schema, key_schema, key_attrs, BIGINT_SIZE, BigintHashFunctionType{},
+      IndexType::BPlusTreeIndex);
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  auto *index = index_info->index_.get();
+
+  for (int i = 0; i < num_tuples; i++) {
+    Tuple key{std::vector<Value>{ValueFactory::GetBigIntValue(i)}, &key_schema};
+    std::vector<RID> results{};
+    index->ScanKey(key, &results, txn.get());
+    ASSERT_EQ(1, results.size()) << "Missing key " << i;
+    Tuple tuple;
+    ASSERT_TRUE(table_info->table_->GetTuple(results[0], &tuple, txn.get()));
+    EXPECT_EQ(i, tuple.GetValue(&table_schema, 0).GetAs<int64_t>());
+  }
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
+
+// An index on a single integer column is built on IntegerKey, by CreateIntegerIndex and by CreateIndex on GenericKey
+// NOLINTNEXTLINE
+TEST(CatalogTest, IntegerKeyIndex) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+  // the tree keeps its root in the header page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  bpm->UnpinPage(header_page_id, true);
+
+  const std::string table_name{"foobar"};
+  std::vector<Column> columns{{"A", TypeId::INTEGER}, {"B", TypeId::BIGINT}};
+  Schema table_schema{columns};
+  auto *table_info = catalog->CreateTable(txn.get(), table_name, table_schema);
+  EXPECT_NE(Catalog::NULL_TABLE_INFO, table_info);
+
+  // keys are not sorted and half of them are negative
+  const int num_tuples = 5000;
+  for (int i = 0; i < num_tuples; i++) {
+    int64_t key = (static_cast<int64_t>(i) * 7919) % num_tuples - num_tuples / 2;
+    Tuple tuple{std::vector<Value>{ValueFactory::GetIntegerValue(static_cast<int32_t>(key)),
+                                   ValueFactory::GetBigIntValue(key * 1000000007)},
+                &table_schema};
+    RID rid{};
+    EXPECT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+  }
+
+  std::vector<Column> int_columns{{"A", TypeId::INTEGER}};
+  Schema int_schema{int_columns};
+  auto *tree_info = catalog->CreateIntegerIndex(txn.get(), "tree", table_name, table_schema, int_schema, {0},
+                                                IndexType::BPlusTreeIndex);
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, tree_info);
+  auto *tree = dynamic_cast<BPlusTreeIndex<IntegerKey<4>, RID, IntegerComparator<4>> *>(tree_info->index_.get());
+  ASSERT_NE(nullptr, tree);
+
+  // the keys come out in the order of the integers, not of their bytes
+  int64_t expected = -num_tuples / 2;
+  for (auto iterator = tree->GetBeginIterator(); !iterator.IsEnd(); ++iterator) {
+    EXPECT_EQ(expected, (*iterator).first.ToInteger());
+    EXPECT_EQ(expected, (*iterator).first.ToValue(&int_schema, 0).GetAs<int32_t>());
+    expected++;
+  }
+  EXPECT_EQ(num_tuples / 2, expected);
+
+  std::vector<Column> bigint_columns{{"B", TypeId::BIGINT}};
+  Schema bigint_schema{bigint_columns};
+  auto *hash_info = catalog->CreateIntegerIndex(txn.get(), "hash", table_name, table_schema, bigint_schema, {1});
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, hash_info);
+  auto *hash = hash_info->index_.get();
+  EXPECT_NE(nullptr, (dynamic_cast<ExtendibleHashTableIndex<IntegerKey<8>, RID, IntegerComparator<8>> *>(hash)));
+
+  for (int64_t i = -num_tuples / 2; i < num_tuples / 2; i++) {
+    std::vector<RID> results{};
+    tree->ScanKey(Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(static_cast<int32_t>(i))}, &int_schema},
+                  &results, txn.get());
+    ASSERT_EQ(1, results.size()) << "Missing key " << i;
+    RID rid = results[0];
+    results.clear();
+    hash->ScanKey(Tuple{std::vector<Value>{ValueFactory::GetBigIntValue(i * 1000000007)}, &bigint_schema}, &results,
+                  txn.get());
+    ASSERT_EQ(1, results.size()) << "Missing key " << i * 1000000007;
+    EXPECT_EQ(rid, results[0]);
+  }
+
+  // keys of more than one column have no integer index
+  std::vector<Column> pair_columns{{"A", TypeId::INTEGER}, {"B", TypeId::BIGINT}};
+  Schema pair_schema{pair_columns};
+  EXPECT_EQ(Catalog::NULL_INDEX_INFO,
+            catalog->CreateIntegerIndex(txn.get(), "pair", table_name, table_schema, pair_schema, {0, 1}));
+
+  // CreateIndex on GenericKey picks IntegerKey for a single integer column
+  auto *generic_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      txn.get(), "generic", table_name, table_schema, int_schema, {0}, 8, HashFunction<GenericKey<8>>{});
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, generic_info);
+  EXPECT_EQ(sizeof(uint32_t), generic_info->key_size_);
+  auto *generic = generic_info->index_.get();
+  EXPECT_NE(nullptr, (dynamic_cast<ExtendibleHashTableIndex<IntegerKey<4>, RID, IntegerComparator<4>> *>(generic)));
+  std::vector<RID> results{};
+  generic->ScanKey(Tuple{std::vector<Value>{ValueFactory::GetIntegerValue(7)}, &int_schema}, &results, txn.get());
+  EXPECT_EQ(1, results.size());
+
+  auto *bigint_tree_info = catalog->CreateIndex<GenericKey<16>, RID, GenericComparator<16>>(
+      txn.get(), "bigint_tree", table_name, table_schema, bigint_schema, {1}, 16, HashFunction<GenericKey<16>>{},
+      IndexType::BPlusTreeIndex);
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, bigint_tree_info);
+  EXPECT_NE(nullptr,
+            (dynamic_cast<BPlusTreeIndex<IntegerKey<8>, RID, IntegerComparator<8>> *>(bigint_tree_info->index_.get())));
+
+  // keys of more than one column and keys with included columns stay on GenericKey
+  auto *pair_info = catalog->CreateIndex<GenericKey<16>, RID, GenericComparator<16>>(
+      txn.get(), "generic_pair", table_name, table_schema, pair_schema, {0, 1}, 16, HashFunction<GenericKey<16>>{});
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, pair_info);
+  auto *pair = pair_info->index_.get();
+  EXPECT_NE(nullptr, (dynamic_cast<ExtendibleHashTableIndex<GenericKey<16>, RID, GenericComparator<16>> *>(pair)));
+  auto *covering_info = catalog->CreateIndex<GenericKey<16>, RID, GenericComparator<16>>(
+      txn.get(), "covering", table_name, table_schema, int_schema, {0}, 16, HashFunction<GenericKey<16>>{},
+      IndexType::BPlusTreeIndex, false, {1});
+  EXPECT_NE(Catalog::NULL_INDEX_INFO, covering_info);
+  EXPECT_NE(nullptr,
+            (dynamic_cast<BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>> *>(covering_info->index_.get())));
+
+  remove("catalog_test.db");
+  remove("catalog_test.log");
+}
+
 }  // namespace bustub
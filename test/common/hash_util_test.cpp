@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_util_test.cpp
+//
+// Identification: test/common/hash_util_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common/util/hash_util.h"
+#include "execution/plans/aggregation_plan.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// the byte-at-a-time hash HashUtil used before, kept here as the baseline of the benchmark
+static hash_t ByteAtATimeHash(const char *bytes, size_t length) {
+  hash_t hash = length;
+  for (size_t i = 0; i < length; ++i) {
+    hash = ((hash << 5) ^ (hash >> 27)) ^ bytes[i];
+  }
+  return hash;
+}
+
+static hash_t ByteAtATimeCombine(hash_t l, hash_t r) {
+  hash_t both[2] = {l, r};
+  return ByteAtATimeHash(reinterpret_cast<char *>(both), sizeof(hash_t) * 2);
+}
+
+// NOLINTNEXTLINE
+TEST(HashUtilTest, HashBytesTest) {
+  // every input length takes a different path; equal inputs hash equally and a flipped bit changes the hash
+  std::unordered_set<hash_t> hashes;
+  char buffer[256];
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = static_cast<char>(i * 37);
+  }
+  for (size_t length = 0; length <= sizeof(buffer); length++) {
+    hash_t hash = HashUtil::HashBytes(buffer, length);
+    EXPECT_EQ(hash, HashUtil::HashBytes(std::string(buffer, length).data(), length));
+    EXPECT_TRUE(hashes.insert(hash).second) << "Collision at length " << length;
+    for (size_t byte = 0; byte < length; byte += 7) {
+      buffer[byte] ^= 1;
+      EXPECT_NE(hash, HashUtil::HashBytes(buffer, length)) << "Flipped byte " << byte << " of " << length;
+      buffer[byte] ^= 1;
+    }
+  }
+
+  // the same number hashes equally whatever integer type holds it
+  for (int32_t i : {0, 1, -1, 42, 1 << 20}) {
+    Value integer = ValueFactory::GetIntegerValue(i);
+    Value bigint = ValueFactory::GetBigIntValue(i);
+    EXPECT_EQ(HashUtil::HashValue(&integer), HashUtil::HashValue(&bigint));
+  }
+
+  // combining is order dependent
+  EXPECT_NE(HashUtil::CombineHashes(1, 2), HashUtil::CombineHashes(2, 1));
+}
+
+// NOLINTNEXTLINE
+TEST(HashUtilTest, DistributionTest) {
+  // sequential integers and short strings must spread evenly over power-of-two bucket counts
+  const size_t num_buckets = 1024;
+  const size_t num_keys = 100 * num_buckets;
+  std::vector<size_t> int_buckets(num_buckets);
+  std::vector<size_t> string_buckets(num_buckets);
+  for (size_t i = 0; i < num_keys; i++) {
+    Value value = ValueFactory::GetBigIntValue(static_cast<int64_t>(i));
+    int_buckets[HashUtil::HashValue(&value) & (num_buckets - 1)]++;
+    std::string key = "key" + std::to_string(i);
+    string_buckets[HashUtil::HashBytes(key.data(), key.size()) & (num_buckets - 1)]++;
+  }
+  for (size_t i = 0; i < num_buckets; i++) {
+    EXPECT_GT(int_buckets[i], 50U);
+    EXPECT_LT(int_buckets[i], 150U);
+    EXPECT_GT(string_buckets[i], 50U);
+    EXPECT_LT(string_buckets[i], 150U);
+  }
+}
+
+// hashing throughput of the keys used by aggregation and hash join, against the byte-at-a-time baseline.
+// Disabled in the unit test run; run it with --gtest_also_run_disabled_tests
+// NOLINTNEXTLINE
+TEST(HashUtilTest, DISABLED_HashBenchmark) {
+  const int num_keys = 1000000;
+  std::vector<Value> ints;
+  std::vector<Value> strings;
+  for (int i = 0; i < num_keys; i++) {
+    ints.push_back(ValueFactory::GetIntegerValue(i));
+    strings.push_back(ValueFactory::GetVarcharValue("customer#" + std::to_string(static_cast<int64_t>(i) * 7919)));
+  }
+
+  auto time = [](auto &&body) {
+    auto start = std::chrono::steady_clock::now();
+    hash_t sink = body();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_NE(0U, sink);
+    return elapsed;
+  };
+
+  // join/aggregate key hash of one integer column: CombineHashes(0, HashValue(key))
+  double int_old = time([&] {
+    hash_t sink = 0;
+    for (const Value &value : ints) {
+      auto raw = static_cast<int64_t>(value.GetAs<int32_t>());
+      sink += ByteAtATimeCombine(0, ByteAtATimeHash(reinterpret_cast<const char *>(&raw), sizeof(raw)));
+    }
+    return sink;
+  });
+  double int_new = time([&] {
+    hash_t sink = 0;
+    for (const Value &value : ints) {
+      sink += HashUtil::CombineHashes(0, HashUtil::HashValue(&value));
+    }
+    return sink;
+  });
+  double string_old = time([&] {
+    hash_t sink = 0;
+    for (const Value &value : strings) {
+      sink += ByteAtATimeCombine(0, ByteAtATimeHash(value.GetData(), value.GetLength()));
+    }
+    return sink;
+  });
+  double string_new = time([&] {
+    hash_t sink = 0;
+    for (const Value &value : strings) {
+      sink += HashUtil::CombineHashes(0, HashUtil::HashValue(&value));
+    }
+    return sink;
+  });
+  printf("%d integer keys: byte-at-a-time %.1f Mkeys/s, word-at-a-time %.1f Mkeys/s\n", num_keys,
+         num_keys / int_old / 1e6, num_keys / int_new / 1e6);
+  printf("%d varchar keys: byte-at-a-time %.1f Mkeys/s, word-at-a-time %.1f Mkeys/s\n", num_keys,
+         num_keys / string_old / 1e6, num_keys / string_new / 1e6);
+
+  // end to end: group by two integer columns, the way the aggregation executor builds its table
+  double aggregate = time([&] {
+    std::unordered_map<AggregateKey, int> groups;
+    for (int i = 0; i < num_keys; i++) {
+      groups[AggregateKey{{ints[i % 1000], ints[i % 997]}}]++;
+    }
+    return static_cast<hash_t>(groups.size());
+  });
+  printf("%d rows aggregated into 997000 groups: %.1f Mrows/s\n", num_keys, num_keys / aggregate / 1e6);
+
+  // fixed-size GenericKey hashing through std::hash
+  std::vector<GenericKey<16>> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i].SetFromInteger(i);
+  }
+  double generic = time([&] {
+    hash_t sink = 0;
+    for (const auto &key : keys) {
+      sink += std::hash<GenericKey<16>>{}(key);
+    }
+    return sink;
+  });
+  printf("%d GenericKey<16> keys: %.1f Mkeys/s\n", num_keys, num_keys / generic / 1e6);
+}
+
+}  // namespace bustub
@@ -15,13 +15,25 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "common/logger.h"
+#include "container/hash/hash_function.h"
 #include "gtest/gtest.h"
 #include "storage/disk/disk_manager.h"
+#include "storage/index/generic_key.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
+#include "test_util.h"  // NOLINT
 
 namespace bustub {
 
+namespace {
+
+// the fingerprint the hash table stores with an int key
+uint8_t IntFingerprint(int key) {
+  return HashTableBucketPage<int, int, IntComparator>::HashToFingerprint(HashFunction<int>().GetHash(key));
+}
+
+}  // namespace
+
 // NOLINTNEXTLINE
 TEST(HashTablePageTest, DirectoryPageSampleTest) {
   DiskManager *disk_manager = new DiskManager("test.db");
@@ -69,7 +81,7 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
 
   // insert a few (key, value) pairs
   for (unsigned i = 0; i < 10; i++) {
-    assert(bucket_page->Insert(i, i, IntComparator()));
+    assert(bucket_page->Insert(i, i, IntComparator(), IntFingerprint(i)));
   }
 
   // check for the inserted pairs
@@ -81,7 +93,7 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   // remove a few pairs
   for (unsigned i = 0; i < 10; i++) {
     if (i % 2 == 1) {
-      assert(bucket_page->Remove(i, i, IntComparator()));
+      assert(bucket_page->Remove(i, i, IntComparator(), IntFingerprint(i)));
     }
   }
 
@@ -102,7 +114,7 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   // try to remove the already-removed pairs
   for (unsigned i = 0; i < 10; i++) {
     if (i % 2 == 1) {
-      assert(!bucket_page->Remove(i, i, IntComparator()));
+      assert(!bucket_page->Remove(i, i, IntComparator(), IntFingerprint(i)));
     }
   }
 
@@ -114,4 +126,98 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageBitmapTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+      bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+  EXPECT_TRUE(bucket_page->IsEmpty());
+  EXPECT_EQ(0, bucket_page->NumReadable());
+
+  // fill the bucket; the slot count is not a multiple of 64, so the last bitmap word is partial
+  int slots = 0;
+  while (bucket_page->Insert(slots, slots, IntComparator(), IntFingerprint(slots))) {
+    slots++;
+  }
+  EXPECT_TRUE(bucket_page->IsFull());
+  EXPECT_FALSE(bucket_page->IsEmpty());
+  EXPECT_EQ(slots, bucket_page->NumReadable());
+
+  // free a slot in the middle of a word and one in the last word, inserts reuse the lowest free slot first
+  EXPECT_TRUE(bucket_page->Remove(70, 70, IntComparator(), IntFingerprint(70)));
+  EXPECT_TRUE(bucket_page->Remove(slots - 1, slots - 1, IntComparator(), IntFingerprint(slots - 1)));
+  EXPECT_FALSE(bucket_page->IsFull());
+  EXPECT_EQ(slots - 2, bucket_page->NumReadable());
+  EXPECT_TRUE(bucket_page->Insert(-1, -1, IntComparator(), IntFingerprint(-1)));
+  EXPECT_EQ(-1, bucket_page->KeyAt(70));
+  EXPECT_TRUE(bucket_page->Insert(-2, -2, IntComparator(), IntFingerprint(-2)));
+  EXPECT_EQ(-2, bucket_page->KeyAt(slots - 1));
+  EXPECT_TRUE(bucket_page->IsFull());
+
+  for (int i = 0; i < slots; i++) {
+    bucket_page->RemoveAt(i);
+  }
+  EXPECT_TRUE(bucket_page->IsEmpty());
+  EXPECT_TRUE(bucket_page->IsOccupied(slots - 1));
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+/*
+ * 把一个bucket填满，然后查找每个存在的key和同样多不存在的key。
+ * 每个key的fingerprint都要和表里记录的一致，否则查找会漏掉它
+ */
+template <size_t KeySize>
+void BucketProbeTest() {
+  using BucketPage = HashTableBucketPage<GenericKey<KeySize>, RID, GenericComparator<KeySize>>;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<KeySize> comparator(key_schema.get());
+  HashFunction<GenericKey<KeySize>> hash_fn;
+
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<BucketPage *>(bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+
+  GenericKey<KeySize> key;
+  int64_t slots = 0;
+  for (; !bucket_page->IsFull(); slots++) {
+    key.SetFromInteger(slots);
+    uint8_t fingerprint = BucketPage::HashToFingerprint(hash_fn.GetHash(key));
+    ASSERT_TRUE(bucket_page->Insert(key, RID(slots), comparator, fingerprint));
+    EXPECT_EQ(fingerprint, bucket_page->FingerprintAt(slots));
+  }
+
+  std::vector<RID> result;
+  for (int64_t i = 0; i < slots; i++) {
+    key.SetFromInteger(i);
+    result.clear();
+    EXPECT_TRUE(bucket_page->GetValue(key, comparator, &result, BucketPage::HashToFingerprint(hash_fn.GetHash(key))));
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(i, result[0].Get());
+    key.SetFromInteger(i + slots);
+    result.clear();
+    EXPECT_FALSE(bucket_page->GetValue(key, comparator, &result, BucketPage::HashToFingerprint(hash_fn.GetHash(key))));
+  }
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageProbeTest) {
+  BucketProbeTest<8>();
+  BucketProbeTest<64>();
+}
+
 }  // namespace bustub
@@ -10,6 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -18,6 +21,10 @@
 #include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "murmur3/MurmurHash3.h"
+#include "storage/index/extendible_hash_table_index.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -217,4 +224,586 @@ TEST(HashTableTest, ScaleTest) {
   delete bpm;
 }
 
+// 64 threads run a mixed lookup/insert workload; each thread owns a disjoint key range
+// NOLINTNEXTLINE
+TEST(HashTableTest, ConcurrentMixedTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_threads = 64;
+  const int keys_per_thread = 500;
+  std::atomic<int> failures{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&ht, &failures, tid] {
+      for (int i = 0; i < keys_per_thread; i++) {
+        int key = tid * keys_per_thread + i;
+        if (!ht.Insert(nullptr, key, key)) {
+          failures++;
+        }
+        // three lookups per insert, one of them for a key of another thread
+        for (int probe : {key, key / 2, (key * 7) % (tid * keys_per_thread + i + 1)}) {
+          std::vector<int> res;
+          ht.GetValue(nullptr, probe, &res);
+        }
+        std::vector<int> res;
+        if (!ht.GetValue(nullptr, key, &res) || res.size() != 1 || res[0] != key) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(0, failures.load());
+  ht.VerifyIntegrity();
+  for (int key = 0; key < num_threads * keys_per_thread; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << key;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// insert-only workload, dominated by bucket splits
+// NOLINTNEXTLINE
+TEST(HashTableTest, InsertHeavyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 100000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << "Failed to insert " << i;
+  }
+
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << i;
+    EXPECT_EQ(i, res[0]);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// buckets of 64-byte keys hold few pairs, so the directory quickly outgrows a single directory page
+// NOLINTNEXTLINE
+TEST(HashTableTest, MultiPageDirectoryTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema.get());
+  ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>> ht("blah", bpm, comparator,
+                                                                     HashFunction<GenericKey<64>>());
+
+  const int64_t num_keys = 60000;
+  GenericKey<64> index_key;
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(ht.Insert(nullptr, index_key, RID(key))) << "Failed to insert " << key;
+  }
+  uint32_t global_depth = ht.GetGlobalDepth();
+  printf("insert %ld pairs, global depth %u\n", static_cast<long>(num_keys), global_depth);  // NOLINT
+  EXPECT_GT(global_depth, 9);
+  ht.VerifyIntegrity();
+
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    std::vector<RID> res;
+    ht.GetValue(nullptr, index_key, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << key;
+    EXPECT_EQ(key, res[0].Get());
+  }
+
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(ht.Remove(nullptr, index_key, RID(key))) << "Failed to remove " << key;
+  }
+  EXPECT_LT(ht.GetGlobalDepth(), global_depth);
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// keys whose hashes agree in their low 18 bits drive the directory past 2^18 entries, and past the directory pages
+// one header page can list
+// NOLINTNEXTLINE
+TEST(HashTableTest, DeepDirectoryTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<64> comparator(key_schema.get());
+  HashFunction<GenericKey<64>> hash_fn;
+  ExtendibleHashTable<GenericKey<64>, RID, GenericComparator<64>> ht("blah", bpm, comparator, hash_fn);
+
+  // more keys than a bucket of 64-byte keys holds, all in the same bucket until the directory has 2^19 entries
+  const uint64_t low_mask = (1U << 18) - 1;
+  GenericKey<64> index_key;
+  index_key.SetFromInteger(0);
+  uint64_t low_bits = hash_fn.GetHash(index_key) & low_mask;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; keys.size() < 64; key++) {
+    index_key.SetFromInteger(key);
+    if ((hash_fn.GetHash(index_key) & low_mask) == low_bits) {
+      keys.push_back(key);
+    }
+  }
+  for (int64_t key : keys) {
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(ht.Insert(nullptr, index_key, RID(key))) << "Failed to insert " << key;
+  }
+  uint32_t global_depth = ht.GetGlobalDepth();
+  EXPECT_GT(global_depth, 18);
+  ht.VerifyIntegrity();
+
+  for (int64_t key : keys) {
+    index_key.SetFromInteger(key);
+    std::vector<RID> res;
+    ht.GetValue(nullptr, index_key, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << key;
+    EXPECT_EQ(key, res[0].Get());
+  }
+
+  for (int64_t key : keys) {
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(ht.Remove(nullptr, index_key, RID(key))) << "Failed to remove " << key;
+  }
+  EXPECT_LT(ht.GetGlobalDepth(), global_depth);
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a few keys with thousands of values each, as in an index on a low-cardinality column
+// NOLINTNEXTLINE
+TEST(HashTableTest, DuplicateKeyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 4;
+  const int values_per_key = 5000;
+  for (int v = 0; v < values_per_key; v++) {
+    for (int key = 0; key < num_keys; key++) {
+      ASSERT_TRUE(ht.Insert(nullptr, key, v)) << "Failed to insert " << key << " " << v;
+    }
+  }
+  EXPECT_FALSE(ht.Insert(nullptr, 0, 0));
+  // splitting never separates the values of a key, so the directory stays small
+  EXPECT_LE(ht.GetGlobalDepth(), 4);
+  ht.VerifyIntegrity();
+
+  // a few unique keys land in the chained buckets as well
+  for (int key = num_keys; key < 1000; key++) {
+    ASSERT_TRUE(ht.Insert(nullptr, key, key));
+  }
+  ht.VerifyIntegrity();
+
+  for (int key = 0; key < num_keys; key++) {
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, key, &res));
+    ASSERT_EQ(values_per_key, res.size());
+    std::sort(res.begin(), res.end());
+    for (int v = 0; v < values_per_key; v++) {
+      EXPECT_EQ(v, res[v]);
+    }
+  }
+  for (int key = num_keys; key < 1000; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    ASSERT_EQ(1, res.size());
+  }
+
+  // the streaming lookup stops as soon as the callback returns false
+  int streamed = 0;
+  EXPECT_TRUE(ht.GetValue(nullptr, 1, [&streamed](const int &value) { return ++streamed < 10; }));
+  EXPECT_EQ(10, streamed);
+
+  // drain the chains, overflow pages are released as they become empty
+  for (int v = 0; v < values_per_key; v++) {
+    for (int key = 0; key < num_keys; key++) {
+      ASSERT_TRUE(ht.Remove(nullptr, key, v)) << "Failed to remove " << key << " " << v;
+    }
+  }
+  for (int key = 0; key < num_keys; key++) {
+    std::vector<int> res;
+    EXPECT_FALSE(ht.GetValue(nullptr, key, &res));
+  }
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a bucket full of one key is split, not chained, when another key arrives
+// NOLINTNEXTLINE
+TEST(HashTableTest, SingleKeyBucketSplitTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  using KeyType = int;
+  using ValueType = int;
+  const int slots = BUCKET_ARRAY_SIZE;
+  for (int v = 0; v < slots; v++) {
+    ASSERT_TRUE(ht.Insert(nullptr, 0, v));
+  }
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+
+  // another value of the key goes to an overflow page, another key splits the bucket
+  ASSERT_TRUE(ht.Insert(nullptr, 0, slots));
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  for (int v = slots + 1; v < 2 * slots; v++) {
+    ASSERT_TRUE(ht.Insert(nullptr, 0, v));
+  }
+  ASSERT_TRUE(ht.Insert(nullptr, 1, 1));
+  EXPECT_LT(0, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  EXPECT_TRUE(ht.GetValue(nullptr, 0, &res));
+  EXPECT_EQ(2 * slots, res.size());
+  res.clear();
+  EXPECT_TRUE(ht.GetValue(nullptr, 1, &res));
+  EXPECT_EQ(std::vector<int>{1}, res);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a batched lookup returns the same values as probing the keys one at a time
+// NOLINTNEXTLINE
+TEST(HashTableTest, BatchLookupTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 50000;
+  for (int i = 0; i < num_keys; i++) {
+    ht.Insert(nullptr, i, i);
+    if (i % 7 == 0) {
+      ht.Insert(nullptr, i, -i);
+    }
+  }
+
+  // probe keys in join order: existing keys, repeated keys and missing keys
+  std::vector<int> keys;
+  for (int i = 0; i < 2 * num_keys; i += 3) {
+    keys.push_back(i);
+    if (i % 11 == 0) {
+      keys.push_back(i / 2);
+    }
+  }
+
+  std::vector<std::vector<int>> single(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    ht.GetValue(nullptr, keys[i], &single[i]);
+  }
+
+  const size_t batch_size = 256;
+  std::vector<std::vector<int>> batched;
+  std::vector<std::vector<int>> batch_results;
+  for (size_t begin = 0; begin < keys.size(); begin += batch_size) {
+    std::vector<int> batch(keys.begin() + begin, keys.begin() + std::min(keys.size(), begin + batch_size));
+    ht.GetValues(nullptr, batch, &batch_results);
+    ASSERT_EQ(batch.size(), batch_results.size());
+    batched.insert(batched.end(), batch_results.begin(), batch_results.end());
+  }
+
+  ASSERT_EQ(single.size(), batched.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::sort(single[i].begin(), single[i].end());
+    std::sort(batched[i].begin(), batched[i].end());
+    EXPECT_EQ(single[i], batched[i]) << "Mismatch for key " << keys[i];
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a bulk-loaded table holds every pair, also those of a key on an overflow chain, and keeps working afterwards
+// NOLINTNEXTLINE
+TEST(HashTableTest, BulkLoadTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+
+  const int num_keys = 200000;
+  std::vector<std::pair<int, int>> pairs;
+  for (int i = 0; i < num_keys; i++) {
+    pairs.emplace_back(i, i);
+    if (i % 13 == 0) {
+      pairs.emplace_back(i, -i - 1);
+    }
+  }
+  // a key with far more values than fit in one bucket ends up on an overflow chain
+  for (int i = 1; i <= 2000; i++) {
+    pairs.emplace_back(-1, i);
+  }
+
+  ExtendibleHashTable<int, int, IntComparator> ht("bulk", bpm, IntComparator(), HashFunction<int>());
+  ht.BulkLoad(nullptr, pairs);
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(i % 13 == 0 ? 2 : 1, res.size()) << "Wrong values for key " << i;
+  }
+  res.clear();
+  ht.GetValue(nullptr, -1, &res);
+  EXPECT_EQ(2000, res.size());
+
+  // the loaded table keeps working as a normal hash table
+  for (int i = 0; i < num_keys; i += 2) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_FALSE(ht.Insert(nullptr, i + 1, i + 1));
+    EXPECT_TRUE(ht.Insert(nullptr, num_keys + i, i));
+  }
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    ht.GetValue(nullptr, num_keys + i, &res);
+    EXPECT_EQ(i % 2 == 0 ? 1 : 0, res.size());
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// delete-heavy workload: merging every emptied bucket right away on the removing thread, and in batches on a
+// background maintenance thread
+// NOLINTNEXTLINE
+TEST(HashTableTest, DeleteHeavyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+
+  const int num_keys = 50000;
+  const int num_threads = 4;
+  auto run = [&](const char *mode, bool background) {
+    SCOPED_TRACE(mode);
+    ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+    for (int i = 0; i < num_keys; i++) {
+      ht.Insert(nullptr, i, i);
+    }
+    uint32_t global_depth = ht.GetGlobalDepth();
+    if (background) {
+      ht.StartBackgroundMerge(std::chrono::milliseconds(10));
+    }
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&, tid] {
+        for (int i = tid; i < num_keys; i += num_threads) {
+          if (!ht.Remove(nullptr, i, i)) {
+            failures++;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    if (background) {
+      ht.StopBackgroundMerge();
+    }
+    ht.MergeEmptyBuckets();
+
+    EXPECT_EQ(0, failures.load());
+    EXPECT_LT(ht.GetGlobalDepth(), global_depth);
+    ht.VerifyIntegrity();
+    // the table stays usable after the merges
+    for (int i = 0; i < 1000; i++) {
+      EXPECT_TRUE(ht.Insert(nullptr, i, i));
+      std::vector<int> res;
+      ht.GetValue(nullptr, i, &res);
+      EXPECT_EQ(1, res.size());
+    }
+  };
+  run("merge on every remove", false);
+  run("background merge", true);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// without a background merge thread, a bucket is merged by the Remove that empties it
+// NOLINTNEXTLINE
+TEST(HashTableTest, MergeOnRemoveTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // a handful of buckets, far fewer than a merge batch
+  const int num_keys = 2000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i));
+  }
+  uint32_t global_depth = ht.GetGlobalDepth();
+  ASSERT_LT(0, global_depth);
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  EXPECT_LT(ht.GetGlobalDepth(), global_depth);
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+namespace {
+
+// a hash index whose directory depth the test can read
+class MergeTestIndex : public ExtendibleHashTableIndex<GenericKey<8>, RID, GenericComparator<8>> {
+ public:
+  using ExtendibleHashTableIndex::ExtendibleHashTableIndex;
+  uint32_t GetGlobalDepth() { return container_.GetGlobalDepth(); }
+};
+
+}  // namespace
+
+// a hash index merges the buckets DeleteEntry empties on its background thread, never on the deleting thread
+// NOLINTNEXTLINE
+TEST(HashTableTest, IndexBackgroundMergeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  auto schema = ParseCreateStatement("a bigint");
+
+  auto fill = [&](MergeTestIndex *index, int num_keys) {
+    for (int i = 0; i < num_keys; i++) {
+      Tuple key({ValueFactory::GetBigIntValue(i)}, index->GetKeySchema());
+      index->InsertEntry(key, RID(i), nullptr);
+    }
+  };
+  auto drain = [&](MergeTestIndex *index, int num_keys) {
+    for (int i = 0; i < num_keys; i++) {
+      Tuple key({ValueFactory::GetBigIntValue(i)}, index->GetKeySchema());
+      index->DeleteEntry(key, RID(i), nullptr);
+    }
+  };
+
+  // fewer empty buckets than a merge batch and a long interval: the thread does not wake up, and the deletes
+  // leave the directory as it was
+  {
+    MergeTestIndex index(std::make_unique<IndexMetadata>("small", "t", schema.get(), std::vector<uint32_t>{0}), bpm,
+                         HashFunction<GenericKey<8>>(), std::chrono::hours(1));
+    fill(&index, 2000);
+    uint32_t global_depth = index.GetGlobalDepth();
+    ASSERT_LT(0, global_depth);
+    drain(&index, 2000);
+    EXPECT_EQ(global_depth, index.GetGlobalDepth());
+  }
+
+  // with the default interval the thread merges the empty buckets and shrinks the directory
+  {
+    MergeTestIndex index(std::make_unique<IndexMetadata>("large", "t", schema.get(), std::vector<uint32_t>{0}), bpm,
+                         HashFunction<GenericKey<8>>());
+    fill(&index, 50000);
+    uint32_t global_depth = index.GetGlobalDepth();
+    drain(&index, 50000);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (index.GetGlobalDepth() >= global_depth && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_LT(index.GetGlobalDepth(), global_depth);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a unique table rejects a second value for a key, and its lookups stop at the first match
+// NOLINTNEXTLINE
+TEST(HashTableTest, UniqueKeyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(1024, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> unique("unique", bpm, IntComparator(), HashFunction<int>(), true);
+
+  const int num_keys = 100000;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(unique.Insert(nullptr, i, i));
+    EXPECT_FALSE(unique.Insert(nullptr, i, i + 1)) << "Accepted a second value for " << i;
+  }
+  unique.VerifyIntegrity();
+
+  std::vector<int> res;
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    ASSERT_TRUE(unique.GetValue(nullptr, i, &res));
+    ASSERT_EQ(1, res.size());
+    EXPECT_EQ(i, res[0]);
+  }
+  std::vector<int> keys;
+  for (int i = 0; i < 2 * num_keys; i += 3) {
+    keys.push_back(i);
+  }
+  std::vector<std::vector<int>> results;
+  unique.GetValues(nullptr, keys, &results);
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(keys[i] < num_keys ? 1 : 0, results[i].size());
+  }
+
+  // once its value is removed the key can be inserted again
+  EXPECT_TRUE(unique.Remove(nullptr, 7, 7));
+  EXPECT_TRUE(unique.Insert(nullptr, 7, 70));
+  res.clear();
+  unique.GetValue(nullptr, 7, &res);
+  EXPECT_EQ(std::vector<int>{70}, res);
+
+  // bulk loading a unique table keeps only the first pair of every key
+  ExtendibleHashTable<int, int, IntComparator> loaded("loaded", bpm, IntComparator(), HashFunction<int>(), true);
+  std::vector<std::pair<int, int>> pairs;
+  for (int i = 0; i < num_keys; i++) {
+    pairs.emplace_back(i, i);
+    if (i % 10 == 0) {
+      pairs.emplace_back(i, -i);
+    }
+  }
+  loaded.BulkLoad(nullptr, pairs);
+  loaded.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    loaded.GetValue(nullptr, i, &res);
+    ASSERT_EQ(std::vector<int>{i}, res) << "Wrong values for key " << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
@@ -0,0 +1,247 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// linear_probe_hash_table_test.cpp
+//
+// Identification: test/container/linear_probe_hash_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "container/hash/extendible_hash_table.h"
+#include "container/hash/linear_probe_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, SampleTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+
+  // insert a few values, each key with two values
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+    EXPECT_TRUE(ht.Insert(nullptr, i, 2 * i + 1));
+    // duplicate values for the same key are not allowed
+    EXPECT_FALSE(ht.Insert(nullptr, i, i));
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    EXPECT_EQ(2, res.size()) << "Failed to insert " << i << std::endl;
+  }
+
+  // look for a key that does not exist
+  std::vector<int> res;
+  EXPECT_FALSE(ht.GetValue(nullptr, 20, &res));
+  EXPECT_EQ(0, res.size());
+
+  // delete some values; the tombstones must not hide the other value of the key
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_FALSE(ht.Remove(nullptr, i, i));
+    res.clear();
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << i << std::endl;
+    EXPECT_EQ(2 * i + 1, res[0]);
+    // a tombstone can be reused
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a table whose pages do not fit in the buffer pool is not created, and gives back the pages it took
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, OutOfMemoryTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager);
+  page_id_t pinned[2];
+  for (auto &page_id : pinned) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  // the header page takes the last frame, and the first block page finds none
+  EXPECT_THROW((LinearProbeHashTable<int, int, IntComparator>("blah", bpm, IntComparator(), 1000,
+                                                               HashFunction<int>())),
+               Exception);
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // with a frame free for the block pages the table is created
+  EXPECT_TRUE(bpm->UnpinPage(pinned[1], false));
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+  EXPECT_TRUE(ht.Insert(nullptr, 1, 1));
+
+  EXPECT_TRUE(bpm->UnpinPage(pinned[0], false));
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// the table starts with a single block and keeps growing; entries stay visible while blocks migrate
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, ResizeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(64, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 10, HashFunction<int>());
+  size_t initial_size = ht.GetSize();
+
+  const int num_keys = 50000;
+  bool saw_resizing = false;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i)) << "Failed to insert " << i;
+    if (ht.IsResizing()) {
+      saw_resizing = true;
+      // keys inserted before the resize started are still in the old array
+      std::vector<int> res;
+      ht.GetValue(nullptr, i / 2, &res);
+      ASSERT_EQ(1, res.size()) << "Lost " << i / 2 << " while resizing";
+    }
+  }
+  EXPECT_TRUE(saw_resizing);
+  EXPECT_GE(ht.GetSize(), 2 * static_cast<size_t>(num_keys));
+  EXPECT_GT(ht.GetSize(), initial_size);
+
+  for (int i = 0; i < num_keys; i += 2) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(i % 2, res.size()) << "Wrong values for key " << i;
+  }
+
+  // an explicit resize finishes any pending migration before starting the next one
+  size_t size = ht.GetSize();
+  ht.Resize(size);
+  EXPECT_EQ(2 * size, ht.GetSize());
+  EXPECT_TRUE(ht.IsResizing());
+  for (int i = 1; i < num_keys; i += 2) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(1, res.size()) << "Lost " << i << " after resize";
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// writers grow the table while readers look up keys that may be migrating
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, ConcurrentResizeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 10, HashFunction<int>());
+
+  const int num_writers = 8;
+  const int keys_per_writer = 5000;
+  std::atomic<int> failures{0};
+  std::atomic<int> writers_done{0};
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_writers; tid++) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < keys_per_writer; i++) {
+        int key = i * num_writers + tid;
+        if (!ht.Insert(nullptr, key, key)) {
+          failures++;
+        }
+        // every thread also inserts one key shared by all threads; exactly one insert may win
+        if (i % 100 == 0) {
+          ht.Insert(nullptr, -1, i);
+        }
+        std::vector<int> res;
+        if (!ht.GetValue(nullptr, key, &res) || res.size() != 1) {
+          failures++;
+        }
+      }
+      writers_done++;
+    });
+  }
+  for (int tid = 0; tid < 4; tid++) {
+    threads.emplace_back([&] {
+      // a pair that migrates between the lookups of the old and the new array is still reported once
+      while (writers_done.load() < num_writers) {
+        for (int key = 0; key < 64 * num_writers; key++) {
+          std::vector<int> res;
+          ht.GetValue(nullptr, key, &res);
+          if (res.size() > 1) {
+            failures++;
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(0, failures.load());
+  for (int key = 0; key < num_writers * keys_per_writer; key++) {
+    std::vector<int> res;
+    ht.GetValue(nullptr, key, &res);
+    ASSERT_EQ(1, res.size()) << "Failed to keep " << key;
+  }
+  std::vector<int> res;
+  ht.GetValue(nullptr, -1, &res);
+  EXPECT_EQ(keys_per_writer / 100, res.size());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// compares point lookup latency against extendible hashing on the same keys.
+// Disabled in the unit test run; run it with --gtest_also_run_disabled_tests
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, DISABLED_ProbeLatencyTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> linear("linear", bpm, IntComparator(), 1000, HashFunction<int>());
+  ExtendibleHashTable<int, int, IntComparator> extendible("extendible", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 50000;
+  for (int i = 0; i < num_keys; i++) {
+    linear.Insert(nullptr, i, i);
+    extendible.Insert(nullptr, i, i);
+  }
+  auto probe = [&](auto *ht) {
+    int found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2 * num_keys; i++) {
+      std::vector<int> res;
+      found += static_cast<int>(ht->GetValue(nullptr, i, &res));
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_keys, found);
+    return elapsed * 1e9 / (2 * num_keys);
+  };
+  double linear_ns = probe(&linear);
+  double extendible_ns = probe(&extendible);
+  printf("%d lookups: linear probing %.0f ns/op, extendible hashing %.0f ns/op\n", 2 * num_keys, linear_ns,
+         extendible_ns);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+}  // namespace bustub
@@ -22,6 +22,7 @@
 #include "execution/execution_engine.h"
 #include "execution/executor_context.h"
 #include "execution/executors/aggregation_executor.h"
+#include "execution/executors/index_scan_executor.h"
 #include "execution/executors/insert_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
 #include "execution/expressions/aggregate_value_expression.h"
@@ -31,7 +32,9 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
 #include "executor_test_util.h"  // NOLINT
@@ -55,6 +58,7 @@
  * - Aggregation
  * - Limit
  * - Distinct
+ * - Index Scan
  *
  * Each of the tests demonstrates how to construct a query plan for
  * a particular executors. Students should be able to learn from and
@@ -494,6 +498,60 @@ TEST_F(ExecutorTest, SimpleHashJoinTest) {
   }
 }
 
+// SELECT test_4.colA, test_4.colB, test_6.colA, test_6.colB FROM test_4 JOIN test_6 ON test_4.colA = test_6.colA;
+// using an index on test_6.colA
+TEST_F(ExecutorTest, SimpleNestedIndexJoinTest) {
+  // Construct sequential scan of table test_4
+  const Schema *out_schema1{};
+  std::unique_ptr<AbstractPlanNode> scan_plan1{};
+  {
+    auto *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_4");
+    auto &schema = table_info->schema_;
+    auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+    auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+    out_schema1 = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+    scan_plan1 = std::make_unique<SeqScanPlanNode>(out_schema1, nullptr, table_info->oid_);
+  }
+
+  // Index test_6 on colA
+  auto *inner_info = GetExecutorContext()->GetCatalog()->GetTable("test_6");
+  auto key_schema = ParseCreateStatement("a bigint");
+  GetExecutorContext()->GetCatalog()->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "index_test6", "test_6", inner_info->schema_, *key_schema, {0}, 8, HashFunctionType{});
+
+  // Construct the join plan
+  const Schema *out_schema{};
+  std::unique_ptr<NestedIndexJoinPlanNode> join_plan{};
+  {
+    auto &inner_schema = inner_info->schema_;
+    auto *table4_col_a = MakeColumnValueExpression(*out_schema1, 0, "colA");
+    auto *table4_col_b = MakeColumnValueExpression(*out_schema1, 0, "colB");
+    auto *table6_col_a = MakeColumnValueExpression(inner_schema, 1, "colA");
+    auto *table6_col_b = MakeColumnValueExpression(inner_schema, 1, "colB");
+    out_schema = MakeOutputSchema({{"table4_colA", table4_col_a},
+                                   {"table4_colB", table4_col_b},
+                                   {"table6_colA", table6_col_a},
+                                   {"table6_colB", table6_col_b}});
+    auto *predicate = MakeComparisonExpression(table4_col_a, table6_col_a, ComparisonType::Equal);
+    join_plan = std::make_unique<NestedIndexJoinPlanNode>(
+        out_schema, std::vector<const AbstractPlanNode *>{scan_plan1.get()}, predicate, inner_info->oid_,
+        "index_test6", out_schema1, &inner_schema);
+  }
+
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(join_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 100);
+
+  for (const auto &tuple : result_set) {
+    const auto t4_col_a = tuple.GetValue(out_schema, out_schema->GetColIdx("table4_colA")).GetAs<int64_t>();
+    const auto t4_col_b = tuple.GetValue(out_schema, out_schema->GetColIdx("table4_colB")).GetAs<int32_t>();
+    const auto t6_col_a = tuple.GetValue(out_schema, out_schema->GetColIdx("table6_colA")).GetAs<int64_t>();
+    const auto t6_col_b = tuple.GetValue(out_schema, out_schema->GetColIdx("table6_colB")).GetAs<int32_t>();
+    ASSERT_EQ(t4_col_a, t6_col_a);
+    ASSERT_EQ(t4_col_b, t6_col_b);
+  }
+}
+
 // 9
 // SELECT COUNT(col_a), SUM(col_a), min(col_a), max(col_a) from test_1;
 TEST_F(ExecutorTest, SimpleAggregationTest) {
@@ -665,4 +723,212 @@ TEST_F(ExecutorTest, SimpleDistinctTest) {
   ASSERT_TRUE(std::equal(results.cbegin(), results.cend(), expected.cbegin()));
 }
 
+
+// SELECT colB, colA FROM t ORDER BY colB, colA, through a B+ tree index on colB that includes colA
+TEST(IndexScanExecutorTest, IndexOnlyScanTest) {
+  auto disk_manager = std::make_unique<DiskManager>("executor_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(50, disk_manager.get());
+  // the B+ tree keeps its root in page 0, so it is allocated before any table page
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  auto lock_manager = std::make_unique<LockManager>();
+  auto txn_mgr = std::make_unique<TransactionManager>(lock_manager.get(), nullptr);
+  auto catalog = std::make_unique<Catalog>(bpm.get(), lock_manager.get(), nullptr);
+  Transaction *txn = txn_mgr->Begin();
+  ExecutorContext exec_ctx(txn, catalog.get(), bpm.get(), txn_mgr.get(), lock_manager.get());
+  ExecutionEngine engine(bpm.get(), txn_mgr.get(), catalog.get());
+
+  Schema schema({Column("colA", TypeId::INTEGER), Column("colB", TypeId::INTEGER), Column("colC", TypeId::INTEGER)});
+  auto *table_info = catalog->CreateTable(txn, "t", schema);
+  const int num_rows = 1000;
+  auto insert_rows = [&](int begin, int end) {
+    std::vector<std::vector<Value>> raw_values;
+    for (int i = begin; i < end; i++) {
+      raw_values.push_back({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10),
+                            ValueFactory::GetIntegerValue(i * 7)});
+    }
+    InsertPlanNode insert_plan{std::move(raw_values), table_info->oid_};
+    engine.Execute(&insert_plan, nullptr, txn, &exec_ctx);
+  };
+
+  // half of the rows are bulk loaded when the index is created, the other half inserted through it
+  insert_rows(0, num_rows / 2);
+  Schema key_schema({Column("colB", TypeId::INTEGER)});
+  auto *index_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      txn, "index1", "t", table_info->schema_, key_schema, {1}, 8, HashFunction<GenericKey<8>>{},
+      IndexType::BPlusTreeIndex, false, {0});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  insert_rows(num_rows / 2, num_rows);
+
+  ColumnValueExpression col_a(0, 0, TypeId::INTEGER);
+  ColumnValueExpression col_b(0, 1, TypeId::INTEGER);
+  ColumnValueExpression col_c(0, 2, TypeId::INTEGER);
+  Schema covered_schema({Column("colB", TypeId::INTEGER, &col_b), Column("colA", TypeId::INTEGER, &col_a)});
+  IndexScanPlanNode covered_plan{&covered_schema, nullptr, index_info->index_oid_};
+  IndexScanExecutor covered_executor(&exec_ctx, &covered_plan);
+  covered_executor.Init();
+  EXPECT_TRUE(covered_executor.IsIndexOnly());
+
+  std::vector<Tuple> result_set;
+  engine.Execute(&covered_plan, &result_set, txn, &exec_ctx);
+  ASSERT_EQ(num_rows, result_set.size());
+  for (int i = 0; i < num_rows; i++) {
+    int col_b_value = i / (num_rows / 10);
+    ASSERT_EQ(col_b_value, result_set[i].GetValue(&covered_schema, 0).GetAs<int32_t>());
+    ASSERT_EQ(i % (num_rows / 10) * 10 + col_b_value, result_set[i].GetValue(&covered_schema, 1).GetAs<int32_t>());
+  }
+
+  // the predicate is evaluated on the output, so it may use the covered columns
+  ConstantValueExpression limit(ValueFactory::GetIntegerValue(500));
+  ComparisonExpression predicate(&col_a, &limit, ComparisonType::LessThan);
+  ColumnValueExpression out_col_a(0, 1, TypeId::INTEGER);
+  ComparisonExpression out_predicate(&out_col_a, &limit, ComparisonType::LessThan);
+  IndexScanPlanNode filtered_plan{&covered_schema, &out_predicate, index_info->index_oid_};
+  result_set.clear();
+  engine.Execute(&filtered_plan, &result_set, txn, &exec_ctx);
+  EXPECT_EQ(num_rows / 2, result_set.size());
+
+  // colC is not in the index, so the rows are read from the table, still in the order of the index
+  Schema uncovered_schema({Column("colA", TypeId::INTEGER, &col_a), Column("colC", TypeId::INTEGER, &col_c)});
+  IndexScanPlanNode uncovered_plan{&uncovered_schema, nullptr, index_info->index_oid_};
+  IndexScanExecutor uncovered_executor(&exec_ctx, &uncovered_plan);
+  uncovered_executor.Init();
+  EXPECT_FALSE(uncovered_executor.IsIndexOnly());
+  result_set.clear();
+  engine.Execute(&uncovered_plan, &result_set, txn, &exec_ctx);
+  ASSERT_EQ(num_rows, result_set.size());
+  for (int i = 0; i < num_rows; i++) {
+    int col_a_value = result_set[i].GetValue(&uncovered_schema, 0).GetAs<int32_t>();
+    ASSERT_EQ(i / (num_rows / 10), col_a_value % 10);
+    ASSERT_EQ(col_a_value * 7, result_set[i].GetValue(&uncovered_schema, 1).GetAs<int32_t>());
+  }
+
+  // point lookups go by the key column alone
+  std::vector<RID> rids;
+  Tuple key({ValueFactory::GetIntegerValue(3)}, &key_schema);
+  index_info->index_->ScanKey(key, &rids, txn);
+  EXPECT_EQ(num_rows / 10, rids.size());
+
+  // deleted rows leave the index as well
+  Schema table_out_schema({Column("colA", TypeId::INTEGER, &col_a), Column("colB", TypeId::INTEGER, &col_b),
+                           Column("colC", TypeId::INTEGER, &col_c)});
+  SeqScanPlanNode scan_plan{&table_out_schema, &predicate, table_info->oid_};
+  DeletePlanNode delete_plan{&scan_plan, table_info->oid_};
+  engine.Execute(&delete_plan, nullptr, txn, &exec_ctx);
+  result_set.clear();
+  engine.Execute(&covered_plan, &result_set, txn, &exec_ctx);
+  ASSERT_EQ(num_rows / 2, result_set.size());
+  for (const auto &tuple : result_set) {
+    EXPECT_GE(tuple.GetValue(&covered_schema, 1).GetAs<int32_t>(), num_rows / 2);
+  }
+
+  // a unique index checks its key columns only; the second row with colA 600 is not indexed
+  auto *unique_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      txn, "index2", "t", table_info->schema_, key_schema, {0}, 8, HashFunction<GenericKey<8>>{},
+      IndexType::BPlusTreeIndex, true, {2});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, unique_info);
+  std::vector<std::vector<Value>> duplicate{
+      {ValueFactory::GetIntegerValue(600), ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(1)}};
+  InsertPlanNode duplicate_plan{std::move(duplicate), table_info->oid_};
+  engine.Execute(&duplicate_plan, nullptr, txn, &exec_ctx);
+  rids.clear();
+  unique_info->index_->ScanKey(Tuple({ValueFactory::GetIntegerValue(600)}, &key_schema), &rids, txn);
+  EXPECT_EQ(1, rids.size());
+  Schema unique_schema({Column("colA", TypeId::INTEGER, &col_a), Column("colC", TypeId::INTEGER, &col_c)});
+  IndexScanPlanNode unique_plan{&unique_schema, nullptr, unique_info->index_oid_};
+  result_set.clear();
+  engine.Execute(&unique_plan, &result_set, txn, &exec_ctx);
+  ASSERT_EQ(num_rows / 2, result_set.size());
+  for (int i = 0; i < num_rows / 2; i++) {
+    EXPECT_EQ(num_rows / 2 + i, result_set[i].GetValue(&unique_schema, 0).GetAs<int32_t>());
+    EXPECT_EQ((num_rows / 2 + i) * 7, result_set[i].GetValue(&unique_schema, 1).GetAs<int32_t>());
+  }
+
+  txn_mgr->Commit(txn);
+  delete txn;
+  bpm->UnpinPage(header_page_id, true);
+  disk_manager->ShutDown();
+  remove("executor_test.db");
+  remove("executor_test.log");
+}
+
+// SELECT colA FROM t WHERE <comparison on colA>, through a B+ tree index on colA; then DELETE through the same scan
+TEST(IndexScanExecutorTest, RangeScanTest) {
+  auto disk_manager = std::make_unique<DiskManager>("executor_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(50, disk_manager.get());
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  auto lock_manager = std::make_unique<LockManager>();
+  auto txn_mgr = std::make_unique<TransactionManager>(lock_manager.get(), nullptr);
+  auto catalog = std::make_unique<Catalog>(bpm.get(), lock_manager.get(), nullptr);
+  Transaction *txn = txn_mgr->Begin();
+  ExecutorContext exec_ctx(txn, catalog.get(), bpm.get(), txn_mgr.get(), lock_manager.get());
+  ExecutionEngine engine(bpm.get(), txn_mgr.get(), catalog.get());
+
+  Schema schema({Column("colA", TypeId::INTEGER), Column("colB", TypeId::INTEGER)});
+  auto *table_info = catalog->CreateTable(txn, "t", schema);
+  Schema key_schema({Column("colA", TypeId::INTEGER)});
+  auto *index_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      txn, "index1", "t", table_info->schema_, key_schema, {0}, 8, HashFunction<GenericKey<8>>{},
+      IndexType::BPlusTreeIndex);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  const int num_rows = 1000;
+  std::vector<std::vector<Value>> raw_values;
+  for (int i = num_rows - 1; i >= 0; i--) {
+    raw_values.push_back({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10)});
+  }
+  InsertPlanNode insert_plan{std::move(raw_values), table_info->oid_};
+  engine.Execute(&insert_plan, nullptr, txn, &exec_ctx);
+
+  ColumnValueExpression col_a(0, 0, TypeId::INTEGER);
+  ColumnValueExpression col_b(0, 1, TypeId::INTEGER);
+  Schema out_schema({Column("colA", TypeId::INTEGER, &col_a), Column("colB", TypeId::INTEGER, &col_b)});
+  // the colA values that the scan returns, in order
+  auto scan = [&](const AbstractExpression *predicate) {
+    IndexScanPlanNode plan{&out_schema, predicate, index_info->index_oid_};
+    std::vector<Tuple> result_set;
+    engine.Execute(&plan, &result_set, txn, &exec_ctx);
+    std::vector<int32_t> values;
+    for (const auto &tuple : result_set) {
+      values.push_back(tuple.GetValue(&out_schema, 0).GetAs<int32_t>());
+    }
+    return values;
+  };
+  auto range = [](int32_t begin, int32_t end) {
+    std::vector<int32_t> values(end - begin);
+    std::iota(values.begin(), values.end(), begin);
+    return values;
+  };
+
+  ConstantValueExpression value_300(ValueFactory::GetIntegerValue(300));
+  ConstantValueExpression value_900(ValueFactory::GetIntegerValue(900));
+  ComparisonExpression equal(&col_a, &value_300, ComparisonType::Equal);
+  EXPECT_EQ(range(300, 301), scan(&equal));
+  ComparisonExpression greater(&col_a, &value_900, ComparisonType::GreaterThan);
+  EXPECT_EQ(range(901, num_rows), scan(&greater));
+  ComparisonExpression less_equal(&col_a, &value_300, ComparisonType::LessThanOrEqual);
+  EXPECT_EQ(range(0, 301), scan(&less_equal));
+  // the constant on the left: 900 > colA
+  ComparisonExpression flipped(&value_900, &col_a, ComparisonType::GreaterThan);
+  EXPECT_EQ(range(0, 900), scan(&flipped));
+  // a predicate on another column scans the whole index
+  ComparisonExpression other(&col_b, &value_300, ComparisonType::LessThan);
+  EXPECT_EQ(range(0, num_rows), scan(&other));
+
+  // the delete writes to the index while the scan below it reads from the index
+  ConstantValueExpression value_500(ValueFactory::GetIntegerValue(500));
+  ComparisonExpression less(&col_a, &value_500, ComparisonType::LessThan);
+  IndexScanPlanNode scan_plan{&out_schema, &less, index_info->index_oid_};
+  DeletePlanNode delete_plan{&scan_plan, table_info->oid_};
+  engine.Execute(&delete_plan, nullptr, txn, &exec_ctx);
+  EXPECT_EQ(range(500, num_rows), scan(nullptr));
+
+  txn_mgr->Commit(txn);
+  delete txn;
+  bpm->UnpinPage(header_page_id, true);
+  disk_manager->ShutDown();
+  remove("executor_test.db");
+  remove("executor_test.log");
+}
+
 }  // namespace bustub
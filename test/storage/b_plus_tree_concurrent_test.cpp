@@ -10,9 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
+#include <random>
 #include <thread>  // NOLINT
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -100,7 +103,7 @@ void DeleteHelperSplit(BPlusTree<GenericKey<8>, RID, GenericComparator<8>> *tree
   delete transaction;
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
+TEST(BPlusTreeConcurrentTest, InsertTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -152,7 +155,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
+TEST(BPlusTreeConcurrentTest, InsertTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -203,7 +206,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_InsertTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
+TEST(BPlusTreeConcurrentTest, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -245,7 +248,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
+TEST(BPlusTreeConcurrentTest, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -288,7 +291,7 @@ TEST(BPlusTreeConcurrentTest, DISABLED_DeleteTest2) {
   remove("test.log");
 }
 
-TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
+TEST(BPlusTreeConcurrentTest, MixTest) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -333,4 +336,434 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+// small nodes make almost every insert and remove split, merge or redistribute while readers descend
+TEST(BPlusTreeConcurrentTest, StressTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 20000;
+  const int num_threads = 8;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t i = 0; i < num_keys; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+
+  // writers remove the odd keys while readers keep finding the even ones
+  std::vector<int64_t> odd_keys;
+  for (int64_t key : keys) {
+    if (key % 2 == 1) {
+      odd_keys.push_back(key);
+    }
+  }
+  std::atomic<int> missing{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < 4; tid++) {
+    readers.emplace_back([&, tid] {
+      GenericKey<8> index_key;
+      std::vector<RID> rids;
+      for (int64_t key = 2 * tid; !done.load(); key = (key + 8) % num_keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids)) {
+          missing++;
+        }
+      }
+    });
+  }
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, odd_keys, num_threads);
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, missing.load());
+
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    ASSERT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += 2;
+  }
+  EXPECT_EQ(current_key, num_keys);
+
+  // removing everything leaves an empty tree that can grow again
+  std::vector<int64_t> even_keys;
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    even_keys.push_back(key);
+  }
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, even_keys, num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_TRUE(tree.Begin() == tree.End());
+  InsertHelper(&tree, {42});
+  std::vector<RID> rids;
+  GenericKey<8> index_key;
+  index_key.SetFromInteger(42);
+  EXPECT_TRUE(tree.GetValue(index_key, &rids));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// readers look up keys while writers keep splitting the leaves that hold them; afterwards every
+// leaf holds exactly the keys between its fences
+TEST(BPlusTreeConcurrentTest, ReadDuringSplitTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 20000;
+  const int num_threads = 4;
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    even_keys.push_back(key);
+    odd_keys.push_back(key + 1);
+  }
+  std::shuffle(odd_keys.begin(), odd_keys.end(), std::mt19937(15445));
+  InsertHelper(&tree, even_keys);
+
+  std::atomic<int> missing{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int tid = 0; tid < num_threads; tid++) {
+    readers.emplace_back([&, tid] {
+      GenericKey<8> index_key;
+      std::vector<RID> rids;
+      for (int64_t key = 2 * tid; !done.load(); key = (key + 2 * num_threads) % num_keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids) || rids[0].GetSlotNum() != key) {
+          missing++;
+        }
+      }
+    });
+  }
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, odd_keys, num_threads);
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(0, missing.load());
+
+  // walk the leaves through their right links
+  using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+  Page *page = tree.FindLeafPage(GenericKey<8>(), true);
+  int64_t next_key = 0;
+  while (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      ASSERT_EQ(next_key++, leaf->GetItem(i).second.GetSlotNum());
+      ASSERT_FALSE(leaf->ShouldMoveRight(leaf->KeyAt(i), comparator));
+      ASSERT_FALSE(leaf->IsBelowLowKey(leaf->KeyAt(i), comparator));
+    }
+    page_id_t next_page_id = leaf->GetNextPageId();
+    Page *next_page = next_page_id == INVALID_PAGE_ID ? nullptr : bpm->FetchPage(next_page_id);
+    if (next_page != nullptr) {
+      ASSERT_TRUE(leaf->ShouldMoveRight(reinterpret_cast<LeafPage *>(next_page->GetData())->KeyAt(0), comparator));
+      next_page->RLatch();
+    }
+    page->RUnlatch();
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+  }
+  EXPECT_EQ(num_keys, next_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// reverse scans follow the left links while other threads split and merge the leaves
+TEST(BPlusTreeConcurrentTest, ReverseScanDuringSplitTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 4000;
+  const int num_threads = 2;
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    even_keys.push_back(key);
+    odd_keys.push_back(key + 1);
+  }
+  std::shuffle(odd_keys.begin(), odd_keys.end(), std::mt19937(15445));
+  InsertHelper(&tree, even_keys);
+
+  // the even keys stay in the tree, so every scan returns all of them, and the keys come in descending order
+  std::atomic<int> errors{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> scanners;
+  for (int tid = 0; tid < num_threads; tid++) {
+    scanners.emplace_back([&, tid] {
+      GenericKey<8> begin_key;
+      GenericKey<8> end_key;
+      for (int round = 0; !done.load(); round++) {
+        int64_t begin = tid == 0 ? 0 : (round * 200) % num_keys;
+        int64_t end = tid == 0 ? num_keys : begin + 400;
+        begin_key.SetFromInteger(begin);
+        end_key.SetFromInteger(end);
+        int64_t expected = std::min(end, num_keys) - 2 + std::min(end, num_keys) % 2;
+        int64_t last = end;
+        for (auto iterator = tree.RBegin(begin_key, end_key); !iterator.IsEnd(); ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          if (key >= last || key < begin || (key % 2 == 0 && key != expected)) {
+            errors++;
+          }
+          if (key % 2 == 0) {
+            expected = key - 2;
+          }
+          last = key;
+        }
+        if (expected >= begin) {
+          errors++;
+        }
+      }
+    });
+  }
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, odd_keys, num_threads);
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, odd_keys, num_threads);
+  done = true;
+  for (auto &scanner : scanners) {
+    scanner.join();
+  }
+  EXPECT_EQ(0, errors.load());
+
+  std::vector<int64_t> keys;
+  for (auto iterator = tree.RBegin(); !iterator.IsEnd(); ++iterator) {
+    keys.push_back((*iterator).second.GetSlotNum());
+  }
+  std::reverse(keys.begin(), keys.end());
+  EXPECT_EQ(even_keys, keys);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// forward scans follow the right links while other threads merge the leaves they are about to enter
+TEST(BPlusTreeConcurrentTest, ForwardScanDuringMergeTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 4000;
+  const int num_threads = 2;
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    even_keys.push_back(key);
+    odd_keys.push_back(key + 1);
+  }
+  std::shuffle(odd_keys.begin(), odd_keys.end(), std::mt19937(15445));
+  InsertHelper(&tree, even_keys);
+
+  // the even keys stay in the tree, so every scan returns all of them in ascending order
+  std::atomic<int> errors{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> scanners;
+  for (int tid = 0; tid < num_threads; tid++) {
+    scanners.emplace_back([&, tid] {
+      GenericKey<8> begin_key;
+      GenericKey<8> end_key;
+      for (int round = 0; !done.load(); round++) {
+        int64_t begin = tid == 0 ? 0 : (round * 200) % num_keys;
+        int64_t end = tid == 0 ? num_keys : begin + 400;
+        begin_key.SetFromInteger(begin);
+        end_key.SetFromInteger(end);
+        auto iterator = tid == 0 ? tree.Begin() : tree.Begin(begin_key, end_key);
+        int64_t expected = begin;
+        int64_t last = begin - 1;
+        for (; !iterator.IsEnd(); ++iterator) {
+          int64_t key = (*iterator).second.GetSlotNum();
+          if (key <= last || key >= end || (key % 2 == 0 && key != expected)) {
+            errors++;
+          }
+          if (key % 2 == 0) {
+            expected = key + 2;
+          }
+          last = key;
+        }
+        if (expected < std::min(end, num_keys)) {
+          errors++;
+        }
+      }
+    });
+  }
+  for (int round = 0; round < 3; round++) {
+    LaunchParallelTest(num_threads, InsertHelperSplit, &tree, odd_keys, num_threads);
+    LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, odd_keys, num_threads);
+  }
+  done = true;
+  for (auto &scanner : scanners) {
+    scanner.join();
+  }
+  EXPECT_EQ(0, errors.load());
+
+  std::vector<int64_t> keys;
+  for (auto iterator = tree.Begin(); !iterator.IsEnd(); ++iterator) {
+    keys.push_back((*iterator).second.GetSlotNum());
+  }
+  EXPECT_EQ(even_keys, keys);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// keys that share key / 100 count as the same key; of the concurrent inserts of a group exactly one gets in
+TEST(BPlusTreeConcurrentTest, InsertUniqueTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_groups = 200;
+  const int num_threads = 4;
+  std::atomic<int> inserted{0};
+  LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+    std::vector<int64_t> keys;
+    for (int64_t key = 0; key < num_groups * 100; key += 10) {
+      keys.push_back(key + static_cast<int64_t>(thread_itr));
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(thread_itr));
+    GenericKey<8> index_key;
+    GenericKey<8> lowest;
+    RID rid;
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      lowest.SetFromInteger(key / 100 * 100);
+      rid.Set(0, key);
+      auto same_group = [&](const GenericKey<8> &entry) {
+        return entry.ToValue(key_schema.get(), 0).GetAs<int64_t>() / 100 == key / 100;
+      };
+      if (tree.InsertUnique(index_key, rid, lowest, same_group)) {
+        inserted++;
+      }
+    }
+  });
+  EXPECT_EQ(num_groups, inserted.load());
+
+  int64_t group = 0;
+  for (auto iterator = tree.Begin(); !iterator.IsEnd(); ++iterator) {
+    EXPECT_EQ(group++, (*iterator).second.GetSlotNum() / 100);
+  }
+  EXPECT_EQ(num_groups, group);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// concurrent inserts, lookups and a mixed workload with default node sizes
+TEST(BPlusTreeConcurrentTest, DefaultSizeMixedTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t num_keys = 200000;
+  const int num_threads = 8;
+  std::vector<int64_t> keys(num_keys);
+  for (int64_t i = 0; i < num_keys; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+
+  std::atomic<int64_t> found{0};
+  LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    for (int64_t i = thread_itr; i < num_keys; i += num_threads) {
+      rids.clear();
+      index_key.SetFromInteger(keys[i]);
+      found += static_cast<int64_t>(tree.GetValue(index_key, &rids));
+    }
+  });
+  EXPECT_EQ(num_keys, found.load());
+
+  // each thread removes a slice of the keys, inserts new ones and looks up both
+  LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    RID rid;
+    for (int64_t i = thread_itr; i < num_keys; i += num_threads) {
+      index_key.SetFromInteger(keys[i]);
+      if (i % 2 == 0) {
+        tree.Remove(index_key);
+        index_key.SetFromInteger(num_keys + keys[i]);
+        rid.Set(0, static_cast<uint32_t>(num_keys + keys[i]));
+        tree.Insert(index_key, rid);
+      }
+      rids.clear();
+      EXPECT_TRUE(tree.GetValue(index_key, &rids));
+    }
+  });
+
+  int64_t count = 0;
+  int64_t last = -1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    int64_t slot = (*iterator).second.GetSlotNum();
+    ASSERT_LT(last, slot);
+    last = slot;
+    count++;
+  }
+  EXPECT_EQ(num_keys, count);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <random>
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -20,7 +22,7 @@
 
 namespace bustub {
 
-TEST(BPlusTreeTests, DISABLED_DeleteTest1) {
+TEST(BPlusTreeTests, DeleteTest1) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -98,7 +100,7 @@ TEST(BPlusTreeTests, DISABLED_DeleteTest1) {
   remove("test.log");
 }
 
-TEST(BPlusTreeTests, DISABLED_DeleteTest2) {
+TEST(BPlusTreeTests, DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
   GenericComparator<8> comparator(key_schema.get());
@@ -175,4 +177,126 @@ TEST(BPlusTreeTests, DISABLED_DeleteTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+// a non-unique tree keeps every value of a key; some keys need posting lists of several pages
+TEST(BPlusTreeTests, DuplicateKeyTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(200, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4, false);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // every 10th key has 3000 values, whose page ids are far apart, the others one to three
+  const int num_keys = 100;
+  auto num_values = [](int64_t key) { return key % 10 == 0 ? 3000 : static_cast<int>(key % 3) + 1; };
+  std::vector<std::pair<int64_t, RID>> pairs;
+  for (int64_t key = 0; key < num_keys; key++) {
+    for (int i = 0; i < num_values(key); i++) {
+      pairs.emplace_back(key, RID(i, static_cast<uint32_t>(key)));
+    }
+  }
+  std::mt19937 gen(15445);
+  std::shuffle(pairs.begin(), pairs.end(), gen);
+  for (const auto &pair : pairs) {
+    index_key.SetFromInteger(pair.first);
+    EXPECT_TRUE(tree.Insert(index_key, pair.second, transaction));
+  }
+  index_key.SetFromInteger(10);
+  EXPECT_FALSE(tree.Insert(index_key, RID(7, 10), transaction));
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids));
+    ASSERT_EQ(num_values(key), rids.size());
+    for (int i = 0; i < num_values(key); i++) {
+      EXPECT_EQ(i, rids[i].GetPageId());
+    }
+  }
+
+  // the iterator starts at the first value of the key and returns the key once per value
+  int64_t current_key = 50;
+  int count = 0;
+  index_key.SetFromInteger(current_key);
+  for (auto iterator = tree.Begin(index_key); iterator != tree.End(); ++iterator) {
+    auto location = (*iterator).second;
+    if (static_cast<int64_t>(location.GetSlotNum()) != current_key) {
+      ASSERT_EQ(count, num_values(current_key));
+      current_key++;
+      count = 0;
+    }
+    ASSERT_EQ(current_key, location.GetSlotNum());
+    ASSERT_EQ(count, location.GetPageId());
+    count++;
+  }
+  EXPECT_EQ(num_keys - 1, current_key);
+
+  // remove all values but the last one of every key, then the keys themselves
+  std::shuffle(pairs.begin(), pairs.end(), gen);
+  for (const auto &pair : pairs) {
+    if (pair.second.GetPageId() != num_values(pair.first) - 1) {
+      index_key.SetFromInteger(pair.first);
+      tree.Remove(index_key, pair.second, transaction);
+    }
+  }
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids));
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(num_values(key) - 1, rids[0].GetPageId());
+    // a value the key does not have leaves it alone
+    tree.Remove(index_key, RID(num_values(key), static_cast<uint32_t>(key)), transaction);
+  }
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, RID(num_values(key) - 1, static_cast<uint32_t>(key)), transaction);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  // bulk loading collects the values of a repeated key
+  std::sort(pairs.begin(), pairs.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+  size_t next = 0;
+  tree.BulkLoad([&](GenericKey<8> *key, RID *value) {
+    if (next == pairs.size()) {
+      return false;
+    }
+    key->SetFromInteger(pairs[next].first);
+    *value = pairs[next].second;
+    next++;
+    return true;
+  });
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids));
+    EXPECT_EQ(num_values(key), rids.size());
+  }
+  for (int64_t key = 0; key < num_keys; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  EXPECT_TRUE(tree.IsEmpty());
+
+  // no tree or posting page was left pinned
+  for (int i = 0; i < 199; i++) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
@@ -0,0 +1,139 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sort_test.cpp
+//
+// Identification: test/storage/external_sort_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/external_sort.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+// input that fits in memory is sorted without touching the buffer pool
+TEST(ExternalSortTest, InMemoryTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(10, disk_manager);
+
+  ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(bpm, comparator);
+  GenericKey<8> key;
+  RID rid;
+  for (int64_t i = 999; i >= 0; i--) {
+    key.SetFromInteger(i);
+    rid.Set(0, static_cast<uint32_t>(i));
+    sorter.Add(key, rid);
+  }
+  EXPECT_EQ(1000, sorter.Size());
+
+  int64_t expected = 0;
+  while (sorter.Next(&key, &rid)) {
+    EXPECT_EQ(expected, rid.GetSlotNum());
+    expected++;
+  }
+  EXPECT_EQ(1000, expected);
+  EXPECT_EQ(0, sorter.NumSpilledRuns());
+
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// runs of a single page force several merge passes through a small buffer pool; equal keys keep their order
+TEST(ExternalSortTest, SpillTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(40, disk_manager);
+
+  const int num_pairs = 100000;
+  const int num_keys = 1000;
+  std::vector<int64_t> keys(num_pairs);
+  for (int i = 0; i < num_pairs; i++) {
+    keys[i] = i % num_keys;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  {
+    ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(bpm, comparator, 0);
+    GenericKey<8> key;
+    RID rid;
+    for (int i = 0; i < num_pairs; i++) {
+      key.SetFromInteger(keys[i]);
+      // the slot number records the insertion order
+      rid.Set(static_cast<int32_t>(keys[i]), static_cast<uint32_t>(i));
+      sorter.Add(key, rid);
+    }
+    EXPECT_GT(sorter.NumSpilledRuns(), (ExternalSort<GenericKey<8>, RID, GenericComparator<8>>::MERGE_FAN_IN));
+
+    int count = 0;
+    RID prev;
+    while (sorter.Next(&key, &rid)) {
+      if (count > 0) {
+        ASSERT_LE(prev.GetPageId(), rid.GetPageId());
+        if (prev.GetPageId() == rid.GetPageId()) {
+          ASSERT_LT(prev.GetSlotNum(), rid.GetSlotNum());
+        }
+      }
+      prev = rid;
+      count++;
+    }
+    EXPECT_EQ(num_pairs, count);
+  }
+
+  // all temporary pages were unpinned and deleted
+  for (int i = 0; i < 40; i++) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a sort that is abandoned halfway releases its pages
+TEST(ExternalSortTest, AbandonTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(20, disk_manager);
+
+  {
+    ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(bpm, comparator, 0);
+    GenericKey<8> key;
+    RID rid;
+    for (int64_t i = 0; i < 10000; i++) {
+      key.SetFromInteger((i * 7919) % 10000);
+      sorter.Add(key, rid);
+    }
+    for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(sorter.Next(&key, &rid));
+    }
+  }
+  for (int i = 0; i < 20; i++) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
@@ -0,0 +1,264 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "container/hash/extendible_hash_table.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/generic_key.h"
+#include "test_util.h"  // NOLINT
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// the column by column comparison of two key tuples that normalized keys have to agree with
+static int CompareValues(const std::vector<Value> &lhs, const std::vector<Value> &rhs) {
+  for (size_t i = 0; i < lhs.size(); i++) {
+    if (lhs[i].CompareLessThan(rhs[i]) == CmpBool::CmpTrue) {
+      return -1;
+    }
+    if (lhs[i].CompareGreaterThan(rhs[i]) == CmpBool::CmpTrue) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int Sign(int cmp) { return static_cast<int>(cmp > 0) - static_cast<int>(cmp < 0); }
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, NormalizedOrderTest) {
+  std::vector<Column> columns{{"a", TypeId::SMALLINT}, {"b", TypeId::INTEGER},  {"c", TypeId::BIGINT},
+                              {"d", TypeId::DECIMAL},  {"e", TypeId::TINYINT},  {"f", TypeId::BOOLEAN}};
+  Schema schema{columns};
+  ASSERT_TRUE(NormalizedKey::IsNormalized(&schema));
+  GenericComparator<32> comparator(&schema);
+
+  // few distinct values per column, so that later columns decide many comparisons
+  std::mt19937 rng(15445);
+  auto pick = [&rng](auto values) { return values[rng() % values.size()]; };
+  std::vector<std::vector<Value>> rows;
+  for (int i = 0; i < 300; i++) {
+    rows.push_back({ValueFactory::GetSmallIntValue(pick(std::vector<int16_t>{-300, -1, 0, 1, 32767})),
+                    ValueFactory::GetIntegerValue(pick(std::vector<int32_t>{-2147483647, -5, 0, 7, 1 << 30})),
+                    ValueFactory::GetBigIntValue(pick(std::vector<int64_t>{-(1LL << 40), -1, 0, 3, 1LL << 50})),
+                    ValueFactory::GetDecimalValue(pick(std::vector<double>{-1e10, -0.5, -0.0, 0.0, 0.25, 3.5e8})),
+                    ValueFactory::GetTinyIntValue(pick(std::vector<int8_t>{-100, -1, 0, 1, 127})),
+                    ValueFactory::GetBooleanValue(pick(std::vector<bool>{false, true}))});
+  }
+  std::vector<GenericKey<32>> keys(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    keys[i].SetFromKey(Tuple(rows[i], &schema), &schema);
+    // the values can be read back from the key
+    for (uint32_t column = 0; column < columns.size(); column++) {
+      ASSERT_EQ(CmpBool::CmpTrue, keys[i].ToValue(&schema, column).CompareEquals(rows[i][column]));
+    }
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    for (size_t j = 0; j < rows.size(); j++) {
+      ASSERT_EQ(CompareValues(rows[i], rows[j]), Sign(comparator(keys[i], keys[j]))) << i << " vs " << j;
+    }
+  }
+
+  // -0.0 and 0.0 are the same key, so a unique index cannot hold both and a lookup of one finds the other
+  Schema decimal_schema{std::vector<Column>{{"a", TypeId::DECIMAL}}};
+  GenericKey<8> negative_zero;
+  GenericKey<8> positive_zero;
+  negative_zero.SetFromKey(Tuple({ValueFactory::GetDecimalValue(-0.0)}, &decimal_schema), &decimal_schema);
+  positive_zero.SetFromKey(Tuple({ValueFactory::GetDecimalValue(0.0)}, &decimal_schema), &decimal_schema);
+  EXPECT_EQ(0, GenericComparator<8>(&decimal_schema)(negative_zero, positive_zero));
+  EXPECT_EQ(0, memcmp(negative_zero.data_, positive_zero.data_, sizeof(negative_zero.data_)));
+
+  // NULL sorts before every other value of its type
+  Schema bigint_schema{std::vector<Column>{{"a", TypeId::BIGINT}}};
+  GenericComparator<8> bigint_comparator(&bigint_schema);
+  GenericKey<8> null_key;
+  GenericKey<8> min_key;
+  null_key.SetFromKey(Tuple({ValueFactory::GetNullValueByType(TypeId::BIGINT)}, &bigint_schema), &bigint_schema);
+  min_key.SetFromKey(Tuple({ValueFactory::GetBigIntValue(BUSTUB_INT64_MIN)}, &bigint_schema), &bigint_schema);
+  EXPECT_LT(bigint_comparator(null_key, min_key), 0);
+  EXPECT_TRUE(null_key.ToValue(&bigint_schema, 0).IsNull());
+
+  // integer keys of the tests keep their order, negative ones included
+  GenericKey<8> small;
+  GenericKey<8> large;
+  small.SetFromInteger(-7);
+  large.SetFromInteger(5);
+  EXPECT_LT(bigint_comparator(small, large), 0);
+  EXPECT_EQ(-7, small.ToString());
+}
+
+// keys with variable-length columns are normalized column after column
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, VarcharKeyTest) {
+  Schema schema{std::vector<Column>{{"a", TypeId::VARCHAR, 16}, {"b", TypeId::INTEGER}}};
+  EXPECT_TRUE(NormalizedKey::IsNormalized(&schema));
+  GenericComparator<32> comparator(&schema);
+  // NULL < "" < "a" < "ab" < "b", and the integer decides between equal strings
+  std::vector<std::vector<Value>> rows{
+      {ValueFactory::GetNullValueByType(TypeId::VARCHAR), ValueFactory::GetIntegerValue(3)},
+      {ValueFactory::GetVarcharValue(""), ValueFactory::GetIntegerValue(-1)},
+      {ValueFactory::GetVarcharValue("a"), ValueFactory::GetIntegerValue(-5)},
+      {ValueFactory::GetVarcharValue("a"), ValueFactory::GetIntegerValue(2)},
+      {ValueFactory::GetVarcharValue("ab"), ValueFactory::GetIntegerValue(0)},
+      {ValueFactory::GetVarcharValue("apple"), ValueFactory::GetIntegerValue(0)},
+      {ValueFactory::GetVarcharValue("banana"), ValueFactory::GetIntegerValue(0)}};
+  std::vector<GenericKey<32>> keys(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    keys[i].SetFromKey(Tuple(rows[i], &schema), &schema);
+    EXPECT_EQ(rows[i][0].IsNull(), keys[i].ToValue(&schema, 0).IsNull());
+    if (!rows[i][0].IsNull()) {
+      EXPECT_EQ(CmpBool::CmpTrue, keys[i].ToValue(&schema, 0).CompareEquals(rows[i][0]));
+    }
+    EXPECT_EQ(CmpBool::CmpTrue, keys[i].ToValue(&schema, 1).CompareEquals(rows[i][1]));
+  }
+  for (size_t i = 0; i < rows.size(); i++) {
+    for (size_t j = 0; j < rows.size(); j++) {
+      int expected = Sign(static_cast<int>(i) - static_cast<int>(j));
+      EXPECT_EQ(expected, Sign(comparator(keys[i], keys[j]))) << i << " vs " << j;
+    }
+  }
+
+  // keys longer than the key size are rejected instead of cut off; a key that just fits is kept whole
+  GenericKey<8> long_key;
+  EXPECT_THROW(
+      long_key.SetFromKey(Tuple({ValueFactory::GetVarcharValue("abcdefg"), ValueFactory::GetIntegerValue(1)}, &schema),
+                          &schema),
+      Exception);
+  long_key.SetFromKey(Tuple({ValueFactory::GetVarcharValue("ab"), ValueFactory::GetIntegerValue(1)}, &schema), &schema);
+  EXPECT_EQ("ab", long_key.ToValue(&schema, 0).ToString());
+  EXPECT_EQ(1, long_key.ToValue(&schema, 1).GetAs<int32_t>());
+}
+
+// compares keys the way GenericComparator did before keys were normalized, as the baseline of the benchmark
+class ValueComparator {
+ public:
+  explicit ValueComparator(Schema *key_schema) : key_schema_(key_schema) {}
+
+  int operator()(const GenericKey<8> &lhs, const GenericKey<8> &rhs) const {
+    for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+      uint32_t offset = key_schema_->GetColumn(i).GetOffset();
+      Value lhs_value = Value::DeserializeFrom(lhs.data_ + offset, key_schema_->GetColumn(i).GetType());
+      Value rhs_value = Value::DeserializeFrom(rhs.data_ + offset, key_schema_->GetColumn(i).GetType());
+      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
+        return -1;
+      }
+      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  Schema *key_schema_;
+};
+
+// key comparisons in binary searches, B+ tree lookups and hash bucket scans on bigint keys.
+// Disabled in the unit test run; run it with --gtest_also_run_disabled_tests
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, DISABLED_ComparisonBenchmark) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  ValueComparator value_comparator(key_schema.get());
+  const int num_keys = 100000;
+  const int num_lookups = 200000;
+  std::vector<int64_t> lookups(num_lookups);
+  std::mt19937 rng(15445);
+  for (auto &lookup : lookups) {
+    lookup = rng() % num_keys;
+  }
+  auto time = [](auto &&body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  // binary search over a sorted array, the search of a B+ tree page
+  std::vector<GenericKey<8>> normalized(num_keys);
+  std::vector<GenericKey<8>> raw(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    normalized[i].SetFromInteger(i);
+    memset(raw[i].data_, 0, sizeof(raw[i].data_));
+    memcpy(raw[i].data_, &i, sizeof(i));
+  }
+  auto search = [&](const std::vector<GenericKey<8>> &keys, auto &&compare, auto &&set_key) {
+    int found = 0;
+    GenericKey<8> key;
+    for (int64_t lookup : lookups) {
+      set_key(&key, lookup);
+      auto less = [&compare](const GenericKey<8> &l, const GenericKey<8> &r) { return compare(l, r) < 0; };
+      found += static_cast<int>(std::binary_search(keys.begin(), keys.end(), key, less));
+    }
+    EXPECT_EQ(num_lookups, found);
+  };
+  double value_search = time([&] {
+    search(raw, value_comparator, [](GenericKey<8> *key, int64_t i) {
+      memset(key->data_, 0, sizeof(key->data_));
+      memcpy(key->data_, &i, sizeof(i));
+    });
+  });
+  double normalized_search = time([&] {
+    search(normalized, comparator, [](GenericKey<8> *key, int64_t i) { key->SetFromInteger(i); });
+  });
+  printf("%d binary searches: Value comparisons %.2f Mops/s, normalized keys %.2f Mops/s\n", num_lookups,
+         num_lookups / value_search / 1e6, num_lookups / normalized_search / 1e6);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(&page_id);
+
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+  ExtendibleHashTable<GenericKey<8>, RID, GenericComparator<8>> ht("foo_hash", bpm, comparator,
+                                                                   HashFunction<GenericKey<8>>());
+  GenericKey<8> index_key;
+  RID rid;
+  for (int64_t i = 0; i < num_keys; i++) {
+    index_key.SetFromInteger(i);
+    rid.Set(0, static_cast<uint32_t>(i));
+    tree.Insert(index_key, rid);
+    ht.Insert(nullptr, index_key, rid);
+  }
+  double tree_lookup = time([&] {
+    std::vector<RID> result;
+    for (int64_t lookup : lookups) {
+      index_key.SetFromInteger(lookup);
+      tree.GetValue(index_key, &result);
+    }
+    EXPECT_EQ(num_lookups, result.size());
+  });
+  double hash_lookup = time([&] {
+    std::vector<RID> result;
+    for (int64_t lookup : lookups) {
+      index_key.SetFromInteger(lookup);
+      ht.GetValue(nullptr, index_key, &result);
+    }
+    EXPECT_EQ(num_lookups, result.size());
+  });
+  printf("%d lookups: B+ tree %.2f Mops/s, extendible hash table %.2f Mops/s\n", num_lookups,
+         num_lookups / tree_lookup / 1e6, num_lookups / hash_lookup / 1e6);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
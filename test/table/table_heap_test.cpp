@@ -0,0 +1,219 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_heap_test.cpp
+//
+// Identification: test/table/table_heap_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+Schema MakeSchema() { return Schema({Column{"id", TypeId::INTEGER}, Column{"pad", TypeId::VARCHAR, 100}}); }
+
+Tuple MakeTuple(int32_t id, const Schema &schema) {
+  std::vector<Value> values{ValueFactory::GetIntegerValue(id), ValueFactory::GetVarcharValue(std::string(100, 'x'))};
+  return Tuple(values, &schema);
+}
+
+// the pages of the table, in chain order
+std::vector<page_id_t> TablePages(BufferPoolManager *bpm, page_id_t first_page_id) {
+  std::vector<page_id_t> pages;
+  for (page_id_t page_id = first_page_id; page_id != INVALID_PAGE_ID;) {
+    pages.push_back(page_id);
+    auto page = static_cast<TablePage *>(bpm->FetchPage(page_id));
+    page_id_t next_page_id = page->GetNextPageId();
+    bpm->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  return pages;
+}
+
+}  // namespace
+
+// freed space is reused, also by a reopened table with or without its free space map
+// NOLINTNEXTLINE
+TEST(TableHeapTest, ReuseFreeSpaceTest) {
+  Schema schema = MakeSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn);
+
+  const int num_tuples = 1000;
+  std::vector<RID> rids(num_tuples);
+  for (int i = 0; i < num_tuples; i++) {
+    ASSERT_TRUE(table->InsertTuple(MakeTuple(i, schema), &rids[i], txn));
+  }
+  std::vector<page_id_t> pages = TablePages(bpm, table->GetFirstPageId());
+  std::set<page_id_t> old_pages(pages.begin(), pages.end());
+  EXPECT_GT(pages.size(), 10U);
+
+  // deletes the tuples in [begin, end) and inserts as many into heap
+  auto delete_and_insert = [&](int begin, int end, TableHeap *heap) {
+    for (int i = begin; i < end; i++) {
+      ASSERT_TRUE(table->MarkDelete(rids[i], txn));
+      table->ApplyDelete(rids[i], txn);
+    }
+    for (int i = begin; i < end; i++) {
+      RID rid;
+      ASSERT_TRUE(heap->InsertTuple(MakeTuple(num_tuples + i, schema), &rid, txn));
+      EXPECT_EQ(1, old_pages.count(rid.GetPageId()));
+      Tuple tuple;
+      ASSERT_TRUE(heap->GetTuple(rid, &tuple, txn));
+      EXPECT_EQ(num_tuples + i, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    }
+  };
+
+  delete_and_insert(0, num_tuples / 4, table);
+  EXPECT_EQ(pages, TablePages(bpm, table->GetFirstPageId()));
+
+  // the first page of the table records its free space map, which the reopened table opens
+  auto *reopened = new TableHeap(bpm, lock_manager, log_manager, table->GetFirstPageId());
+  delete_and_insert(num_tuples / 4, num_tuples / 2, reopened);
+  EXPECT_EQ(pages, TablePages(bpm, table->GetFirstPageId()));
+  EXPECT_EQ(table->GetFreeSpaceMapPageId(), reopened->GetFreeSpaceMapPageId());
+
+  // a table whose first page records no free space map builds a new one from its pages
+  auto first_page = static_cast<TablePage *>(bpm->FetchPage(table->GetFirstPageId()));
+  first_page->SetFreeSpaceMapPageId(INVALID_PAGE_ID);
+  bpm->UnpinPage(table->GetFirstPageId(), true);
+  auto *rebuilt = new TableHeap(bpm, lock_manager, log_manager, table->GetFirstPageId());
+  delete_and_insert(num_tuples / 2, num_tuples, rebuilt);
+  EXPECT_EQ(pages, TablePages(bpm, table->GetFirstPageId()));
+  EXPECT_NE(table->GetFreeSpaceMapPageId(), rebuilt->GetFreeSpaceMapPageId());
+
+  // a full table grows again
+  RID rid;
+  for (int i = 0; i < num_tuples / 10; i++) {
+    ASSERT_TRUE(rebuilt->InsertTuple(MakeTuple(i, schema), &rid, txn));
+  }
+  EXPECT_EQ(0, old_pages.count(rid.GetPageId()));
+  EXPECT_EQ(rid.GetPageId(), TablePages(bpm, table->GetFirstPageId()).back());
+
+  delete rebuilt;
+  delete reopened;
+  delete table;
+  delete txn;
+  delete log_manager;
+  delete lock_manager;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// concurrent inserts get distinct rids and every tuple can be read back
+// NOLINTNEXTLINE
+TEST(TableHeapTest, ConcurrentInsertTest) {
+  Schema schema = MakeSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn);
+
+  const int num_threads = 4;
+  const int num_tuples = 2000;
+  std::vector<std::vector<RID>> rids(num_threads, std::vector<RID>(num_tuples));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      // the transaction belongs to the thread that inserts
+      Transaction thread_txn(t + 1);
+      for (int i = 0; i < num_tuples; i++) {
+        ASSERT_TRUE(table->InsertTuple(MakeTuple(t * num_tuples + i, schema), &rids[t][i], &thread_txn));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::set<int64_t> distinct;
+  for (int t = 0; t < num_threads; t++) {
+    for (int i = 0; i < num_tuples; i++) {
+      EXPECT_TRUE(distinct.insert(rids[t][i].Get()).second);
+      Tuple tuple;
+      ASSERT_TRUE(table->GetTuple(rids[t][i], &tuple, txn));
+      EXPECT_EQ(t * num_tuples + i, tuple.GetValue(&schema, 0).GetAs<int32_t>());
+    }
+  }
+  int count = 0;
+  for (auto iterator = table->Begin(txn); iterator != table->End(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(num_threads * num_tuples, count);
+
+  delete table;
+  delete txn;
+  delete log_manager;
+  delete lock_manager;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// insert throughput as the table grows; it should not drop with the number of pages.
+// Disabled in the unit test run; run it with --gtest_also_run_disabled_tests
+// NOLINTNEXTLINE
+TEST(TableHeapTest, DISABLED_InsertThroughputTest) {
+  Schema schema = MakeSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(1000, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(bpm, lock_manager, log_manager, txn);
+
+  const int num_rounds = 5;
+  const int round_tuples = 20000;
+  Tuple tuple = MakeTuple(0, schema);
+  RID rid;
+  for (int round = 0; round < num_rounds; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < round_tuples; i++) {
+      ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%d tuples, %d pages: insert %.0f ops/s\n", (round + 1) * round_tuples,
+           static_cast<int>(TablePages(bpm, table->GetFirstPageId()).size()), round_tuples / elapsed);
+    txn->GetWriteSet()->clear();
+  }
+
+  delete table;
+  delete txn;
+  delete log_manager;
+  delete lock_manager;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub